@@ -0,0 +1,55 @@
+/*
+   Copyright (C) 2015 Preet Desai (preet.desai@gmail.com)
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+*/
+
+#include <ks/draw/KsDrawBatchStats.hpp>
+
+namespace ks
+{
+    namespace draw
+    {
+        BatchStats::BatchStats()
+        {
+            ClearUpdateStats();
+        }
+
+        void BatchStats::ClearUpdateStats()
+        {
+            update_ms = 0;
+            merge_count = 0;
+            snapshot_bytes = 0;
+            snapshot_shared_bytes = 0;
+            merged_bytes = 0;
+            render_data_bytes = 0;
+            list_task_stats.clear();
+        }
+
+        void BatchStats::GenText()
+        {
+            text.clear();
+
+            text += "batch: " + ks::ToStringFormat(update_ms,3,7,'0') + "ms\n";
+            text += "batch merges/tasks: " +
+                    ks::ToString(merge_count) + "/" +
+                    ks::ToString(list_task_stats.size()) + "\n";
+            text += "batch snapshot/merged/rd: " +
+                    ks::ToString(snapshot_bytes) + "/" +
+                    ks::ToString(merged_bytes) + "/" +
+                    ks::ToString(render_data_bytes) + " bytes\n";
+            text += "batch snapshot shared: " +
+                    ks::ToString(snapshot_shared_bytes) + " bytes\n";
+        }
+    }
+}
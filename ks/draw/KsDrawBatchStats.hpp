@@ -0,0 +1,94 @@
+/*
+   Copyright (C) 2015 Preet Desai (preet.desai@gmail.com)
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+*/
+
+#ifndef KS_DRAW_BATCH_STATS_HPP
+#define KS_DRAW_BATCH_STATS_HPP
+
+#include <ks/KsGlobal.hpp>
+
+namespace ks
+{
+    namespace draw
+    {
+        struct BatchStats final
+        {
+            // * Taken from the last completed merge of a batch group
+            struct GroupStats
+            {
+                bool valid;
+                uint merge_count;
+
+                // Wall time of the merge (for TimeSliced groups this
+                // is the sum of the slices, for MultiFrame groups it
+                // is the time spent in the worker thread)
+                double merge_ms;
+
+                // MultiFrame only: the time the BatchTask waited in
+                // the thread pool before it started
+                double task_queue_ms;
+
+                // Bytes copied from BatchData into the MultiFrame
+                // snapshot (moved geometry isn't counted)
+                u64 snapshot_bytes;
+
+                // Bytes written into merged geometry
+                u64 merged_bytes;
+
+                // Bytes of merged geometry handed to RenderData by
+                // MultiFrame and TimeSliced groups (the buffers are
+                // moved, SingleFrame groups merge in place)
+                u64 render_data_bytes;
+
+                uint chunk_count;
+
+                // VertexBuffer 0 size/capacity of the chunks
+                double chunk_fill_ratio;
+            };
+
+            // * A BatchTask whose results were applied
+            struct TaskStats
+            {
+                uint batch_desc_count;
+                double queue_ms;
+                double process_ms;
+                u64 merged_bytes;
+                bool cancelled;
+            };
+
+            BatchStats();
+            ~BatchStats() = default;
+
+            void ClearUpdateStats();
+            void GenText();
+
+            // indexed by batch id
+            std::vector<GroupStats> list_group_stats;
+
+            // collected during the last update
+            double update_ms;
+            uint merge_count;
+            u64 snapshot_bytes;
+            u64 snapshot_shared_bytes; // not copied (see SetMFDedupGeometry)
+            u64 merged_bytes;
+            u64 render_data_bytes;
+            std::vector<TaskStats> list_task_stats;
+
+            std::string text;
+        };
+    }
+}
+
+#endif // KS_DRAW_BATCH_STATS_HPP
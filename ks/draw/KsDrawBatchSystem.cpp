@@ -14,6 +14,19 @@
    limitations under the License.
 */
 
+#if defined(__AVX2__)
+    #include <immintrin.h>
+    #define KS_DRAW_IX_AVX2
+    #define KS_DRAW_IX_SSE2
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && (_M_IX86_FP >= 2))
+    #include <emmintrin.h>
+    #define KS_DRAW_IX_SSE2
+#endif
+
+#include <algorithm>
+#include <cstring>
+#include <limits>
+
 #include <ks/draw/KsDrawBatchSystem.hpp>
 
 namespace ks
@@ -25,215 +38,1581 @@ namespace ks
             // ============================================================= //
             // ============================================================= //
 
+            void IncrementListIx(u16* ix_ptr, uint ix_count, u16 inc)
+            {
+                uint i=0;
+
+#if defined(KS_DRAW_IX_AVX2)
+                __m256i const inc_256 = _mm256_set1_epi16(static_cast<short>(inc));
+                for(; i+16 <= ix_count; i+=16) {
+                    __m256i* ptr = reinterpret_cast<__m256i*>(ix_ptr+i);
+                    _mm256_storeu_si256(
+                                ptr,_mm256_add_epi16(
+                                    _mm256_loadu_si256(ptr),inc_256));
+                }
+#endif
+
+#if defined(KS_DRAW_IX_SSE2)
+                __m128i const inc_128 = _mm_set1_epi16(static_cast<short>(inc));
+                for(; i+8 <= ix_count; i+=8) {
+                    __m128i* ptr = reinterpret_cast<__m128i*>(ix_ptr+i);
+                    _mm_storeu_si128(
+                                ptr,_mm_add_epi16(
+                                    _mm_loadu_si128(ptr),inc_128));
+                }
+#endif
+
+                for(; i < ix_count; i++) {
+                    ix_ptr[i] += inc;
+                }
+            }
+
+            void IncrementListIx(u32* ix_ptr, uint ix_count, u32 inc)
+            {
+                uint i=0;
+
+#if defined(KS_DRAW_IX_AVX2)
+                __m256i const inc_256 = _mm256_set1_epi32(static_cast<int>(inc));
+                for(; i+8 <= ix_count; i+=8) {
+                    __m256i* ptr = reinterpret_cast<__m256i*>(ix_ptr+i);
+                    _mm256_storeu_si256(
+                                ptr,_mm256_add_epi32(
+                                    _mm256_loadu_si256(ptr),inc_256));
+                }
+#endif
+
+#if defined(KS_DRAW_IX_SSE2)
+                __m128i const inc_128 = _mm_set1_epi32(static_cast<int>(inc));
+                for(; i+4 <= ix_count; i+=4) {
+                    __m128i* ptr = reinterpret_cast<__m128i*>(ix_ptr+i);
+                    _mm_storeu_si128(
+                                ptr,_mm_add_epi32(
+                                    _mm_loadu_si128(ptr),inc_128));
+                }
+#endif
+
+                for(; i < ix_count; i++) {
+                    ix_ptr[i] += inc;
+                }
+            }
+
+            // ============================================================= //
+
+            double GetElapsedMs(std::chrono::steady_clock::time_point const &time_start)
+            {
+                return std::chrono::duration_cast<
+                        std::chrono::microseconds>(
+                            std::chrono::steady_clock::now()-time_start).count()/1000.0;
+            }
+
+            u64 GetGeometrySizeBytes(Geometry const &gm)
+            {
+                u64 size_bytes = 0;
+                for(auto const &vx_data : gm.GetVertexBuffers())
+                {
+                    if(vx_data)
+                    {
+                        size_bytes += vx_data->size();
+                    }
+                }
+
+                if(gm.GetIndexBuffer())
+                {
+                    size_bytes += gm.GetIndexBuffer()->size();
+                }
+
+                return size_bytes;
+            }
+
+            // ============================================================= //
+
+            uint GetMergedVertexBufferLimit(BufferLayout const * buffer_layout)
+            {
+                uint const vx_block_size =
+                        buffer_layout->GetVertexBufferAllocator(0)->
+                        GetBlockSize();
+
+                if(buffer_layout->GetIsIndexed() &&
+                   (buffer_layout->GetIndexType() == IndexType::UInt16))
+                {
+                    uint const vx_limit =
+                            65536*buffer_layout->GetVertexSizeBytes(0);
+
+                    return std::min(vx_block_size,vx_limit);
+                }
+
+                return vx_block_size;
+            }
+
+            // ============================================================= //
+
+            gl::Primitive GetMergedPrimitive(gl::Primitive primitive)
+            {
+                if(primitive == gl::Primitive::TriangleFan) {
+                    return gl::Primitive::Triangles;
+                }
+                if(primitive == gl::Primitive::LineStrip ||
+                   primitive == gl::Primitive::LineLoop) {
+                    return gl::Primitive::Lines;
+                }
+                return primitive;
+            }
+
+            bool GetIsListPrimitive(gl::Primitive primitive)
+            {
+                return (primitive == gl::Primitive::Triangles ||
+                        primitive == gl::Primitive::Lines ||
+                        primitive == gl::Primitive::Points);
+            }
+
+            uint GetMergedElementCount(gl::Primitive primitive,
+                                       uint element_count)
+            {
+                if(element_count == 0) {
+                    return 0;
+                }
+
+                switch(primitive)
+                {
+                    case gl::Primitive::TriangleStrip:
+                        // Up to three degenerate elements to join
+                        // the previous strip and keep its winding
+                        return element_count+3;
+
+                    case gl::Primitive::TriangleFan:
+                        return (element_count < 3) ? 0 : 3*(element_count-2);
+
+                    case gl::Primitive::LineStrip:
+                        return 2*(element_count-1);
+
+                    case gl::Primitive::LineLoop:
+                        return (element_count < 2) ? 0 : 2*element_count;
+
+                    default:
+                        return element_count;
+                }
+            }
+
+            std::pair<uint,uint> GetMergedSizeBytes(BufferLayout const * buffer_layout,
+                                                    gl::Primitive primitive,
+                                                    Geometry const &single_gm)
+            {
+                uint const vx_size =
+                        (single_gm.GetVertexBuffers().empty() ||
+                         !single_gm.GetVertexBuffer(0)) ?
+                            0 : single_gm.GetVertexBuffer(0)->size();
+
+                if(!buffer_layout->GetIsIndexed())
+                {
+                    if(GetIsListPrimitive(primitive)) {
+                        return std::make_pair(vx_size,0u);
+                    }
+
+                    uint const vx_size_bytes = buffer_layout->GetVertexSizeBytes(0);
+                    return std::make_pair(
+                                GetMergedElementCount(
+                                    primitive,vx_size/vx_size_bytes)*vx_size_bytes,
+                                0u);
+                }
+
+                uint const ix_size =
+                        single_gm.GetIndexBuffer() ?
+                            single_gm.GetIndexBuffer()->size() : 0;
+
+                if(GetIsListPrimitive(primitive)) {
+                    return std::make_pair(vx_size,ix_size);
+                }
+
+                uint const ix_size_bytes = buffer_layout->GetIndexSizeBytes();
+                return std::make_pair(
+                            vx_size,
+                            GetMergedElementCount(
+                                primitive,ix_size/ix_size_bytes)*ix_size_bytes);
+            }
+
+            namespace
+            {
+                // * The elements of a single geometry to append to
+                //   merged geometry that already has prev_count
+                //   elements, as positions into the single geometry's
+                //   elements. If join_prev is set, the last element
+                //   of the merged geometry is repeated first
+                void CreateMergedElementList(gl::Primitive primitive,
+                                             uint count,
+                                             uint prev_count,
+                                             std::vector<uint>& list_elements,
+                                             bool& join_prev)
+                {
+                    list_elements.clear();
+                    join_prev = false;
+
+                    if(count == 0) {
+                        return;
+                    }
+
+                    switch(primitive)
+                    {
+                        case gl::Primitive::TriangleStrip:
+                        {
+                            // Join strips with degenerate triangles: repeat
+                            // the last element and the first new one. The
+                            // new strip must start on an even element to
+                            // keep its winding
+                            if(prev_count > 0) {
+                                join_prev = true;
+                                list_elements.push_back(0);
+                                if(prev_count%2 != 0) {
+                                    list_elements.push_back(0);
+                                }
+                            }
+                            for(uint i=0; i < count; i++) {
+                                list_elements.push_back(i);
+                            }
+                            break;
+                        }
+                        case gl::Primitive::TriangleFan:
+                        {
+                            for(uint i=1; i+1 < count; i++) {
+                                list_elements.push_back(0);
+                                list_elements.push_back(i);
+                                list_elements.push_back(i+1);
+                            }
+                            break;
+                        }
+                        case gl::Primitive::LineStrip:
+                        case gl::Primitive::LineLoop:
+                        {
+                            for(uint i=0; i+1 < count; i++) {
+                                list_elements.push_back(i);
+                                list_elements.push_back(i+1);
+                            }
+                            if(primitive == gl::Primitive::LineLoop && count > 1) {
+                                list_elements.push_back(count-1);
+                                list_elements.push_back(0);
+                            }
+                            break;
+                        }
+                        default:
+                        {
+                            for(uint i=0; i < count; i++) {
+                                list_elements.push_back(i);
+                            }
+                            break;
+                        }
+                    }
+                }
+
+                template<typename IndexType>
+                void AppendConvertedIndices(std::vector<u8> const &single_ix_data,
+                                            std::vector<uint> const &list_elements,
+                                            bool join_prev,
+                                            IndexType vx_offset,
+                                            std::vector<u8>& merged_ix_data)
+                {
+                    IndexType const * single_ix_ptr =
+                            reinterpret_cast<IndexType const *>(
+                                single_ix_data.data());
+
+                    auto const prev_size = merged_ix_data.size();
+
+                    merged_ix_data.resize(
+                                prev_size+
+                                (list_elements.size()+(join_prev ? 1 : 0))*
+                                sizeof(IndexType));
+
+                    IndexType* ix_ptr =
+                            reinterpret_cast<IndexType*>(
+                                merged_ix_data.data()+prev_size);
+
+                    if(join_prev) {
+                        *ix_ptr = *(ix_ptr-1);
+                        ix_ptr++;
+                    }
+
+                    for(auto const element : list_elements) {
+                        *ix_ptr = single_ix_ptr[element]+vx_offset;
+                        ix_ptr++;
+                    }
+                }
+
+                void AppendConvertedGeometry(BufferLayout const * buffer_layout,
+                                             Geometry const &single_gm,
+                                             Geometry* merged_gm,
+                                             gl::Primitive primitive,
+                                             std::vector<uint>& list_elements)
+                {
+                    auto const vx_buff_count =
+                            buffer_layout->GetVertexBufferCount();
+
+                    uint const vx_count =
+                            merged_gm->GetVertexBuffer(0)->size()/
+                            buffer_layout->GetVertexSizeBytes(0);
+
+                    bool join_prev;
+
+                    if(buffer_layout->GetIsIndexed())
+                    {
+                        // Vertices are appended as is and only
+                        // the indices are converted
+                        for(uint index=0; index < vx_buff_count; index++)
+                        {
+                            auto const &single_vx_data = single_gm.GetVertexBuffer(index);
+                            auto& merged_vx_data = merged_gm->GetVertexBuffer(index);
+
+                            merged_vx_data->insert(
+                                        merged_vx_data->end(),
+                                        single_vx_data->begin(),
+                                        single_vx_data->end());
+                        }
+
+                        auto const ix_size_bytes = buffer_layout->GetIndexSizeBytes();
+                        auto const &single_ix_data = *(single_gm.GetIndexBuffer());
+                        auto& merged_ix_data = *(merged_gm->GetIndexBuffer());
+
+                        CreateMergedElementList(
+                                    primitive,
+                                    single_ix_data.size()/ix_size_bytes,
+                                    merged_ix_data.size()/ix_size_bytes,
+                                    list_elements,
+                                    join_prev);
+
+                        if(buffer_layout->GetIndexType() == IndexType::UInt32) {
+                            AppendConvertedIndices<u32>(
+                                        single_ix_data,list_elements,join_prev,
+                                        vx_count,merged_ix_data);
+                        }
+                        else {
+                            AppendConvertedIndices<u16>(
+                                        single_ix_data,list_elements,join_prev,
+                                        static_cast<u16>(vx_count),merged_ix_data);
+                        }
+
+                        return;
+                    }
+
+                    // Without indices, vertices are duplicated instead
+                    CreateMergedElementList(
+                                primitive,
+                                single_gm.GetVertexBuffer(0)->size()/
+                                buffer_layout->GetVertexSizeBytes(0),
+                                vx_count,
+                                list_elements,
+                                join_prev);
+
+                    for(uint index=0; index < vx_buff_count; index++)
+                    {
+                        auto const vx_size_bytes = buffer_layout->GetVertexSizeBytes(index);
+                        auto const &single_vx_data = *(single_gm.GetVertexBuffer(index));
+                        auto& merged_vx_data = *(merged_gm->GetVertexBuffer(index));
+
+                        auto const prev_size = merged_vx_data.size();
+
+                        merged_vx_data.resize(
+                                    prev_size+
+                                    (list_elements.size()+(join_prev ? 1 : 0))*
+                                    vx_size_bytes);
+
+                        u8* vx_ptr = merged_vx_data.data()+prev_size;
+
+                        if(join_prev) {
+                            std::copy(vx_ptr-vx_size_bytes,vx_ptr,vx_ptr);
+                            vx_ptr += vx_size_bytes;
+                        }
+
+                        for(auto const element : list_elements) {
+                            auto const src = single_vx_data.begin()+element*vx_size_bytes;
+                            std::copy(src,src+vx_size_bytes,vx_ptr);
+                            vx_ptr += vx_size_bytes;
+                        }
+                    }
+                }
+            }
+
+            // ============================================================= //
+
             void CreateMergedGeometry(BufferLayout const * buffer_layout,
                                       std::vector<Geometry*> &list_single_gm,
-                                      Geometry* merged_gm)
+                                      Geometry* merged_gm,
+                                      gl::Primitive primitive)
             {
-                std::vector<u16> list_single_gm_vx_counts(
+                if(!GetIsListPrimitive(primitive))
+                {
+                    auto const vx_buff_count =
+                            buffer_layout->GetVertexBufferCount();
+
+                    bool const indexed = buffer_layout->GetIsIndexed();
+
+                    // Sizes are found up front as with lists (but they
+                    // may be slightly more than what's needed for strips)
+                    std::size_t merged_vx_size=0;
+                    std::size_t merged_ix_size=0;
+                    for(auto single_gm : list_single_gm)
+                    {
+                        auto const sizes =
+                                GetMergedSizeBytes(
+                                    buffer_layout,primitive,*single_gm);
+
+                        merged_vx_size += sizes.first;
+                        merged_ix_size += sizes.second;
+                    }
+
+                    for(uint index=0; index < vx_buff_count; index++)
+                    {
+                        auto& merged_vx_data = merged_gm->GetVertexBuffer(index);
+                        merged_vx_data->clear();
+                        merged_vx_data->reserve(
+                                    merged_vx_size/buffer_layout->GetVertexSizeBytes(0)*
+                                    buffer_layout->GetVertexSizeBytes(index));
+                    }
+
+                    if(indexed)
+                    {
+                        merged_gm->GetIndexBuffer()->clear();
+                        merged_gm->GetIndexBuffer()->reserve(merged_ix_size);
+                    }
+
+                    std::vector<uint> list_elements;
+                    for(auto single_gm : list_single_gm)
+                    {
+                        AppendConvertedGeometry(
+                                    buffer_layout,
+                                    *single_gm,
+                                    merged_gm,
+                                    primitive,
+                                    list_elements);
+                    }
+
+                    return;
+                }
+
+                std::vector<uint> list_single_gm_vx_counts(
                             list_single_gm.size());
 
                 auto const vx_buff_count =
                         buffer_layout->GetVertexBufferCount();
 
-                // VertexBuffers
-                for(uint index=0; index < vx_buff_count; index++)
+                // The merged sizes are found first so each merged
+                // buffer is allocated at most once. Merged buffers
+                // that are reused (SingleFrame batch groups merge
+                // into the same RenderData each time) keep their
+                // capacity and usually don't allocate at all
+
+                // VertexBuffers
+                for(uint index=0; index < vx_buff_count; index++)
+                {
+                    auto const vx_size_bytes =
+                            buffer_layout->GetVertexSizeBytes(index);
+
+                    std::size_t merged_vx_size=0;
+                    for(auto single_gm : list_single_gm)
+                    {
+                        merged_vx_size += single_gm->GetVertexBuffer(index)->size();
+                    }
+
+                    auto& merged_vx_data = merged_gm->GetVertexBuffer(index);
+                    merged_vx_data->clear();
+                    merged_vx_data->reserve(merged_vx_size);
+
+                    for(uint i=0; i < list_single_gm.size(); i++)
+                    {
+                        auto single_gm = list_single_gm[i];
+                        auto const & single_vx_data = single_gm->GetVertexBuffer(index);
+
+                        list_single_gm_vx_counts[i] =
+                                single_vx_data->size()/
+                                vx_size_bytes;
+
+                        merged_vx_data->insert(
+                                    merged_vx_data->end(),
+                                    single_vx_data->begin(),
+                                    single_vx_data->end());
+                    }
+                }
+
+                // IndexBuffer
+                if(buffer_layout->GetIsIndexed())
+                {
+                    std::size_t merged_ix_size=0;
+                    for(auto single_gm : list_single_gm)
+                    {
+                        merged_ix_size += single_gm->GetIndexBuffer()->size();
+                    }
+
+                    auto& merged_ix_data = merged_gm->GetIndexBuffer();
+                    merged_ix_data->clear();
+                    merged_ix_data->reserve(merged_ix_size);
+
+                    bool const ix_u32 =
+                            (buffer_layout->GetIndexType() == IndexType::UInt32);
+
+                    uint const ix_size_bytes =
+                            buffer_layout->GetIndexSizeBytes();
+
+                    // Merge single geometry ix data
+                    uint vx_count=0;
+                    for(uint i=0; i < list_single_gm.size(); i++)
+                    {
+                        auto single_gm = list_single_gm[i];
+                        auto const & single_ix_data = single_gm->GetIndexBuffer();
+
+                        auto const ix_data_offset = merged_ix_data->size();
+
+                        merged_ix_data->insert(
+                                    merged_ix_data->end(),
+                                    single_ix_data->begin(),
+                                    single_ix_data->end());
+
+                        u8* ix_ptr = merged_ix_data->data()+ix_data_offset;
+                        uint const ix_count = single_ix_data->size()/ix_size_bytes;
+
+                        // Increment indices by the vertex count
+                        if(ix_u32) {
+                            IncrementListIx(
+                                        reinterpret_cast<u32*>(ix_ptr),
+                                        ix_count,vx_count);
+                        }
+                        else {
+                            IncrementListIx(
+                                        reinterpret_cast<u16*>(ix_ptr),
+                                        ix_count,static_cast<u16>(vx_count));
+                        }
+
+                        vx_count += list_single_gm_vx_counts[i];
+                    }
+                }
+            }
+
+            void CreateMergedGeometryRanges(BufferLayout const * buffer_layout,
+                                            std::vector<Geometry*> const &list_single_gm,
+                                            std::vector<Id> const &list_single_ent_ids,
+                                            Id merged_ent_id,
+                                            MergedGeometryRangeLookup& lkup_ranges)
+            {
+                auto const vx_size_bytes = buffer_layout->GetVertexSizeBytes(0);
+                bool const indexed = buffer_layout->GetIsIndexed();
+
+                uint vx_offset = 0;
+                uint ix_offset_bytes = 0;
+
+                for(uint i=0; i < list_single_gm.size(); i++)
+                {
+                    auto single_gm = list_single_gm[i];
+
+                    MergedGeometryRange range;
+                    range.merged_ent_id = merged_ent_id;
+                    range.vx_offset = vx_offset;
+                    range.vx_count = single_gm->GetVertexBuffer(0)->size()/vx_size_bytes;
+                    range.ix_offset_bytes = ix_offset_bytes;
+                    range.ix_size_bytes = indexed ? single_gm->GetIndexBuffer()->size() : 0;
+
+                    lkup_ranges[list_single_ent_ids[i]] = range;
+
+                    vx_offset += range.vx_count;
+                    ix_offset_bytes += range.ix_size_bytes;
+                }
+            }
+
+            bool GetCanPatchMergedGeometry(BufferLayout const * buffer_layout,
+                                           Geometry const &single_gm,
+                                           MergedGeometryRange const &range,
+                                           Geometry const &merged_gm)
+            {
+                auto const vx_buff_count = buffer_layout->GetVertexBufferCount();
+
+                if(single_gm.GetVertexBuffers().size() != vx_buff_count ||
+                   merged_gm.GetVertexBuffers().size() != vx_buff_count)
+                {
+                    return false;
+                }
+
+                for(uint i=0; i < vx_buff_count; i++)
+                {
+                    auto const vx_size_bytes = buffer_layout->GetVertexSizeBytes(i);
+                    auto const &vx_data = single_gm.GetVertexBuffer(i);
+                    auto const &merged_vx_data = merged_gm.GetVertexBuffer(i);
+
+                    if(!vx_data || vx_data->size() != range.vx_count*vx_size_bytes)
+                    {
+                        return false;
+                    }
+
+                    if(!merged_vx_data || merged_vx_data->size() <
+                       (range.vx_offset+range.vx_count)*vx_size_bytes)
+                    {
+                        return false;
+                    }
+                }
+
+                if(buffer_layout->GetIsIndexed())
+                {
+                    auto const &ix_data = single_gm.GetIndexBuffer();
+                    auto const &merged_ix_data = merged_gm.GetIndexBuffer();
+
+                    if(!ix_data || ix_data->size() != range.ix_size_bytes)
+                    {
+                        return false;
+                    }
+
+                    if(!merged_ix_data || merged_ix_data->size() <
+                       range.ix_offset_bytes+range.ix_size_bytes)
+                    {
+                        return false;
+                    }
+                }
+
+                return true;
+            }
+
+            void PatchMergedGeometry(BufferLayout const * buffer_layout,
+                                     Geometry const &single_gm,
+                                     MergedGeometryRange const &range,
+                                     Geometry* merged_gm)
+            {
+                bool const upd_all = !single_gm.GetUpdatedGeometry();
+
+                // VertexBuffers
+                auto const vx_buff_count = buffer_layout->GetVertexBufferCount();
+                for(uint index=0; index < vx_buff_count; index++)
+                {
+                    auto const &list_upd_vx = single_gm.GetUpdatedVertexBuffers();
+                    if(!upd_all && std::find(list_upd_vx.begin(),
+                                             list_upd_vx.end(),
+                                             index) == list_upd_vx.end())
+                    {
+                        continue;
+                    }
+
+                    auto const vx_size_bytes = buffer_layout->GetVertexSizeBytes(index);
+                    auto const start_byte = range.vx_offset*vx_size_bytes;
+                    auto const &single_vx_data = *(single_gm.GetVertexBuffer(index));
+
+                    std::copy(single_vx_data.begin(),
+                              single_vx_data.end(),
+                              merged_gm->GetVertexBuffer(index)->begin()+start_byte);
+
+                    merged_gm->SetVertexBufferRangeUpdated(
+                                index,start_byte,single_vx_data.size());
+                }
+
+                // IndexBuffer
+                if(buffer_layout->GetIsIndexed() &&
+                   (upd_all || single_gm.GetUpdatedIndexBuffer()))
+                {
+                    auto const &single_ix_data = *(single_gm.GetIndexBuffer());
+
+                    u8* ix_ptr =
+                            merged_gm->GetIndexBuffer()->data()+
+                            range.ix_offset_bytes;
+
+                    std::copy(single_ix_data.begin(),
+                              single_ix_data.end(),
+                              ix_ptr);
+
+                    uint const ix_count =
+                            range.ix_size_bytes/
+                            buffer_layout->GetIndexSizeBytes();
+
+                    if(buffer_layout->GetIndexType() == IndexType::UInt32) {
+                        IncrementListIx(
+                                    reinterpret_cast<u32*>(ix_ptr),
+                                    ix_count,range.vx_offset);
+                    }
+                    else {
+                        IncrementListIx(
+                                    reinterpret_cast<u16*>(ix_ptr),
+                                    ix_count,static_cast<u16>(range.vx_offset));
+                    }
+
+                    merged_gm->SetIndexBufferRangeUpdated(
+                                range.ix_offset_bytes,range.ix_size_bytes);
+                }
+            }
+
+            // ============================================================= //
+
+            namespace
+            {
+                // * Single geometry can be larger than a block since it
+                //   gets a dedicated buffer, but UInt16 indices can't
+                //   address more than 65536 vertices
+                void CheckMergedVertexCount(BufferLayout const * buffer_layout,
+                                            uint vx_size_bytes)
+                {
+                    if(buffer_layout->GetIsIndexed() &&
+                       (buffer_layout->GetIndexType() == IndexType::UInt16) &&
+                       (vx_size_bytes > 65536*buffer_layout->GetVertexSizeBytes(0)))
+                    {
+                        throw ks::Exception(
+                                    ks::Exception::ErrorLevel::ERROR,
+                                    "BatchSystem: Geometry has more vertices "
+                                    "than UInt16 indices can address");
+                    }
+                }
+
+                BatchPackingStats CreatePackingStats(uint merged_count,
+                                                     uint vx_block_size,
+                                                     uint ix_block_size,
+                                                     u64 vx_size_bytes,
+                                                     u64 ix_size_bytes)
+                {
+                    BatchPackingStats stats;
+                    stats.merged_count = merged_count;
+                    stats.vx_size_bytes = vx_size_bytes;
+                    stats.vx_capacity_bytes = u64(merged_count)*vx_block_size;
+                    stats.ix_size_bytes = ix_size_bytes;
+                    stats.ix_capacity_bytes = u64(merged_count)*ix_block_size;
+
+                    u64 min_merged_count =
+                            (vx_size_bytes + vx_block_size - 1)/vx_block_size;
+
+                    if(ix_block_size > 0)
+                    {
+                        min_merged_count = std::max<u64>(
+                                    min_merged_count,
+                                    (ix_size_bytes + ix_block_size - 1)/ix_block_size);
+                    }
+
+                    stats.min_merged_count = min_merged_count;
+
+                    return stats;
+                }
+
+                // * The fraction of a block's capacity left unused after
+                //   adding vx_size and ix_size; lower is a better fit
+                float GetPackingResidual(uint vx_block_size,
+                                         uint ix_block_size,
+                                         uint vx_used,
+                                         uint ix_used)
+                {
+                    float residual =
+                            float(vx_block_size - vx_used)/vx_block_size;
+
+                    if(ix_block_size > 0)
+                    {
+                        residual += float(ix_block_size - ix_used)/ix_block_size;
+                    }
+
+                    return residual;
+                }
+            }
+
+            // ============================================================= //
+
+            std::vector<std::vector<uint>>
+            CreateSplitSingleGeometryIxLists(
+                    BufferLayout const * buffer_layout,
+                    std::vector<Geometry*> const &list_single_gm_all,
+                    PackingPolicy packing_policy,
+                    BatchPackingStats* packing_stats,
+                    gl::Primitive primitive)
+            {
+                // For each batch group, we have N RenderDatas to represent
+                // the merged geometries. A single geometry is assigned to
+                // a RenderData if neither the VertexBuffer nor IndexBuffer
+                // block size is exceeded by adding it, otherwise a new
+                // RenderData is created.
+
+                std::vector<std::vector<uint>> list_list_single_gm_ix;
+
+                bool const indexed = buffer_layout->GetIsIndexed();
+
+                uint const vx_block_size =
+                        GetMergedVertexBufferLimit(buffer_layout);
+
+                uint const ix_block_size =
+                        (indexed) ?
+                            buffer_layout->GetIndexBufferAllocator()->
+                            GetBlockSize() : 0;
+
+                // <vx size bytes, ix size bytes> for each single geometry
+                std::vector<std::pair<uint,uint>> list_gm_sizes;
+                list_gm_sizes.reserve(list_single_gm_all.size());
+
+                u64 vx_size_bytes=0;
+                u64 ix_size_bytes=0;
+
+                for(auto single_gm : list_single_gm_all)
+                {
+                    auto const single_gm_sizes =
+                            GetMergedSizeBytes(
+                                buffer_layout,primitive,*single_gm);
+
+                    uint const single_gm_vxbuff_size = single_gm_sizes.first;
+                    uint const single_gm_ixbuff_size = single_gm_sizes.second;
+
+                    // A single geometry larger than a block doesn't fit
+                    // with any other so it gets its own merged geometry,
+                    // which is placed in a dedicated buffer
+                    CheckMergedVertexCount(buffer_layout,single_gm_vxbuff_size);
+
+                    list_gm_sizes.emplace_back(
+                                single_gm_vxbuff_size,
+                                single_gm_ixbuff_size);
+
+                    vx_size_bytes += single_gm_vxbuff_size;
+                    ix_size_bytes += single_gm_ixbuff_size;
+                }
+
+                // Decreasing policies place the largest single
+                // geometries (relative to the block sizes) first
+                std::vector<uint> list_gm_order(list_single_gm_all.size());
+                for(uint i=0; i < list_gm_order.size(); i++)
+                {
+                    list_gm_order[i] = i;
+                }
+
+                if(packing_policy != PackingPolicy::Sequential)
+                {
+                    std::vector<float> list_gm_weights(list_gm_sizes.size());
+                    for(uint i=0; i < list_gm_sizes.size(); i++)
+                    {
+                        list_gm_weights[i] =
+                                float(list_gm_sizes[i].first)/vx_block_size;
+
+                        if(ix_block_size > 0)
+                        {
+                            list_gm_weights[i] = std::max(
+                                        list_gm_weights[i],
+                                        float(list_gm_sizes[i].second)/ix_block_size);
+                        }
+                    }
+
+                    std::stable_sort(
+                                list_gm_order.begin(),
+                                list_gm_order.end(),
+                                [&](uint a, uint b) {
+                                    return (list_gm_weights[a] > list_gm_weights[b]);
+                                });
+                }
+
+                // <vx block used, ix block used> for each merged geometry
+                std::vector<std::pair<uint,uint>> list_block_used;
+
+                for(auto const gm_idx : list_gm_order)
+                {
+                    uint const vx_size = list_gm_sizes[gm_idx].first;
+                    uint const ix_size = list_gm_sizes[gm_idx].second;
+
+                    auto fits = [&](std::pair<uint,uint> const &block_used) {
+                        return ((block_used.first + vx_size <= vx_block_size) &&
+                                (block_used.second + ix_size <= ix_block_size));
+                    };
+
+                    uint render_data_idx = list_block_used.size();
+
+                    if(packing_policy == PackingPolicy::Sequential)
+                    {
+                        if(!list_block_used.empty() &&
+                           fits(list_block_used.back()))
+                        {
+                            render_data_idx = list_block_used.size()-1;
+                        }
+                    }
+                    else if(packing_policy == PackingPolicy::FirstFitDecreasing)
+                    {
+                        for(uint i=0; i < list_block_used.size(); i++)
+                        {
+                            if(fits(list_block_used[i]))
+                            {
+                                render_data_idx = i;
+                                break;
+                            }
+                        }
+                    }
+                    else
+                    {
+                        float min_residual = std::numeric_limits<float>::max();
+
+                        for(uint i=0; i < list_block_used.size(); i++)
+                        {
+                            if(!fits(list_block_used[i]))
+                            {
+                                continue;
+                            }
+
+                            float const residual =
+                                    GetPackingResidual(
+                                        vx_block_size,
+                                        ix_block_size,
+                                        list_block_used[i].first + vx_size,
+                                        list_block_used[i].second + ix_size);
+
+                            if(residual < min_residual)
+                            {
+                                min_residual = residual;
+                                render_data_idx = i;
+                            }
+                        }
+                    }
+
+                    if(render_data_idx == list_block_used.size())
+                    {
+                        // Create a new single geometry list
+                        list_block_used.emplace_back(0,0);
+                        list_list_single_gm_ix.emplace_back();
+                    }
+
+                    list_block_used[render_data_idx].first += vx_size;
+                    list_block_used[render_data_idx].second += ix_size;
+                    list_list_single_gm_ix[render_data_idx].push_back(gm_idx);
+                }
+
+                // Keep the original order within each merged geometry
+                if(packing_policy != PackingPolicy::Sequential)
+                {
+                    for(auto& list_single_gm_ix : list_list_single_gm_ix)
+                    {
+                        std::sort(list_single_gm_ix.begin(),
+                                  list_single_gm_ix.end());
+                    }
+                }
+
+                if(packing_stats)
+                {
+                    *packing_stats =
+                            CreatePackingStats(
+                                list_list_single_gm_ix.size(),
+                                vx_block_size,
+                                ix_block_size,
+                                vx_size_bytes,
+                                ix_size_bytes);
+                }
+
+                return list_list_single_gm_ix;
+            }
+
+            // ============================================================= //
+
+            std::vector<std::vector<Geometry*>>
+            CreateSplitSingleGeometryLists(
+                    BufferLayout const * buffer_layout,
+                    std::vector<Geometry*> const &list_single_gm_all)
+            {
+                return CreateSplitLists(
+                            list_single_gm_all,
+                            CreateSplitSingleGeometryIxLists(
+                                buffer_layout,
+                                list_single_gm_all,
+                                PackingPolicy::Sequential));
+            }
+
+            // ============================================================= //
+
+            void InitMergedGeometry(BufferLayout const * buffer_layout,
+                                    Geometry* merged_gm)
+            {
+                auto const vx_buff_count =
+                        buffer_layout->GetVertexBufferCount();
+
+                for(uint k=0; k < vx_buff_count; k++)
+                {
+                    merged_gm->GetVertexBuffers().push_back(
+                                make_unique<std::vector<u8>>());
+                }
+                if(buffer_layout->GetIsIndexed())
+                {
+                    merged_gm->GetIndexBuffer() =
+                            make_unique<std::vector<u8>>();
+                }
+            }
+
+            void AppendMergedGeometry(BufferLayout const * buffer_layout,
+                                      Geometry const &single_gm,
+                                      Geometry* merged_gm,
+                                      gl::Primitive primitive)
+            {
+                if(!GetIsListPrimitive(primitive))
+                {
+                    std::vector<uint> list_elements;
+                    AppendConvertedGeometry(
+                                buffer_layout,
+                                single_gm,
+                                merged_gm,
+                                primitive,
+                                list_elements);
+                    return;
+                }
+
+                uint const vx_count =
+                        merged_gm->GetVertexBuffer(0)->size()/
+                        buffer_layout->GetVertexSizeBytes(0);
+
+                // VertexBuffers
+                auto const vx_buff_count =
+                        buffer_layout->GetVertexBufferCount();
+
+                for(uint index=0; index < vx_buff_count; index++)
+                {
+                    auto const &single_vx_data = single_gm.GetVertexBuffer(index);
+                    auto& merged_vx_data = merged_gm->GetVertexBuffer(index);
+
+                    merged_vx_data->insert(
+                                merged_vx_data->end(),
+                                single_vx_data->begin(),
+                                single_vx_data->end());
+                }
+
+                // IndexBuffer
+                if(buffer_layout->GetIsIndexed())
+                {
+                    auto const &single_ix_data = single_gm.GetIndexBuffer();
+                    auto& merged_ix_data = merged_gm->GetIndexBuffer();
+
+                    auto const ix_data_offset = merged_ix_data->size();
+
+                    merged_ix_data->insert(
+                                merged_ix_data->end(),
+                                single_ix_data->begin(),
+                                single_ix_data->end());
+
+                    u8* ix_ptr = merged_ix_data->data()+ix_data_offset;
+                    uint const ix_count =
+                            single_ix_data->size()/
+                            buffer_layout->GetIndexSizeBytes();
+
+                    if(buffer_layout->GetIndexType() == IndexType::UInt32) {
+                        IncrementListIx(
+                                    reinterpret_cast<u32*>(ix_ptr),
+                                    ix_count,vx_count);
+                    }
+                    else {
+                        IncrementListIx(
+                                    reinterpret_cast<u16*>(ix_ptr),
+                                    ix_count,static_cast<u16>(vx_count));
+                    }
+                }
+            }
+
+            // ============================================================= //
+            // ============================================================= //
+
+            BatchChunkList::BatchChunkList(BufferLayout const * buffer_layout,
+                                           PackingPolicy packing_policy,
+                                           gl::Primitive primitive) :
+                m_buffer_layout(buffer_layout),
+                m_packing_policy(packing_policy),
+                m_primitive(primitive),
+                m_vx_block_size(
+                    GetMergedVertexBufferLimit(buffer_layout)),
+                m_ix_block_size(
+                    buffer_layout->GetIsIndexed() ?
+                        buffer_layout->GetIndexBufferAllocator()->
+                        GetBlockSize() : 0)
+            {
+
+            }
+
+            std::vector<BatchChunkList::Chunk>&
+            BatchChunkList::GetChunks()
+            {
+                return m_list_chunks;
+            }
+
+            BatchPackingStats BatchChunkList::GetPackingStats() const
+            {
+                u64 vx_size_bytes=0;
+                u64 ix_size_bytes=0;
+
+                for(auto const &chunk : m_list_chunks)
+                {
+                    vx_size_bytes += chunk.vx_size_bytes;
+                    ix_size_bytes += chunk.ix_size_bytes;
+                }
+
+                return CreatePackingStats(
+                            m_list_chunks.size(),
+                            m_vx_block_size,
+                            m_ix_block_size,
+                            vx_size_bytes,
+                            ix_size_bytes);
+            }
+
+            void BatchChunkList::Remove(Id ent_id)
+            {
+                auto it = m_lkup_ent_chunk.find(ent_id);
+                if(it == m_lkup_ent_chunk.end())
+                {
+                    return;
+                }
+
+                auto const chunk_idx = it->second;
+                auto& chunk = m_list_chunks[chunk_idx];
+
+                for(uint i=0; i < chunk.list_ent_ids.size(); i++)
+                {
+                    if(chunk.list_ent_ids[i] == ent_id)
+                    {
+                        removeFromChunk(chunk_idx,i);
+                        break;
+                    }
+                }
+
+                m_lkup_ent_chunk.erase(it);
+            }
+
+            void BatchChunkList::Update(Id ent_id, Geometry const &single_gm)
+            {
+                auto const sizes =
+                        GetMergedSizeBytes(
+                            m_buffer_layout,m_primitive,single_gm);
+
+                uint const vx_size = sizes.first;
+                uint const ix_size = sizes.second;
+
+                CheckMergedVertexCount(m_buffer_layout,vx_size);
+
+                auto it = m_lkup_ent_chunk.find(ent_id);
+                if(it != m_lkup_ent_chunk.end())
                 {
-                    auto const vx_size_bytes =
-                            buffer_layout->GetVertexSizeBytes(index);
+                    // Keep the entity in its current chunk if
+                    // the updated geometry still fits
+                    auto const chunk_idx = it->second;
+                    auto& chunk = m_list_chunks[chunk_idx];
 
-                    auto& merged_vx_data = merged_gm->GetVertexBuffer(index);
-                    merged_vx_data->clear();
+                    uint ent_idx=0;
+                    while(chunk.list_ent_ids[ent_idx] != ent_id)
+                    {
+                        ent_idx++;
+                    }
 
-                    for(uint i=0; i < list_single_gm.size(); i++)
+                    auto& ent_sizes = chunk.list_ent_sizes[ent_idx];
+                    chunk.vx_size_bytes -= ent_sizes.first;
+                    chunk.ix_size_bytes -= ent_sizes.second;
+
+                    // Geometry larger than a block is always alone
+                    // in its chunk and can stay there
+                    if(fits(chunk,vx_size,ix_size) ||
+                       chunk.list_ent_ids.size() == 1)
                     {
-                        auto single_gm = list_single_gm[i];
-                        auto const & single_vx_data = single_gm->GetVertexBuffer(index);
+                        chunk.vx_size_bytes += vx_size;
+                        chunk.ix_size_bytes += ix_size;
+                        ent_sizes = std::make_pair(vx_size,ix_size);
+                        chunk.dirty = true;
+                        return;
+                    }
 
-                        list_single_gm_vx_counts[i] =
-                                single_vx_data->size()/
-                                vx_size_bytes;
+                    // Otherwise move it to another chunk
+                    chunk.vx_size_bytes += ent_sizes.first;
+                    chunk.ix_size_bytes += ent_sizes.second;
+                    removeFromChunk(chunk_idx,ent_idx);
+                    m_lkup_ent_chunk.erase(it);
+                }
 
-                        merged_vx_data->insert(
-                                    merged_vx_data->end(),
-                                    single_vx_data->begin(),
-                                    single_vx_data->end());
+                add(ent_id,vx_size,ix_size);
+            }
+
+            std::vector<Id> BatchChunkList::RemoveEmptyChunks()
+            {
+                std::vector<Id> list_merged_ent_ids;
+                uint first_rem_idx = m_list_chunks.size();
+
+                for(uint i=0; i < m_list_chunks.size(); i++)
+                {
+                    if(m_list_chunks[i].list_ent_ids.empty())
+                    {
+                        if(m_list_chunks[i].merged_ent_id > 0)
+                        {
+                            list_merged_ent_ids.push_back(
+                                        m_list_chunks[i].merged_ent_id);
+                        }
+
+                        first_rem_idx = std::min(first_rem_idx,i);
                     }
                 }
 
-                // IndexBuffer
-                if(buffer_layout->GetIsIndexed())
+                if(first_rem_idx == m_list_chunks.size())
                 {
-                    auto& merged_ix_data = merged_gm->GetIndexBuffer();
-                    merged_ix_data->clear();
+                    return list_merged_ent_ids;
+                }
 
-                    // Merge single geometry ix data
-                    u16 vx_count=0;
-                    for(uint i=0; i < list_single_gm.size(); i++)
+                m_list_chunks.erase(
+                            std::remove_if(
+                                m_list_chunks.begin()+first_rem_idx,
+                                m_list_chunks.end(),
+                                [](Chunk const &chunk) {
+                                    return chunk.list_ent_ids.empty();
+                                }),
+                            m_list_chunks.end());
+
+                // Chunks after the first removed one have shifted
+                for(uint i=first_rem_idx; i < m_list_chunks.size(); i++)
+                {
+                    for(auto const ent_id : m_list_chunks[i].list_ent_ids)
                     {
-                        auto single_gm = list_single_gm[i];
-                        auto const & single_ix_data = single_gm->GetIndexBuffer();
+                        m_lkup_ent_chunk[ent_id] = i;
+                    }
+                }
 
-                        auto ix_data_beg =
-                                merged_ix_data->insert(
-                                    merged_ix_data->end(),
-                                    single_ix_data->begin(),
-                                    single_ix_data->end());
+                return list_merged_ent_ids;
+            }
+
+            void BatchChunkList::ClearDirty()
+            {
+                for(auto& chunk : m_list_chunks)
+                {
+                    chunk.dirty = false;
+                }
+            }
 
-                        u16* ix_ptr = reinterpret_cast<u16*>(&(*ix_data_beg));
+            void BatchChunkList::add(Id ent_id, uint vx_size, uint ix_size)
+            {
+                uint chunk_idx = m_list_chunks.size();
 
-                        // Increment indices by the vertex count
-                        IncrementListIx(ix_ptr,single_ix_data->size()/2,vx_count);
-                        vx_count += list_single_gm_vx_counts[i];
+                if(m_packing_policy == PackingPolicy::BestFitDecreasing)
+                {
+                    float min_residual = std::numeric_limits<float>::max();
+
+                    for(uint i=0; i < m_list_chunks.size(); i++)
+                    {
+                        auto const &chunk = m_list_chunks[i];
+                        if(!fits(chunk,vx_size,ix_size))
+                        {
+                            continue;
+                        }
+
+                        float const residual =
+                                GetPackingResidual(
+                                    m_vx_block_size,
+                                    m_ix_block_size,
+                                    chunk.vx_size_bytes + vx_size,
+                                    chunk.ix_size_bytes + ix_size);
+
+                        if(residual < min_residual)
+                        {
+                            min_residual = residual;
+                            chunk_idx = i;
+                        }
                     }
                 }
+                else
+                {
+                    for(uint i=0; i < m_list_chunks.size(); i++)
+                    {
+                        if(fits(m_list_chunks[i],vx_size,ix_size))
+                        {
+                            chunk_idx = i;
+                            break;
+                        }
+                    }
+                }
+
+                if(chunk_idx == m_list_chunks.size())
+                {
+                    m_list_chunks.emplace_back();
+                }
+
+                auto& chunk = m_list_chunks[chunk_idx];
+                chunk.list_ent_ids.push_back(ent_id);
+                chunk.list_ent_sizes.emplace_back(vx_size,ix_size);
+                chunk.vx_size_bytes += vx_size;
+                chunk.ix_size_bytes += ix_size;
+                chunk.dirty = true;
+
+                m_lkup_ent_chunk[ent_id] = chunk_idx;
+            }
+
+            void BatchChunkList::removeFromChunk(uint chunk_idx, uint ent_idx)
+            {
+                auto& chunk = m_list_chunks[chunk_idx];
+                auto const &ent_sizes = chunk.list_ent_sizes[ent_idx];
+
+                chunk.vx_size_bytes -= ent_sizes.first;
+                chunk.ix_size_bytes -= ent_sizes.second;
+                chunk.list_ent_ids.erase(chunk.list_ent_ids.begin()+ent_idx);
+                chunk.list_ent_sizes.erase(chunk.list_ent_sizes.begin()+ent_idx);
+                chunk.dirty = true;
+            }
+
+            bool BatchChunkList::fits(Chunk const &chunk,
+                                      uint vx_size,
+                                      uint ix_size) const
+            {
+                return ((chunk.vx_size_bytes + vx_size <= m_vx_block_size) &&
+                        (chunk.ix_size_bytes + ix_size <= m_ix_block_size));
             }
 
+            // ============================================================= //
             // ============================================================= //
 
-            // * Splits a list of single geometries into N merged
-            //   geometries
-            std::vector<std::vector<Geometry*>>
-            CreateSplitSingleGeometryLists(
-                    BufferLayout const * buffer_layout,
-                    std::vector<Geometry*> const &list_single_gm_all)
+            void CopyGeometryBuffers(Geometry const &from, Geometry& to)
             {
-                // For each batch group, we have N RenderDatas to represent
-                // the merged geometries. A new RenderData is created when
-                // either the VertexBuffer or IndexBuffer block size is
-                // exceeded. Single geometries are assigned to the RenderData
-                // indices they will be merged in accordingly.
+                to.GetVertexBuffers().clear();
 
-                std::vector<std::vector<Geometry*>> list_list_single_gm;
+                for(auto const &vx_data : from.GetVertexBuffers())
+                {
+                    to.GetVertexBuffers().push_back(
+                                make_unique<std::vector<u8>>(*vx_data));
+                }
 
-                if(list_single_gm_all.empty())
+                if(from.GetIndexBuffer())
                 {
-                    return list_list_single_gm;
+                    to.GetIndexBuffer() =
+                            make_unique<std::vector<u8>>(
+                                *(from.GetIndexBuffer()));
                 }
+            }
 
-                uint render_data_idx=0;
-                uint vx_block_used=0;
+            void MoveGeometryBuffers(Geometry& from, Geometry& to)
+            {
+                to.GetVertexBuffers() = std::move(from.GetVertexBuffers());
+                from.GetVertexBuffers().clear();
 
-                uint const vx_block_size =
-                        buffer_layout->GetVertexBufferAllocator(0)->
-                        GetBlockSize();
+                if(from.GetIndexBuffer())
+                {
+                    to.GetIndexBuffer() = std::move(from.GetIndexBuffer());
+                }
+            }
 
-                list_list_single_gm.resize(1);
+            namespace
+            {
+                u64 const k_fnv_offset = 14695981039346656037ull;
+                u64 const k_fnv_prime = 1099511628211ull;
 
-                if(buffer_layout->GetIsIndexed())
+                // * Hashes eight bytes at a time (and the remaining
+                //   bytes one at a time)
+                u64 CalcBufferHash(u64 hash, std::vector<u8> const &data)
                 {
-                    uint const ix_block_size =
-                            buffer_layout->GetIndexBufferAllocator()->
-                            GetBlockSize();
+                    std::size_t i=0;
+                    for(; i+8 <= data.size(); i+=8) {
+                        u64 word;
+                        std::memcpy(&word,data.data()+i,8);
+                        hash ^= word;
+                        hash *= k_fnv_prime;
+                    }
 
-                    uint ix_block_used=0;
+                    for(; i < data.size(); i++) {
+                        hash ^= data[i];
+                        hash *= k_fnv_prime;
+                    }
 
-                    for(auto single_gm : list_single_gm_all)
-                    {
-                        uint const single_gm_vxbuff_size =
-                                single_gm->GetVertexBuffer(0)->size();
+                    // Include the size so buffers split
+                    // differently don't collide
+                    hash ^= data.size();
+                    hash *= k_fnv_prime;
 
-                        uint const single_gm_ixbuff_size =
-                                single_gm->GetIndexBuffer()->size();
+                    return hash;
+                }
 
-                        vx_block_used += single_gm_vxbuff_size;
-                        ix_block_used += single_gm_ixbuff_size;
+                bool GetBufferEqual(UPtrBuffer const &a, UPtrBuffer const &b)
+                {
+                    if(!a || !b) {
+                        return (!a && !b);
+                    }
+                    return (*a == *b);
+                }
+            }
 
-                        if((vx_block_used > vx_block_size) ||
-                           (ix_block_used > ix_block_size))
-                        {
-                            if((vx_block_size < single_gm_vxbuff_size) ||
-                               (ix_block_size < single_gm_ixbuff_size))
-                            {
-                                throw ks::Exception(
-                                            ks::Exception::ErrorLevel::ERROR,
-                                            "BatchSystem: Geometry size exceeds "
-                                            "BufferAllocator block size");
-                            }
+            u64 CalcGeometryHash(Geometry const &gm)
+            {
+                u64 hash = k_fnv_offset;
 
-                            // Create a new single geometry list
-                            list_list_single_gm.emplace_back();
+                for(auto const &vx_data : gm.GetVertexBuffers())
+                {
+                    if(vx_data) {
+                        hash = CalcBufferHash(hash,*vx_data);
+                    }
+                }
 
-                            render_data_idx++;
-                            vx_block_used = single_gm_vxbuff_size;
-                            ix_block_used = single_gm_ixbuff_size;
-                        }
+                if(gm.GetIndexBuffer())
+                {
+                    hash = CalcBufferHash(hash,*(gm.GetIndexBuffer()));
+                }
 
-                        list_list_single_gm[render_data_idx].push_back(single_gm);
-                    }
+                return hash;
+            }
+
+            bool GetGeometryEqual(Geometry const &a, Geometry const &b)
+            {
+                auto const &list_vx_a = a.GetVertexBuffers();
+                auto const &list_vx_b = b.GetVertexBuffers();
+
+                if(list_vx_a.size() != list_vx_b.size())
+                {
+                    return false;
                 }
-                else
+
+                for(uint i=0; i < list_vx_a.size(); i++)
                 {
-                    for(auto single_gm : list_single_gm_all)
+                    if(!GetBufferEqual(list_vx_a[i],list_vx_b[i]))
                     {
-                        uint const single_gm_vxbuff_size =
-                                single_gm->GetVertexBuffer(0)->size();
+                        return false;
+                    }
+                }
 
-                        vx_block_used += single_gm_vxbuff_size;
+                return GetBufferEqual(a.GetIndexBuffer(),b.GetIndexBuffer());
+            }
 
-                        if(vx_block_used > vx_block_size)
-                        {
-                            if(vx_block_size < single_gm_vxbuff_size)
-                            {
-                                throw ks::Exception(
-                                            ks::Exception::ErrorLevel::ERROR,
-                                            "BatchSystem: Geometry size exceeds "
-                                            "BufferAllocator block size");
-                            }
+            // ============================================================= //
 
-                            // Create a new single geometry list
-                            list_list_single_gm.emplace_back();
+            BatchGeometryList::BatchGeometryList(bool dedup) :
+                m_dedup(dedup)
+            {
 
-                            render_data_idx++;
-                            vx_block_used = single_gm_vxbuff_size;
-                        }
+            }
+
+            void BatchGeometryList::SetDedup(bool dedup)
+            {
+                m_dedup = dedup;
+            }
+
+            bool BatchGeometryList::GetDedup() const
+            {
+                return m_dedup;
+            }
+
+            uint BatchGeometryList::GetSize() const
+            {
+                return m_list_geometry.size();
+            }
+
+            void BatchGeometryList::Resize(uint size)
+            {
+                m_list_geometry.resize(size);
+                m_list_shared_idx.resize(size,0);
+                m_list_moved.resize(size,0);
+            }
+
+            Geometry& BatchGeometryList::Get(Id ent_id)
+            {
+                auto const shared_idx = m_list_shared_idx[ent_id];
+                if(shared_idx > 0)
+                {
+                    return m_list_shared[shared_idx-1].geometry;
+                }
+
+                return m_list_geometry[ent_id];
+            }
+
+            bool BatchGeometryList::Copy(Id ent_id, Geometry const &single_gm)
+            {
+                release(ent_id);
+
+                if(!m_dedup)
+                {
+                    CopyGeometryBuffers(single_gm,m_list_geometry[ent_id]);
+                    return false;
+                }
 
-                        list_list_single_gm[render_data_idx].push_back(single_gm);
+                // Look for identical geometry that's already stored
+                auto const hash = CalcGeometryHash(single_gm);
+                auto range = m_lkup_hash_shared.equal_range(hash);
+
+                for(auto it = range.first; it != range.second; ++it)
+                {
+                    auto& shared = m_list_shared[it->second];
+                    if(GetGeometryEqual(shared.geometry,single_gm))
+                    {
+                        shared.ref_count++;
+                        m_list_shared_idx[ent_id] = it->second+1;
+                        return true;
                     }
                 }
 
-                return list_list_single_gm;
+                uint shared_idx;
+                if(m_list_shared_free.empty())
+                {
+                    shared_idx = m_list_shared.size();
+                    m_list_shared.emplace_back();
+                }
+                else
+                {
+                    shared_idx = m_list_shared_free.back();
+                    m_list_shared_free.pop_back();
+                }
+
+                auto& shared = m_list_shared[shared_idx];
+                shared.hash = hash;
+                shared.ref_count = 1;
+                CopyGeometryBuffers(single_gm,shared.geometry);
+
+                m_lkup_hash_shared.emplace(hash,shared_idx);
+                m_list_shared_idx[ent_id] = shared_idx+1;
+
+                return false;
             }
 
-            // ============================================================= //
+            void BatchGeometryList::Move(Id ent_id, Geometry& single_gm)
+            {
+                release(ent_id);
+                MoveGeometryBuffers(single_gm,m_list_geometry[ent_id]);
+                m_list_moved[ent_id] = 1;
+            }
+
+            bool BatchGeometryList::GetMoved(Id ent_id) const
+            {
+                return (m_list_moved[ent_id] != 0);
+            }
+
+            void BatchGeometryList::Remove(Id ent_id)
+            {
+                release(ent_id);
+            }
 
-            std::vector<std::vector<Id>>
-            CreateSplitSingleGmEntIdLists(
-                    std::vector<Id> const &list_all_single_gm_ent_ids,
-                    std::vector<std::vector<Geometry*>> const &list_list_single_gms)
+            uint BatchGeometryList::GetSharedCount() const
             {
-                std::vector<std::vector<Id>> list_list_single_gm_ent_ids(
-                            list_list_single_gms.size());
+                uint shared_count=0;
+                for(auto const &shared : m_list_shared)
+                {
+                    if(shared.ref_count > 1)
+                    {
+                        shared_count++;
+                    }
+                }
 
-                uint index=0;
+                return shared_count;
+            }
+
+            void BatchGeometryList::release(Id ent_id)
+            {
+                auto& geometry = m_list_geometry[ent_id];
+                geometry.GetVertexBuffers().clear();
+                geometry.GetIndexBuffer().reset();
+                m_list_moved[ent_id] = 0;
 
-                for(uint i=0; i < list_list_single_gm_ent_ids.size(); i++)
+                auto const shared_idx = m_list_shared_idx[ent_id];
+                if(shared_idx == 0)
                 {
-                    auto const gm_count = list_list_single_gms[i].size();
+                    return;
+                }
 
-                    auto& list_single_gm_ent_ids = list_list_single_gm_ent_ids[i];
-                    list_single_gm_ent_ids.resize(gm_count);
+                m_list_shared_idx[ent_id] = 0;
 
-                    for(uint j=0; j < gm_count; j++)
-                    {
-                        list_single_gm_ent_ids[j] =
-                                list_all_single_gm_ent_ids[index];
+                auto& shared = m_list_shared[shared_idx-1];
+                shared.ref_count--;
+
+                if(shared.ref_count > 0)
+                {
+                    return;
+                }
 
-                        index++;
+                auto range = m_lkup_hash_shared.equal_range(shared.hash);
+                for(auto it = range.first; it != range.second; ++it)
+                {
+                    if(it->second == shared_idx-1)
+                    {
+                        m_lkup_hash_shared.erase(it);
+                        break;
                     }
                 }
 
-                return list_list_single_gm_ent_ids;
+                shared.geometry.GetVertexBuffers().clear();
+                shared.geometry.GetIndexBuffer().reset();
+                m_list_shared_free.push_back(shared_idx-1);
             }
 
             // ============================================================= //
             // ============================================================= //
 
             BatchTask::BatchTask(unique_ptr<std::vector<BatchDesc>> list_batch_desc,
-                                 std::vector<Geometry>& list_batch_geometry,
+                                 BatchGeometryList& list_batch_geometry,
                                  BatchPreMergeCallback pre_merge_callback) :
                 m_list_batch_desc(std::move(list_batch_desc)),
                 m_list_batch_geometry(list_batch_geometry),
-                m_pre_merge_callback(std::move(pre_merge_callback))
+                m_pre_merge_callback(std::move(pre_merge_callback)),
+                m_cancelled(false),
+                m_time_created(std::chrono::steady_clock::now()),
+                m_queue_ms(0),
+                m_process_ms(0)
             {
 
             }
@@ -261,10 +1640,39 @@ namespace ks
                 return m_list_proc_data[index].list_list_single_gm_ent_ids;
             }
 
+            BatchPackingStats const & BatchTask::GetPackingStats(uint index) const
+            {
+                return m_list_proc_data[index].packing_stats;
+            }
+
+            double BatchTask::GetMergeMs(uint index) const
+            {
+                return m_list_proc_data[index].merge_ms;
+            }
+
+            u64 BatchTask::GetMergedBytes(uint index) const
+            {
+                return m_list_proc_data[index].merged_bytes;
+            }
+
+            double BatchTask::GetQueueMs() const
+            {
+                return m_queue_ms;
+            }
+
+            double BatchTask::GetProcessMs() const
+            {
+                return m_process_ms;
+            }
+
             void BatchTask::Cancel()
             {
-                // TODO Cancel not supported, maybe
-                // throw an exception here?
+                m_cancelled = true;
+            }
+
+            bool BatchTask::IsCancelled() const
+            {
+                return m_cancelled;
             }
 
             void BatchTask::Process()
@@ -279,6 +1687,11 @@ namespace ks
                 }
                 this->onStarted();
 
+                auto const time_started = std::chrono::steady_clock::now();
+                m_queue_ms = std::chrono::duration_cast<
+                        std::chrono::microseconds>(
+                            time_started-m_time_created).count()/1000.0;
+
                 auto& list_batch_desc = *m_list_batch_desc;
 
                 m_list_proc_data.clear();
@@ -286,9 +1699,24 @@ namespace ks
 
                 for(uint i=0; i < list_batch_desc.size(); i++)
                 {
+                    if(m_cancelled)
+                    {
+                        break;
+                    }
+
                     auto& batch_desc = list_batch_desc[i];
                     auto& proc_data = m_list_proc_data[i];
 
+                    auto const time_desc_started = std::chrono::steady_clock::now();
+                    proc_data.merged_bytes = 0;
+
+                    if(batch_desc.incremental)
+                    {
+                        processIncremental(batch_desc,proc_data);
+                        proc_data.merge_ms = GetElapsedMs(time_desc_started);
+                        continue;
+                    }
+
                     // Create the single geometry list
                     std::vector<Geometry*> list_single_gm_all;
                     list_single_gm_all.reserve(
@@ -310,7 +1738,7 @@ namespace ks
                         for(auto ent_id : list_ents_curr)
                         {
                             list_single_gm_all.push_back(
-                                        &(m_list_batch_geometry[ent_id]));
+                                        &(m_list_batch_geometry.Get(ent_id)));
                         }
 
                         list_ents_curr_ptr = &list_ents_curr;
@@ -320,58 +1748,116 @@ namespace ks
                         for(auto ent_id : batch_desc.list_all_single_gm_ent_ids)
                         {
                             list_single_gm_all.push_back(
-                                        &(m_list_batch_geometry[ent_id]));
+                                        &(m_list_batch_geometry.Get(ent_id)));
                         }
 
                         list_ents_curr_ptr = &(batch_desc.list_all_single_gm_ent_ids);
                     }
 
                     // Split into lists according to buffer block sizes
-                    auto list_list_single_gm =
-                            detail::CreateSplitSingleGeometryLists(
+                    auto const list_list_single_gm_ix =
+                            CreateSplitSingleGeometryIxLists(
                                 batch_desc.buffer_layout,
-                                list_single_gm_all);
+                                list_single_gm_all,
+                                batch_desc.packing_policy,
+                                &(proc_data.packing_stats),
+                                batch_desc.primitive);
+
+                    auto list_list_single_gm =
+                            CreateSplitLists(
+                                list_single_gm_all,
+                                list_list_single_gm_ix);
 
                     auto& list_merged_gms = proc_data.list_merged_gms;
                     list_merged_gms.resize(list_list_single_gm.size());
 
                     for(uint j=0; j < list_list_single_gm.size(); j++)
                     {
-                        auto const vx_buff_count =
-                                batch_desc.buffer_layout->
-                                GetVertexBufferCount();
-
-                        auto& merged_gm = list_merged_gms[j];
-                        for(uint k=0; k < vx_buff_count; k++)
-                        {
-                            merged_gm.GetVertexBuffers().push_back(
-                                        make_unique<std::vector<u8>>());
-                        }
-                        if(batch_desc.buffer_layout->GetIsIndexed())
+                        if(m_cancelled)
                         {
-                            merged_gm.GetIndexBuffer() =
-                                    make_unique<std::vector<u8>>();
+                            break;
                         }
 
+                        auto& merged_gm = list_merged_gms[j];
+                        InitMergedGeometry(batch_desc.buffer_layout,&merged_gm);
+
                         // Merge single geometries
                         CreateMergedGeometry(
                                     batch_desc.buffer_layout,
                                     list_list_single_gm[j],
-                                    &merged_gm);
+                                    &merged_gm,
+                                    batch_desc.primitive);
+
+                        proc_data.merged_bytes += GetGeometrySizeBytes(merged_gm);
                     }
 
                     // For a potential post merge callback, save
                     // the split single geometry entity ids
                     proc_data.list_list_single_gm_ent_ids =
-                            detail::CreateSplitSingleGmEntIdLists(
+                            CreateSplitLists(
                                 *list_ents_curr_ptr,
-                                list_list_single_gm);
+                                list_list_single_gm_ix);
+
+                    proc_data.merge_ms = GetElapsedMs(time_desc_started);
                 }
 
+                m_process_ms = GetElapsedMs(time_started);
+
                 this->onEnded();
                 this->onFinished();
             }
 
+            void BatchTask::processIncremental(BatchDesc const &batch_desc,
+                                               BatchProcData& proc_data)
+            {
+                // The chunk layout was already decided by the
+                // BatchSystem so only dirty chunks are merged
+                auto const chunk_count =
+                        batch_desc.list_list_chunk_ent_ids.size();
+
+                auto& list_merged_gms = proc_data.list_merged_gms;
+                list_merged_gms.resize(chunk_count);
+
+                for(uint j=0; j < chunk_count; j++)
+                {
+                    if(m_cancelled)
+                    {
+                        break;
+                    }
+
+                    if(!batch_desc.list_chunk_dirty[j])
+                    {
+                        continue;
+                    }
+
+                    auto const &list_ent_ids =
+                            batch_desc.list_list_chunk_ent_ids[j];
+
+                    std::vector<Geometry*> list_single_gm;
+                    list_single_gm.reserve(list_ent_ids.size());
+
+                    for(auto ent_id : list_ent_ids)
+                    {
+                        list_single_gm.push_back(
+                                    &(m_list_batch_geometry.Get(ent_id)));
+                    }
+
+                    auto& merged_gm = list_merged_gms[j];
+                    InitMergedGeometry(batch_desc.buffer_layout,&merged_gm);
+
+                    CreateMergedGeometry(
+                                batch_desc.buffer_layout,
+                                list_single_gm,
+                                &merged_gm,
+                                batch_desc.primitive);
+
+                    proc_data.merged_bytes += GetGeometrySizeBytes(merged_gm);
+                }
+
+                proc_data.list_list_single_gm_ent_ids =
+                        batch_desc.list_list_chunk_ent_ids;
+            }
+
             // ============================================================= //
             // ============================================================= //
         }
@@ -17,9 +17,15 @@
 #ifndef KS_BATCH_SYSTEM_HPP
 #define KS_BATCH_SYSTEM_HPP
 
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <unordered_map>
 #include <ks/ecs/KsEcs.hpp>
 #include <ks/draw/KsDrawSystem.hpp>
 #include <ks/draw/KsDrawComponents.hpp>
+#include <ks/draw/KsDrawRenderDataComponentList.hpp>
+#include <ks/draw/KsDrawBatchStats.hpp>
 #include <ks/shared/KsThreadPool.hpp>
 
 namespace ks
@@ -34,6 +40,9 @@ namespace ks
         // return: std::vector<Id> modified list of batch data entity ids to merge
         // arg0: Id: batch group id
         // arg1: std::vector<Id> original list of batch data entity ids to merge
+        // * For MultiFrame batches this is called from a worker thread,
+        //   and may be called concurrently for different batch groups
+        //   if the BatchSystem has more than one worker thread
         using BatchPreMergeCallback =
             std::function<
                 std::vector<Id>(    Id,
@@ -50,33 +59,297 @@ namespace ks
                         std::vector<std::vector<Id>> const &    )
             >;
 
+        // * How well single geometries were packed into the merged
+        //   geometries of a batch group, taken when it was last merged.
+        //   VertexBuffer sizes are for VertexBuffer 0. Packing
+        //   efficiency is size_bytes/capacity_bytes and merged_count
+        //   can't be less than min_merged_count
+        struct BatchPackingStats
+        {
+            uint merged_count;
+            uint min_merged_count;
+            u64 vx_size_bytes;
+            u64 vx_capacity_bytes;
+            u64 ix_size_bytes;
+            u64 ix_capacity_bytes;
+        };
+
         // ============================================================= //
         // ============================================================= //
 
         namespace detail
         {
-            inline void IncrementListIx(u16* ix_ptr, u16 ix_count, u16 inc)
-            {
-                for(u16 i=0; i < ix_count; i++) {
-                    *ix_ptr += inc;
-                    ix_ptr++;
-                }
-            }
+            double GetElapsedMs(std::chrono::steady_clock::time_point const &time_start);
+
+            // * The size of all vertex and index data in gm
+            u64 GetGeometrySizeBytes(Geometry const &gm);
+
+            // * Adds inc to each index; uses AVX2 or SSE2 when
+            //   the target supports it
+            void IncrementListIx(u16* ix_ptr, uint ix_count, u16 inc);
+            void IncrementListIx(u32* ix_ptr, uint ix_count, u32 inc);
+
+            // * Max size in bytes of merged geometry in VertexBuffer 0.
+            //   This is the block size, further limited to 65536
+            //   vertices for UInt16 indexed layouts so that rebased
+            //   indices can't wrap
+            uint GetMergedVertexBufferLimit(BufferLayout const * buffer_layout);
+
+            // * The primitive merged geometry is drawn with for
+            //   single geometries drawn with primitive:
+            //   TriangleFan -> Triangles
+            //   LineStrip, LineLoop -> Lines
+            //   (others are unchanged)
+            gl::Primitive GetMergedPrimitive(gl::Primitive primitive);
+
+            // * True for Triangles, Lines and Points, which are
+            //   merged by appending (and rebasing indices) only
+            bool GetIsListPrimitive(gl::Primitive primitive);
+
+            // * The most elements (indices, or vertices for non
+            //   indexed layouts) that a single geometry with
+            //   element_count elements can add to merged geometry
+            uint GetMergedElementCount(gl::Primitive primitive,
+                                       uint element_count);
+
+            // * The most bytes single_gm can add to merged geometry,
+            //   as <VertexBuffer 0 size, IndexBuffer size>
+            std::pair<uint,uint> GetMergedSizeBytes(BufferLayout const * buffer_layout,
+                                                    gl::Primitive primitive,
+                                                    Geometry const &single_gm);
 
             void CreateMergedGeometry(BufferLayout const * buffer_layout,
                                       std::vector<Geometry*> &list_single_gm,
-                                      Geometry* merged_gm);
+                                      Geometry* merged_gm,
+                                      gl::Primitive primitive=gl::Primitive::Triangles);
+
+            // * Where a single geometry's data was placed in
+            //   its merged geometry
+            struct MergedGeometryRange
+            {
+                Id merged_ent_id;
+                uint vx_offset; // in vertices
+                uint vx_count;
+                uint ix_offset_bytes;
+                uint ix_size_bytes;
+            };
+
+            using MergedGeometryRangeLookup =
+                std::unordered_map<Id,MergedGeometryRange>;
+
+            // * Records the ranges of single geometries that were
+            //   merged (in order) into merged_ent_id's geometry
+            //   with CreateMergedGeometry
+            void CreateMergedGeometryRanges(BufferLayout const * buffer_layout,
+                                            std::vector<Geometry*> const &list_single_gm,
+                                            std::vector<Id> const &list_single_ent_ids,
+                                            Id merged_ent_id,
+                                            MergedGeometryRangeLookup& lkup_ranges);
+
+            // * True if single_gm has the same size as when it
+            //   was merged (and merged_gm still has that data) so
+            //   it can be patched in place
+            bool GetCanPatchMergedGeometry(BufferLayout const * buffer_layout,
+                                           Geometry const &single_gm,
+                                           MergedGeometryRange const &range,
+                                           Geometry const &merged_gm);
+
+            // * Copies single_gm over its range in merged_gm (rebasing
+            //   its indices) and marks only that range as updated. Only
+            //   the buffers updated in single_gm are copied (or all of
+            //   them if none are marked updated)
+            void PatchMergedGeometry(BufferLayout const * buffer_layout,
+                                     Geometry const &single_gm,
+                                     MergedGeometryRange const &range,
+                                     Geometry* merged_gm);
+
+            // * Splits a list of single geometries into N merged
+            //   geometries according to the packing policy. Returns
+            //   the indices into list_single_gm_all for each merged
+            //   geometry (in ascending order)
+            std::vector<std::vector<uint>>
+            CreateSplitSingleGeometryIxLists(
+                    BufferLayout const * buffer_layout,
+                    std::vector<Geometry*> const &list_single_gm_all,
+                    PackingPolicy packing_policy,
+                    BatchPackingStats* packing_stats=nullptr,
+                    gl::Primitive primitive=gl::Primitive::Triangles);
 
             std::vector<std::vector<Geometry*>>
             CreateSplitSingleGeometryLists(
                     BufferLayout const * buffer_layout,
                     std::vector<Geometry*> const &list_single_gm_all);
 
-            std::vector<std::vector<Id>>
-            CreateSplitSingleGmEntIdLists(
-                    std::vector<Id> const &list_all_single_gm_ent_ids,
-                    std::vector<std::vector<Geometry*>> const &list_list_single_gms);
+            template<typename T>
+            std::vector<std::vector<T>>
+            CreateSplitLists(std::vector<T> const &list_all,
+                             std::vector<std::vector<uint>> const &list_list_ix)
+            {
+                std::vector<std::vector<T>> list_list_split(list_list_ix.size());
+
+                for(uint i=0; i < list_list_ix.size(); i++)
+                {
+                    list_list_split[i].reserve(list_list_ix[i].size());
+                    for(auto const ix : list_list_ix[i])
+                    {
+                        list_list_split[i].push_back(list_all[ix]);
+                    }
+                }
+
+                return list_list_split;
+            }
+
+            void InitMergedGeometry(BufferLayout const * buffer_layout,
+                                    Geometry* merged_gm);
+
+            // * Appends single_gm to merged_gm, rebasing its indices
+            //   by the vertex count already in merged_gm. Primitives
+            //   that aren't lists are converted (see Batch::GetPrimitive)
+            void AppendMergedGeometry(BufferLayout const * buffer_layout,
+                                      Geometry const &single_gm,
+                                      Geometry* merged_gm,
+                                      gl::Primitive primitive=gl::Primitive::Triangles);
+
+            // * Keeps a stable assignment of single geometries to
+            //   merged geometries (chunks) for batch groups that use
+            //   MergeMode::Incremental. Adding, removing or updating
+            //   a single geometry only marks the chunk(s) it was in
+            //   or moved to as dirty
+            class BatchChunkList final
+            {
+            public:
+                struct Chunk
+                {
+                    // The entity with the merged RenderData for
+                    // this chunk (0 if not yet created)
+                    Id merged_ent_id{0};
+
+                    uint vx_size_bytes{0};
+                    uint ix_size_bytes{0};
+                    bool dirty{false};
+
+                    std::vector<Id> list_ent_ids;
+
+                    // <vx size bytes, ix size bytes> for each entity
+                    std::vector<std::pair<uint,uint>> list_ent_sizes;
+                };
+
+                BatchChunkList(BufferLayout const * buffer_layout,
+                               PackingPolicy packing_policy,
+                               gl::Primitive primitive=gl::Primitive::Triangles);
+                ~BatchChunkList() = default;
+
+                std::vector<Chunk>& GetChunks();
+
+                BatchPackingStats GetPackingStats() const;
+
+                void Remove(Id ent_id);
+                void Update(Id ent_id, Geometry const &single_gm);
+
+                // Removes all empty chunks and returns the
+                // merged entity ids that were assigned to them
+                std::vector<Id> RemoveEmptyChunks();
+
+                void ClearDirty();
+
+            private:
+                void add(Id ent_id, uint vx_size, uint ix_size);
+                void removeFromChunk(uint chunk_idx, uint ent_idx);
+                bool fits(Chunk const &chunk, uint vx_size, uint ix_size) const;
+
+                BufferLayout const * const m_buffer_layout;
+                PackingPolicy const m_packing_policy;
+                gl::Primitive const m_primitive;
+                uint const m_vx_block_size;
+                uint const m_ix_block_size;
+
+                std::vector<Chunk> m_list_chunks;
+
+                // <entity id, chunk index>
+                std::unordered_map<Id,uint> m_lkup_ent_chunk;
+            };
+
+            void CopyGeometryBuffers(Geometry const &from, Geometry& to);
+
+            // * Transfers ownership of the buffers instead of copying
+            //   them; from's buffers are left empty
+            void MoveGeometryBuffers(Geometry& from, Geometry& to);
+
+            // * FNV-1a hash of the vertex and index data in gm
+            u64 CalcGeometryHash(Geometry const &gm);
+
+            // * True if a and b have byte identical buffers
+            bool GetGeometryEqual(Geometry const &a, Geometry const &b);
+
+            // * The single geometry snapshot used by BatchTasks,
+            //   indexed by entity id
+            // * With dedup enabled, copied geometry is hashed and
+            //   byte identical geometry is stored once and shared
+            //   by every entity that has it. Shared geometry must
+            //   not be modified through Get
+            class BatchGeometryList final
+            {
+                struct SharedGeometry
+                {
+                    u64 hash;
+                    uint ref_count;
+                    Geometry geometry;
+                };
+
+            public:
+                BatchGeometryList(bool dedup=false);
+                ~BatchGeometryList() = default;
+
+                // * Only affects geometry copied afterwards
+                void SetDedup(bool dedup);
+                bool GetDedup() const;
+
+                uint GetSize() const;
+                void Resize(uint size);
+
+                Geometry& Get(Id ent_id);
+
+                // * Returns true if identical geometry was already
+                //   stored, in which case nothing is copied
+                bool Copy(Id ent_id, Geometry const &single_gm);
+
+                void Move(Id ent_id, Geometry& single_gm);
+
+                // * True if the geometry for @ent_id was moved in
+                //   with Move instead of copied
+                bool GetMoved(Id ent_id) const;
+
+                void Remove(Id ent_id);
+
+                // * The number of distinct geometries that are
+                //   currently shared by more than one entity
+                uint GetSharedCount() const;
+
+            private:
+                void release(Id ent_id);
+
+                bool m_dedup;
+
+                std::vector<Geometry> m_list_geometry;
+
+                // * For each entity, the index+1 into m_list_shared
+                //   of its geometry (0 if it isn't shared)
+                std::vector<uint> m_list_shared_idx;
+
+                std::vector<u8> m_list_moved;
 
+                std::vector<SharedGeometry> m_list_shared;
+                std::vector<uint> m_list_shared_free;
+                std::unordered_multimap<u64,uint> m_lkup_hash_shared;
+            };
+
+            // * Merges the single geometries for a list of batch
+            //   groups (one BatchDesc each). The BatchSystem creates
+            //   a separate BatchTask for every rebuilt MultiFrame
+            //   group so groups can be merged in parallel
+            // * Cancel can be called from any thread; the task stops
+            //   at the next BatchDesc or merged geometry and its
+            //   results must not be used
             class BatchTask final : public ks::ThreadPool::Task
             {
                 struct BatchProcData
@@ -89,6 +362,11 @@ namespace ks
                     // The list of single geometry lists corresponding
                     // to each individual merged geometry
                     std::vector<std::vector<Id>> list_list_single_gm_ent_ids;
+
+                    BatchPackingStats packing_stats;
+
+                    double merge_ms;
+                    u64 merged_bytes;
                 };
 
             public:
@@ -97,13 +375,29 @@ namespace ks
                     Id uid;
                     Id batch_id;
                     BufferLayout const * buffer_layout;
+                    PackingPolicy packing_policy;
+                    gl::Primitive primitive;
 
                     // The list of all single geometries
                     std::vector<Id> list_all_single_gm_ent_ids;
+
+                    // * MergeMode::Incremental only: the layout of
+                    //   every chunk in the batch group. Only dirty
+                    //   chunks are merged; merged entities for chunks
+                    //   that were emptied are removed once the result
+                    //   is applied
+                    bool incremental;
+                    std::vector<Id> list_chunk_merged_ent_ids;
+                    std::vector<std::vector<Id>> list_list_chunk_ent_ids;
+                    std::vector<u8> list_chunk_dirty;
+                    std::vector<Id> list_merged_ent_ids_rem;
+
+                    // Bytes copied into the snapshot for this desc
+                    u64 snapshot_bytes;
                 };
 
                 BatchTask(unique_ptr<std::vector<BatchDesc>> list_batch_desc,
-                          std::vector<Geometry>& list_batch_geometry,
+                          BatchGeometryList& list_batch_geometry,
                           BatchPreMergeCallback pre_merge_callback);
 
                 ~BatchTask();
@@ -115,17 +409,40 @@ namespace ks
                 std::vector<std::vector<Id>> const &
                 GetSplitSingleGmEntIdLists(uint index) const;
 
+                BatchPackingStats const & GetPackingStats(uint index) const;
+
+                double GetMergeMs(uint index) const;
+
+                u64 GetMergedBytes(uint index) const;
+
+                // * The time between the task being created and
+                //   being started by a thread
+                double GetQueueMs() const;
+
+                double GetProcessMs() const;
+
                 void Cancel() override;
 
+                bool IsCancelled() const;
+
                 void Process();
 
             private:
                 void process() override;
 
+                void processIncremental(BatchDesc const &batch_desc,
+                                        BatchProcData& proc_data);
+
                 unique_ptr<std::vector<BatchDesc>> m_list_batch_desc;
-                std::vector<Geometry>& m_list_batch_geometry;
+                BatchGeometryList& m_list_batch_geometry;
                 BatchPreMergeCallback m_pre_merge_callback;
 
+                std::atomic<bool> m_cancelled;
+
+                std::chrono::steady_clock::time_point m_time_created;
+                double m_queue_ms;
+                double m_process_ms;
+
                 // Processed output/result data
                 std::vector<BatchProcData> m_list_proc_data;
             };
@@ -138,41 +455,136 @@ namespace ks
                  typename DrawKeyType>
         class BatchSystem final : public draw::System
         {
+            // * The progress of a TimeSliced merge. Single geometries
+            //   are read from their BatchData as they're merged
+            struct TimeSlicedMerge
+            {
+                // The entities to merge into each merged geometry
+                std::vector<std::vector<Id>> list_list_ent_ids;
+
+                // * MergeMode::Incremental only: the chunk layout when
+                //   the merge was started; only dirty chunks are merged
+                std::vector<Id> list_chunk_merged_ent_ids;
+                std::vector<u8> list_chunk_dirty;
+
+                std::vector<Geometry> list_merged_gms;
+                std::vector<std::vector<Id>> list_list_merged_ent_ids;
+
+                BatchPackingStats packing_stats{};
+
+                uint merged_idx{0};
+                uint single_idx{0};
+
+                // Summed over every slice of the merge
+                double merge_ms{0};
+                u64 merged_bytes{0};
+            };
+
             struct BatchGroup
             {
                 shared_ptr<Batch<DrawKeyType>> batch;
 
+                // * Set instead of batch for instanced batch groups
+                shared_ptr<InstancedBatch<DrawKeyType>> instanced_batch;
+
                 Id uid{0};
                 bool rebuild{false};
 
-                std::vector<Id> list_ents_prev;
+                // * list_ents_curr is kept up to date as BatchData
+                //   changes. list_ents_rem and list_ents_upd collect
+                //   the entities that were removed and that need to
+                //   be rebuilt until the group is next merged (all
+                //   lists are sorted)
                 std::vector<Id> list_ents_curr;
                 std::vector<Id> list_ents_rem;
                 std::vector<Id> list_ents_upd;
 
                 std::vector<Id> list_merged_ent_ids;
+
+                BatchPackingStats packing_stats{};
+
+                // * SingleFrame only: where each entity's geometry is
+                //   in the merged geometries so geometry that keeps
+                //   its size can be patched instead of merged again
+                detail::MergedGeometryRangeLookup lkup_ent_merged_range;
+
+                // * MergeMode::Incremental only
+                unique_ptr<detail::BatchChunkList> chunk_list;
+
+                // (merged entities of emptied chunks that should be
+                //  removed when the MultiFrame result of the snapshot
+                //  they were in is applied; kept here until then)
+                std::vector<Id> list_merged_ent_ids_rem;
+
+                // * TimeSliced only: the merge in progress (if any)
+                unique_ptr<TimeSlicedMerge> ts_merge;
+
+                // * MultiFrame only: bytes copied into the snapshot
+                //   for the next BatchTask
+                u64 mf_snapshot_bytes{0};
             };
 
         public:
             using RenderData = draw::RenderData<DrawKeyType>;
 
-            using BatchDataComponentList =
-                ecs::ComponentList<SceneKeyType,BatchData>;
+            // * Records BatchData that was created or removed so
+            //   the BatchSystem doesn't have to scan every entity.
+            //   BatchData must be created with Create (and not
+            //   assigned directly to the sparse list)
+            class BatchDataComponentList final :
+                    public ecs::ComponentList<SceneKeyType,BatchData>
+            {
+                using Base = ecs::ComponentList<SceneKeyType,BatchData>;
+
+            public:
+                BatchDataComponentList(ecs::Scene<SceneKeyType>& scene,
+                                       shared_ptr<EntityChangeList> change_list) :
+                    Base(scene),
+                    m_change_list(change_list)
+                {}
+
+                template<typename... Args>
+                BatchData& Create(Id ent_id, Args&&... args)
+                {
+                    auto& batch_data =
+                            Base::Create(ent_id,std::forward<Args>(args)...);
+
+                    batch_data.SetChangeList(ent_id,m_change_list.get());
+                    m_change_list->Add(ent_id);
+
+                    return batch_data;
+                }
+
+                void RemoveComponent(Id ent_id) override
+                {
+                    Base::RemoveComponent(ent_id);
+                    m_change_list->Add(ent_id);
+                }
+
+            private:
+                shared_ptr<EntityChangeList> m_change_list;
+            };
 
             using RenderDataComponentList =
-                ecs::ComponentList<SceneKeyType,RenderData>;
+                draw::RenderDataComponentList<SceneKeyType,DrawKeyType>;
 
-            BatchSystem(ecs::Scene<SceneKeyType>* scene) :
+            // * mf_thread_count: the number of worker threads used
+            //   to merge MultiFrame batch groups
+            BatchSystem(ecs::Scene<SceneKeyType>* scene,
+                        uint mf_thread_count=1) :
                 m_scene(scene),
                 m_cmlist_render_data(
                     static_cast<RenderDataComponentList*>(
                         scene->template GetComponentList<RenderData>())),
                 m_batch_group_uid_counter(1),
-                m_thread_pool(1)
+                m_batch_data_changes(make_shared<EntityChangeList>()),
+                m_thread_pool(std::max(mf_thread_count,1u))
             {
                 // Create the BatchData component list
                 m_scene->template RegisterComponentList<BatchData>(
-                            make_unique<BatchDataComponentList>(*m_scene));
+                            make_unique<BatchDataComponentList>(
+                                *m_scene,
+                                m_batch_data_changes));
 
                 m_cmlist_batch_data =
                         static_cast<BatchDataComponentList*>(
@@ -180,23 +592,14 @@ namespace ks
 
                 // Reserve batch id 0 as invalid
                 m_list_batch_groups.Add(nullptr);
-
-                // Create and process an empty batch task
-                // to setup initial valid state
-                m_batch_task =
-                        make_shared<detail::BatchTask>(
-                            make_unique<std::vector<detail::BatchTask::BatchDesc>>(),
-                            m_list_batch_geometry,
-                            m_pre_merge_callback_mf);
-
-                // (doesn't do anything except set the Task
-                //  state to finished)
-                m_batch_task->Process();
             }
 
             ~BatchSystem()
             {
-
+                // Don't wait on merges whose results won't be used
+                for(auto& batch_task : m_list_batch_tasks) {
+                    batch_task->Cancel();
+                }
             }
 
             std::string GetDesc() const override
@@ -214,11 +617,29 @@ namespace ks
                 return m_list_batch_groups[batch_id]->batch;
             }
 
+            shared_ptr<InstancedBatch<DrawKeyType>> const &
+            GetInstancedBatch(Id batch_id) const
+            {
+                return m_list_batch_groups[batch_id]->instanced_batch;
+            }
+
             std::vector<Id> GetBatchEntities(Id batch_id)
             {
                 return m_list_batch_groups[batch_id]->list_merged_ent_ids;
             }
 
+            BatchPackingStats GetPackingStats(Id batch_id)
+            {
+                return m_list_batch_groups[batch_id]->packing_stats;
+            }
+
+            // * Merge timings and byte counts for each batch group
+            //   and for the last Update
+            BatchStats const & GetStats() const
+            {
+                return m_stats;
+            }
+
             Id RegisterBatch(shared_ptr<Batch<DrawKeyType>> batch)
             {
                 // BufferLayouts for Batches must have VertexBuffer block
@@ -268,19 +689,124 @@ namespace ks
                 batch_group->batch = batch;
                 batch_group->uid = m_batch_group_uid_counter++;
 
+                if(batch->GetMergeMode()==MergeMode::Incremental)
+                {
+                    batch_group->chunk_list =
+                            make_unique<detail::BatchChunkList>(
+                                buff_layout,
+                                batch->GetPackingPolicy(),
+                                batch->GetPrimitive());
+                }
+
+                resetGroupStats(batch_id);
+                requeuePendingEnts(batch_id);
+
                 return batch_id;
             }
 
+            // * Instanced batch groups are merged during Update
+            //   on the calling thread. Only the instance records
+            //   are merged, so they're cheap to rebuild
+            Id RegisterInstancedBatch(shared_ptr<InstancedBatch<DrawKeyType>> batch)
+            {
+                auto buff_layout = batch->GetBufferLayout();
+
+                uint const vx_buff_count =
+                        buff_layout->GetVertexBufferCount();
+
+                if(vx_buff_count < 2 ||
+                   buff_layout->GetVertexBufferDivisor(vx_buff_count-1) != 1)
+                {
+                    throw ks::Exception(
+                                ks::Exception::ErrorLevel::ERROR,
+                                "BatchSystem: InstancedBatch BufferLayout "
+                                "must end with a VertexBuffer with "
+                                "a divisor of 1");
+                }
+
+                for(uint i=0; i < vx_buff_count-1; i++)
+                {
+                    if(buff_layout->GetVertexBufferDivisor(i) != 0)
+                    {
+                        throw ks::Exception(
+                                    ks::Exception::ErrorLevel::ERROR,
+                                    "BatchSystem: InstancedBatch base "
+                                    "VertexBuffers can't be instanced");
+                    }
+                }
+
+                auto const batch_id =
+                        m_list_batch_groups.Add(
+                            make_unique<BatchGroup>());
+
+                auto& batch_group = m_list_batch_groups.Get(batch_id);
+
+                batch_group->instanced_batch = batch;
+                batch_group->uid = m_batch_group_uid_counter++;
+
+                resetGroupStats(batch_id);
+                requeuePendingEnts(batch_id);
+
+                return batch_id;
+            }
 
             void RemoveBatch(Id batch_id)
             {
                 auto& batch_group = m_list_batch_groups.Get(batch_id);
 
-                for(auto& merged_ent_id : batch_group->list_merged_ent_ids)
+                // Results for this group would be discarded, including
+                // those of tasks that were already cancelled. The merged
+                // entities their descs were to remove are released here
+                // since restoreCancelledBatchDesc won't be called for them
+                for(auto& batch_task : m_list_batch_tasks)
                 {
-                    m_scene->RemoveEntity(merged_ent_id);
+                    for(auto const &batch_desc : batch_task->GetListBatchDesc())
+                    {
+                        if(batch_desc.batch_id == batch_id &&
+                           batch_desc.uid == batch_group->uid)
+                        {
+                            batch_task->Cancel();
+                            releaseMergedEntsForBatchDesc(batch_desc);
+                        }
+                    }
+                }
+
+                // Entities in this group are looked at again in the
+                // next Update; until a new group reuses batch_id they
+                // wait in m_lkup_group_pending_ents
+                for(auto const ent_id : batch_group->list_ents_curr)
+                {
+                    m_lkup_ent_group[ent_id] = 0;
+                    m_batch_data_changes->Add(ent_id);
+                }
+
+                if(batch_group->chunk_list)
+                {
+                    // Chunks may have merged entities that haven't
+                    // been applied to list_merged_ent_ids yet
+                    for(auto& chunk : batch_group->chunk_list->GetChunks())
+                    {
+                        if(chunk.merged_ent_id > 0)
+                        {
+                            m_scene->RemoveEntity(chunk.merged_ent_id);
+                        }
+                    }
+
+                    // Chunks emptied since the last snapshot
+                    for(auto& merged_ent_id : batch_group->list_merged_ent_ids_rem)
+                    {
+                        m_scene->RemoveEntity(merged_ent_id);
+                    }
+                }
+                else
+                {
+                    for(auto& merged_ent_id : batch_group->list_merged_ent_ids)
+                    {
+                        m_scene->RemoveEntity(merged_ent_id);
+                    }
                 }
                 m_list_batch_groups.Remove(batch_id);
+                m_stats.list_group_stats[batch_id].valid = false;
             }
 
             void SetSFPreMergeCallback(BatchPreMergeCallback callback)
@@ -333,68 +859,73 @@ namespace ks
                 m_post_merge_callback_mf = nullptr;
             }
 
+            // * If enabled, a running MultiFrame task is cancelled
+            //   when its batch group changes before the task has
+            //   finished, and a new snapshot replaces it. Otherwise
+            //   the task runs to completion and the changes wait for
+            //   the next snapshot
+            void SetMFSupersedeTasks(bool supersede)
+            {
+                m_mf_supersede_tasks = supersede;
+            }
+
+            // * If enabled, byte identical geometry copied into the
+            //   MultiFrame snapshot is stored once (see
+            //   detail::BatchGeometryList). Hashing costs time for
+            //   every copy so this is off by default
+            void SetMFDedupGeometry(bool dedup)
+            {
+                m_list_batch_geometry.SetDedup(dedup);
+            }
+
+            // * Limits the work done merging TimeSliced batch groups
+            //   in each Update. Merging stops for the Update once either
+            //   limit is reached (0 disables a limit). At least one
+            //   single geometry is merged in each Update so merges
+            //   always finish. TimeSliced batch groups use the
+            //   SingleFrame pre and post merge callbacks
+            void SetTSBudget(double budget_ms,uint budget_bytes)
+            {
+                m_ts_budget_ms = budget_ms;
+                m_ts_budget_bytes = budget_bytes;
+            }
+
             void Update(TimePoint const &,TimePoint const &) override
             {
-                // Clear previous list of Batchable entities
+                auto const time_update_start = std::chrono::steady_clock::now();
+                m_stats.ClearUpdateStats();
+
                 auto const num_batch_groups =
                         m_list_batch_groups.GetList().size();
 
-                for(auto& batch_group : m_list_batch_groups.GetList())
-                {
-                    if(batch_group)
-                    {
-                        batch_group->rebuild = false;
-                        batch_group->list_ents_curr.clear();
-                        batch_group->list_ents_rem.clear();
-                        batch_group->list_ents_upd.clear();
-                    }
-                }
-
-                // Get the current list of Batchable entities
-                auto const batchable_mask =
-                        ecs::Scene<SceneKeyType>::template
-                            GetComponentMask<BatchData>();
-
-                auto& list_entities = m_scene->GetEntityList();
                 auto& list_batch_data = m_cmlist_batch_data->GetSparseList();
                 auto& list_render_data = m_cmlist_render_data->GetSparseList();
 
-                for(uint ent_id=0; ent_id < list_entities.size(); ent_id++)
-                {
-                    if((list_entities[ent_id].mask & batchable_mask) == batchable_mask)
-                    {
-                        auto& batch_data = list_batch_data[ent_id];
-
-                        if(batch_data.GetGroupId() > 0)
-                        {
-                            auto& batch_group = m_list_batch_groups[batch_data.GetGroupId()];
-
-                            // Note that we automatically get ordered
-                            // insert for Entity Ids
-                            batch_group->list_ents_curr.push_back(ent_id);
-
-                            // Check for updated
-                            if(batch_data.GetRebuild())
-                            {
-                                batch_group->rebuild = true;
-                                batch_group->list_ents_upd.push_back(ent_id);
-                            }
-                        }
-                    }
-                }
+                // Update batch group membership for entities
+                // whose BatchData changed since the last Update
+                updateBatchGroupMembership(list_batch_data);
 
                 std::vector<uint> list_sf_batch_groups;
+                std::vector<uint> list_ts_batch_groups;
                 std::vector<uint> list_mf_batch_groups;
+                std::vector<uint> list_instanced_batch_groups;
 
                 for(uint group = 0; group < num_batch_groups; group++)
                 {
                     auto& batch_group = m_list_batch_groups[group];
-                    if(batch_group)
+                    if(batch_group && batch_group->instanced_batch)
+                    {
+                        list_instanced_batch_groups.push_back(group);
+                    }
+                    else if(batch_group)
                     {
                         auto& batch = batch_group->batch;
                         if(batch->GetUpdatePriority()==UpdatePriority::SingleFrame) {
                             list_sf_batch_groups.push_back(group);
                         }
+                        else if(batch->GetUpdatePriority()==UpdatePriority::TimeSliced) {
+                            list_ts_batch_groups.push_back(group);
+                        }
                         else {
                             list_mf_batch_groups.push_back(group);
                         }
@@ -405,31 +936,48 @@ namespace ks
                 updateBatchGroupsSF(list_sf_batch_groups,
                                     list_batch_data);
 
+                updateBatchGroupsTS(list_ts_batch_groups,
+                                    list_batch_data);
+
+                updateBatchGroupsInstanced(list_instanced_batch_groups,
+                                           list_batch_data);
+
                 updateBatchTask(list_mf_batch_groups,
                                 list_batch_data,
                                 list_render_data);
+
+                m_stats.update_ms = detail::GetElapsedMs(time_update_start);
+                m_stats.GenText();
             }
 
             void WaitOnMultiFrameBatch()
             {
-                m_batch_task->Wait();
+                for(auto& batch_task : m_list_batch_tasks) {
+                    batch_task->Wait();
+                }
             }
 
             static void CopyGeometryBuffers(Geometry const & from, Geometry& to)
             {
-                to.GetVertexBuffers().clear();
+                detail::CopyGeometryBuffers(from,to);
+            }
 
-                for(auto const &vx_data : from.GetVertexBuffers())
-                {
-                    to.GetVertexBuffers().push_back(
-                                make_unique<std::vector<u8>>(*vx_data));
-                }
+            // * Transfers ownership of the buffers instead of copying
+            //   them; from's buffers are left empty
+            static void MoveGeometryBuffers(Geometry& from, Geometry& to)
+            {
+                detail::MoveGeometryBuffers(from,to);
+            }
 
-                if(from.GetIndexBuffer())
-                {
-                    to.GetIndexBuffer() =
-                            make_unique<std::vector<u8>>(
-                                *(from.GetIndexBuffer()));
+            template<typename T>
+            static void OrderedErase(std::vector<T>& list_data,T const &data)
+            {
+                auto it = std::lower_bound(list_data.begin(),
+                                           list_data.end(),
+                                           data);
+
+                if((it!=list_data.end()) && (*it == data)) {
+                    list_data.erase(it);
                 }
             }
 
@@ -448,47 +996,207 @@ namespace ks
             }
 
         private:
-            void updateBatchGroupsSF(std::vector<uint> const &list_sf_batch_groups,
-                                     std::vector<BatchData>& list_batch_data)
+            void updateBatchGroupMembership(std::vector<BatchData>& list_batch_data)
             {
-                for(auto const group : list_sf_batch_groups)
+                auto& list_ent_ids = m_batch_data_changes->GetList();
+                if(list_ent_ids.empty())
                 {
-                    auto& batch_group = m_list_batch_groups[group];
-                    auto& batch = batch_group->batch;
+                    return;
+                }
 
-                    // If there were no updated GeometryData check to
-                    // see if any have been added or removed
-                    if(!batch_group->rebuild)
-                    {
-                        // Find out which entities were removed (ie.
-                        // in previous but not in current)
-                        std::set_difference(
-                                    batch_group->list_ents_prev.begin(),
-                                    batch_group->list_ents_prev.end(),
-                                    batch_group->list_ents_curr.begin(),
-                                    batch_group->list_ents_curr.end(),
-                                    std::back_inserter(batch_group->list_ents_rem));
+                // Sorted so the per group lists stay in entity order
+                std::sort(list_ent_ids.begin(),list_ent_ids.end());
 
-                        // We assume that any entities with BatchData that
-                        // were added have updated Geometry so there's no
-                        // explicit search for 'added entities'
-                        batch_group->rebuild =
-                                (!batch_group->list_ents_rem.empty());
-                    }
+                auto const batchable_mask =
+                        ecs::Scene<SceneKeyType>::template
+                            GetComponentMask<BatchData>();
 
-                    if(batch_group->rebuild)
-                    {
-                        // Get the list of single geometries
-                        std::vector<Geometry*> list_single_gm_all;
-                        list_single_gm_all.reserve(batch_group->list_ents_curr.size());
+                auto& list_entities = m_scene->GetEntityList();
 
-                        // Allow a callback to modify the list of entities
-                        // that will be merged together. Note we don't save
-                        // the modified list; the original batch_group->
-                        // list_ents_curr must be kept to do proper diffs
+                if(m_lkup_ent_group.size() < list_entities.size())
+                {
+                    m_lkup_ent_group.resize(list_entities.size(),0);
+                }
 
-                        std::vector<Id> temp_list_ents_curr;
-                        std::vector<Id>* list_ents_curr_ptr;
+                for(auto const ent_id : list_ent_ids)
+                {
+                    Id curr_group_id = 0;
+                    bool rebuild = false;
+
+                    if((list_entities[ent_id].mask & batchable_mask) == batchable_mask)
+                    {
+                        auto const &batch_data = list_batch_data[ent_id];
+                        auto const group_id = batch_data.GetGroupId();
+
+                        if(group_id > 0 &&
+                           group_id < m_list_batch_groups.GetList().size() &&
+                           m_list_batch_groups[group_id])
+                        {
+                            curr_group_id = group_id;
+                            rebuild = batch_data.GetRebuild();
+                        }
+                        else if(group_id > 0)
+                        {
+                            // Joins the group once it's registered
+                            OrderedUniqueInsert(
+                                        m_lkup_group_pending_ents[group_id],
+                                        ent_id);
+                        }
+                    }
+
+                    auto const prev_group_id = m_lkup_ent_group[ent_id];
+
+                    if(prev_group_id != curr_group_id)
+                    {
+                        if(prev_group_id > 0)
+                        {
+                            auto& batch_group = m_list_batch_groups[prev_group_id];
+                            OrderedErase(batch_group->list_ents_curr,ent_id);
+                            OrderedErase(batch_group->list_ents_upd,ent_id);
+                            OrderedUniqueInsert(batch_group->list_ents_rem,ent_id);
+                        }
+
+                        if(curr_group_id > 0)
+                        {
+                            auto& batch_group = m_list_batch_groups[curr_group_id];
+                            OrderedUniqueInsert(batch_group->list_ents_curr,ent_id);
+                            OrderedErase(batch_group->list_ents_rem,ent_id);
+
+                            // Tasks may still be reading the snapshot
+                            // so its geometry is copied back
+                            if(restoreMovedGeometry(
+                                   ent_id,list_batch_data[ent_id],true))
+                            {
+                                rebuild = true;
+                            }
+                        }
+
+                        m_lkup_ent_group[ent_id] = curr_group_id;
+                    }
+
+                    if(rebuild)
+                    {
+                        auto& batch_group = m_list_batch_groups[curr_group_id];
+                        batch_group->rebuild = true;
+                        OrderedUniqueInsert(batch_group->list_ents_upd,ent_id);
+                    }
+                }
+
+                m_batch_data_changes->Clear();
+            }
+
+            // * Entities whose BatchData has a group id that wasn't
+            //   registered when they were last looked at are looked
+            //   at again in the next Update. The list may have
+            //   entities that have since changed groups, which
+            //   updateBatchGroupMembership handles like any change
+            void requeuePendingEnts(Id batch_id)
+            {
+                auto it = m_lkup_group_pending_ents.find(batch_id);
+                if(it == m_lkup_group_pending_ents.end())
+                {
+                    return;
+                }
+
+                for(auto const ent_id : it->second)
+                {
+                    m_batch_data_changes->Add(ent_id);
+                }
+
+                m_lkup_group_pending_ents.erase(it);
+            }
+
+            // * Geometry that isn't retained is moved into the
+            //   MultiFrame snapshot, leaving the BatchData empty.
+            //   If the entity leaves its group before setting new
+            //   buffers the geometry is given back to the BatchData
+            //   so another group can merge it
+            bool restoreMovedGeometry(Id ent_id,
+                                      BatchData& batch_data,
+                                      bool copy)
+            {
+                if(ent_id >= m_list_batch_geometry.GetSize() ||
+                   !m_list_batch_geometry.GetMoved(ent_id))
+                {
+                    return false;
+                }
+
+                auto& single_gm = batch_data.GetGeometry();
+                if(!single_gm.GetVertexBuffers().empty())
+                {
+                    return false;
+                }
+
+                auto& moved_gm = m_list_batch_geometry.Get(ent_id);
+                if(copy)
+                {
+                    CopyGeometryBuffers(moved_gm,single_gm);
+                }
+                else
+                {
+                    MoveGeometryBuffers(moved_gm,single_gm);
+                }
+
+                for(uint i=0; i < single_gm.GetVertexBuffers().size(); i++)
+                {
+                    single_gm.SetVertexBufferUpdated(i);
+                }
+
+                if(single_gm.GetIndexBuffer())
+                {
+                    single_gm.SetIndexBufferUpdated();
+                }
+
+                return true;
+            }
+
+            void updateBatchGroupsSF(std::vector<uint> const &list_sf_batch_groups,
+                                     std::vector<BatchData>& list_batch_data)
+            {
+                for(auto const group : list_sf_batch_groups)
+                {
+                    auto& batch_group = m_list_batch_groups[group];
+                    auto& batch = batch_group->batch;
+
+                    bool const incremental =
+                            (batch->GetMergeMode()==MergeMode::Incremental);
+
+                    // We assume that any entities with BatchData that
+                    // were added have updated Geometry so there's no
+                    // explicit search for 'added entities'
+                    batch_group->rebuild =
+                            batch_group->rebuild ||
+                            (!batch_group->list_ents_rem.empty());
+
+                    if(!batch_group->rebuild)
+                    {
+                        continue;
+                    }
+
+                    auto const time_merge_start = std::chrono::steady_clock::now();
+                    u64 merged_bytes = patchMergedGeometrySF(group,list_batch_data);
+
+                    batch_group->rebuild =
+                            !(batch_group->list_ents_upd.empty() &&
+                              batch_group->list_ents_rem.empty());
+
+                    if(batch_group->rebuild && incremental)
+                    {
+                        merged_bytes += mergeChunksSF(group,list_batch_data);
+                    }
+                    else if(batch_group->rebuild)
+                    {
+                        // Get the list of single geometries
+                        std::vector<Geometry*> list_single_gm_all;
+                        list_single_gm_all.reserve(batch_group->list_ents_curr.size());
+
+                        // Allow a callback to modify the list of entities
+                        // that will be merged together. Note we don't save
+                        // the modified list; the original batch_group->
+                        // list_ents_curr must be kept to do proper diffs
+
+                        std::vector<Id> temp_list_ents_curr;
+                        std::vector<Id>* list_ents_curr_ptr;
 
                         if(m_pre_merge_callback_sf)
                         {
@@ -518,66 +1226,767 @@ namespace ks
 
                         // Split single geometries based on buffer sizes
                         // and create corresponding merged RenderDatas
-                        auto list_list_single_gm =
-                                detail::CreateSplitSingleGeometryLists(
+                        auto const list_list_single_gm_ix =
+                                detail::CreateSplitSingleGeometryIxLists(
                                     batch->GetBufferLayout(),
-                                    list_single_gm_all);
+                                    list_single_gm_all,
+                                    batch->GetPackingPolicy(),
+                                    &(batch_group->packing_stats),
+                                    batch->GetPrimitive());
+
+                        auto list_list_single_gm =
+                                detail::CreateSplitLists(
+                                    list_single_gm_all,
+                                    list_list_single_gm_ix);
+
+                        auto const list_list_single_ent_ids =
+                                detail::CreateSplitLists(
+                                    *list_ents_curr_ptr,
+                                    list_list_single_gm_ix);
 
                         resizeMergedEntityListForBatchGroup(
                                     group,list_list_single_gm.size());
 
+                        batch_group->lkup_ent_merged_range.clear();
+
                         // Create merged geometries
                         for(uint i=0; i < list_list_single_gm.size(); i++)
                         {
+                            auto const merged_ent_id =
+                                    batch_group->list_merged_ent_ids[i];
+
                             auto& merged_gm =
                                     m_cmlist_render_data->GetComponent(
-                                        batch_group->list_merged_ent_ids[i]).
-                                    GetGeometry();
+                                        merged_ent_id).GetGeometry();
 
                             detail::CreateMergedGeometry(
                                         batch->GetBufferLayout(),
                                         list_list_single_gm[i],
-                                        &merged_gm);
+                                        &merged_gm,
+                                        batch->GetPrimitive());
 
                             merged_gm.SetAllUpdated();
+                            merged_bytes += detail::GetGeometrySizeBytes(merged_gm);
+
+                            // Converted primitives don't map single
+                            // geometries to a fixed range so they
+                            // can't be patched
+                            if(detail::GetIsListPrimitive(batch->GetPrimitive()))
+                            {
+                                detail::CreateMergedGeometryRanges(
+                                            batch->GetBufferLayout(),
+                                            list_list_single_gm[i],
+                                            list_list_single_ent_ids[i],
+                                            merged_ent_id,
+                                            batch_group->lkup_ent_merged_range);
+                            }
+                        }
+
+                        // Call the post merge callback
+                        if(m_post_merge_callback_sf)
+                        {
+                            m_post_merge_callback_sf(
+                                        group,
+                                        batch_group->list_merged_ent_ids,
+                                        list_list_single_ent_ids);
+                        }
+
+                        // Clear updates
+                        for(auto ent_id : batch_group->list_ents_upd)
+                        {
+                            auto& batch_data = list_batch_data[ent_id];
+                            batch_data.SetRebuild(false);
+                            batch_data.GetGeometry().ClearGeometryUpdates();
                         }
+                    }
+
+                    batch_group->rebuild = false;
+                    batch_group->list_ents_rem.clear();
+                    batch_group->list_ents_upd.clear();
+
+                    recordMergeStats(group,
+                                     detail::GetElapsedMs(time_merge_start),
+                                     merged_bytes,0,0,0);
+                }
+            }
+
+            void updateBatchGroupsTS(std::vector<uint> const &list_ts_batch_groups,
+                                     std::vector<BatchData>& list_batch_data)
+            {
+                auto const time_start = std::chrono::steady_clock::now();
+                u64 merged_bytes = 0;
+                bool merged_any = false;
+
+                auto const budget_left = [&]() -> bool
+                {
+                    if(!merged_any) {
+                        return true;
+                    }
+
+                    if(m_ts_budget_bytes > 0 &&
+                       merged_bytes >= m_ts_budget_bytes) {
+                        return false;
+                    }
+
+                    if(m_ts_budget_ms > 0) {
+                        std::chrono::duration<double,std::milli> const elapsed =
+                                std::chrono::steady_clock::now()-time_start;
+
+                        return (elapsed.count() < m_ts_budget_ms);
+                    }
+
+                    return true;
+                };
+
+                for(auto const group : list_ts_batch_groups)
+                {
+                    auto& batch_group = m_list_batch_groups[group];
+                    auto const time_slice_start = std::chrono::steady_clock::now();
+
+                    // Changes made while a merge is in progress
+                    // wait for the next merge
+                    if(!batch_group->ts_merge &&
+                       (batch_group->rebuild || !batch_group->list_ents_rem.empty()))
+                    {
+                        if(!budget_left()) {
+                            return;
+                        }
+
+                        startMergeTS(group,list_batch_data);
+                    }
+
+                    if(!batch_group->ts_merge) {
+                        continue;
+                    }
+
+                    auto const buffer_layout = batch_group->batch->GetBufferLayout();
+                    auto const primitive = batch_group->batch->GetPrimitive();
+                    auto& ts_merge = *(batch_group->ts_merge);
+                    auto const merged_count = ts_merge.list_list_ent_ids.size();
+                    bool const incremental = (batch_group->chunk_list != nullptr);
+
+                    while(true)
+                    {
+                        // Find the next single geometry to merge
+                        while(ts_merge.merged_idx < merged_count &&
+                              ((incremental && !ts_merge.list_chunk_dirty[ts_merge.merged_idx]) ||
+                               (ts_merge.single_idx ==
+                                ts_merge.list_list_ent_ids[ts_merge.merged_idx].size())))
+                        {
+                            ts_merge.merged_idx++;
+                            ts_merge.single_idx = 0;
+                        }
+
+                        if(ts_merge.merged_idx == merged_count) {
+                            break;
+                        }
+
+                        if(!budget_left()) {
+                            ts_merge.merge_ms += detail::GetElapsedMs(time_slice_start);
+                            return;
+                        }
+
+                        auto const merged_idx = ts_merge.merged_idx;
+                        auto const ent_id =
+                                ts_merge.list_list_ent_ids[merged_idx][ts_merge.single_idx];
+
+                        ts_merge.single_idx++;
+
+                        // Entities that were removed or that no longer fit
+                        // since the merge was started are skipped; their
+                        // changes are merged with the next merge
+                        auto const &single_gm = list_batch_data[ent_id].GetGeometry();
+                        auto& merged_gm = ts_merge.list_merged_gms[merged_idx];
+
+                        if(m_lkup_ent_group[ent_id] != group ||
+                           !getCanAppendTS(buffer_layout,primitive,single_gm,merged_gm))
+                        {
+                            continue;
+                        }
+
+                        detail::AppendMergedGeometry(
+                                    buffer_layout,single_gm,&merged_gm,primitive);
+
+                        ts_merge.list_list_merged_ent_ids[merged_idx].push_back(ent_id);
+
+                        auto const single_bytes = detail::GetGeometrySizeBytes(single_gm);
+                        merged_bytes += single_bytes;
+                        ts_merge.merged_bytes += single_bytes;
+                        merged_any = true;
+                    }
+
+                    ts_merge.merge_ms += detail::GetElapsedMs(time_slice_start);
+                    finishMergeTS(group);
+                }
+            }
+
+            void startMergeTS(uint group,
+                              std::vector<BatchData>& list_batch_data)
+            {
+                auto& batch_group = m_list_batch_groups[group];
+                auto& batch = batch_group->batch;
+                auto ts_merge = make_unique<TimeSlicedMerge>();
+
+                if(batch_group->chunk_list)
+                {
+                    auto& chunk_list = *(batch_group->chunk_list);
+
+                    for(auto const ent_id : batch_group->list_ents_rem)
+                    {
+                        chunk_list.Remove(ent_id);
+                    }
+
+                    for(auto const ent_id : batch_group->list_ents_upd)
+                    {
+                        chunk_list.Update(ent_id,list_batch_data[ent_id].GetGeometry());
+                    }
+
+                    // The merged entities of emptied chunks are kept
+                    // until the merge is finished
+                    for(auto const merged_ent_id : chunk_list.RemoveEmptyChunks())
+                    {
+                        batch_group->list_merged_ent_ids_rem.push_back(
+                                    merged_ent_id);
+                    }
+
+                    createMergedEntitiesForChunks(group);
+
+                    for(auto& chunk : chunk_list.GetChunks())
+                    {
+                        ts_merge->list_chunk_merged_ent_ids.push_back(
+                                    chunk.merged_ent_id);
+
+                        ts_merge->list_list_ent_ids.push_back(
+                                    chunk.list_ent_ids);
+
+                        ts_merge->list_chunk_dirty.push_back(
+                                    chunk.dirty ? 1 : 0);
+                    }
+
+                    ts_merge->packing_stats = chunk_list.GetPackingStats();
+                    chunk_list.ClearDirty();
+                }
+                else
+                {
+                    std::vector<Id> list_ent_ids =
+                            m_pre_merge_callback_sf ?
+                                m_pre_merge_callback_sf(
+                                    group,
+                                    batch_group->list_ents_curr) :
+                                batch_group->list_ents_curr;
+
+                    std::vector<Geometry*> list_single_gm_all;
+                    list_single_gm_all.reserve(list_ent_ids.size());
+
+                    for(auto ent_id : list_ent_ids)
+                    {
+                        list_single_gm_all.push_back(
+                                    &(list_batch_data[ent_id].GetGeometry()));
+                    }
+
+                    auto const list_list_single_gm_ix =
+                            detail::CreateSplitSingleGeometryIxLists(
+                                batch->GetBufferLayout(),
+                                list_single_gm_all,
+                                batch->GetPackingPolicy(),
+                                &(ts_merge->packing_stats),
+                                batch->GetPrimitive());
+
+                    ts_merge->list_list_ent_ids =
+                            detail::CreateSplitLists(
+                                list_ent_ids,
+                                list_list_single_gm_ix);
+                }
+
+                auto const merged_count = ts_merge->list_list_ent_ids.size();
+                ts_merge->list_merged_gms.resize(merged_count);
+                ts_merge->list_list_merged_ent_ids.resize(merged_count);
+
+                for(auto& merged_gm : ts_merge->list_merged_gms)
+                {
+                    detail::InitMergedGeometry(batch->GetBufferLayout(),&merged_gm);
+                }
+
+                // Clear updates
+                for(auto ent_id : batch_group->list_ents_upd)
+                {
+                    auto& batch_data = list_batch_data[ent_id];
+                    batch_data.SetRebuild(false);
+                    batch_data.GetGeometry().ClearGeometryUpdates();
+                }
+
+                batch_group->rebuild = false;
+                batch_group->list_ents_rem.clear();
+                batch_group->list_ents_upd.clear();
+                batch_group->ts_merge = std::move(ts_merge);
+            }
+
+            void finishMergeTS(uint group)
+            {
+                auto& batch_group = m_list_batch_groups[group];
+                auto& ts_merge = *(batch_group->ts_merge);
+                auto const merged_count = ts_merge.list_merged_gms.size();
+                bool const incremental = (batch_group->chunk_list != nullptr);
+                u64 render_data_bytes = 0;
+
+                if(incremental)
+                {
+                    for(auto const merged_ent_id : batch_group->list_merged_ent_ids_rem)
+                    {
+                        m_scene->RemoveEntity(merged_ent_id);
+                    }
+                    batch_group->list_merged_ent_ids_rem.clear();
+
+                    batch_group->list_merged_ent_ids =
+                            ts_merge.list_chunk_merged_ent_ids;
+                }
+                else
+                {
+                    resizeMergedEntityListForBatchGroup(group,merged_count);
+                }
+
+                for(uint i=0; i < merged_count; i++)
+                {
+                    if(incremental && !ts_merge.list_chunk_dirty[i])
+                    {
+                        // Chunks that weren't merged keep their entities
+                        ts_merge.list_list_merged_ent_ids[i] =
+                                ts_merge.list_list_ent_ids[i];
+                        continue;
+                    }
+
+                    auto& merged_rd_gm =
+                            m_cmlist_render_data->GetComponent(
+                                batch_group->list_merged_ent_ids[i]).
+                            GetGeometry();
+
+                    MoveGeometryBuffers(ts_merge.list_merged_gms[i],merged_rd_gm);
+                    merged_rd_gm.SetAllUpdated();
+                    render_data_bytes += detail::GetGeometrySizeBytes(merged_rd_gm);
+                }
+
+                batch_group->packing_stats = ts_merge.packing_stats;
+
+                recordMergeStats(group,
+                                 ts_merge.merge_ms,
+                                 ts_merge.merged_bytes,
+                                 render_data_bytes,0,0);
+
+                // Call the post merge callback
+                if(m_post_merge_callback_sf)
+                {
+                    m_post_merge_callback_sf(
+                                group,
+                                batch_group->list_merged_ent_ids,
+                                ts_merge.list_list_merged_ent_ids);
+                }
+
+                batch_group->ts_merge.reset();
+            }
+
+            static bool getCanAppendTS(BufferLayout const * buffer_layout,
+                                       gl::Primitive primitive,
+                                       Geometry const &single_gm,
+                                       Geometry const &merged_gm)
+            {
+                auto const vx_buff_count = buffer_layout->GetVertexBufferCount();
+
+                if(single_gm.GetVertexBuffers().size() != vx_buff_count)
+                {
+                    return false;
+                }
+
+                for(auto const &vx_data : single_gm.GetVertexBuffers())
+                {
+                    if(!vx_data)
+                    {
+                        return false;
+                    }
+                }
+
+                if(buffer_layout->GetIsIndexed() && !single_gm.GetIndexBuffer())
+                {
+                    return false;
+                }
+
+                auto const single_sizes =
+                        detail::GetMergedSizeBytes(
+                            buffer_layout,primitive,single_gm);
+
+                if(merged_gm.GetVertexBuffer(0)->size()+single_sizes.first >
+                   detail::GetMergedVertexBufferLimit(buffer_layout))
+                {
+                    return false;
+                }
+
+                if(buffer_layout->GetIsIndexed() &&
+                   (merged_gm.GetIndexBuffer()->size()+single_sizes.second >
+                    buffer_layout->GetIndexBufferAllocator()->GetBlockSize()))
+                {
+                    return false;
+                }
+
+                return true;
+            }
+
+            void updateBatchGroupsInstanced(std::vector<uint> const &list_instanced_batch_groups,
+                                            std::vector<BatchData>& list_batch_data)
+            {
+                for(auto const group : list_instanced_batch_groups)
+                {
+                    auto& batch_group = m_list_batch_groups[group];
+                    auto& batch = batch_group->instanced_batch;
+                    auto& base_gm = batch->GetBaseGeometry();
+                    auto const buff_layout = batch->GetBufferLayout();
+
+                    uint const inst_buff_idx =
+                            buff_layout->GetVertexBufferCount()-1;
+
+                    bool const upd_base = base_gm.GetUpdatedGeometry();
+
+                    batch_group->rebuild =
+                            batch_group->rebuild ||
+                            (!batch_group->list_ents_rem.empty());
+
+                    uint const prev_merged_count =
+                            batch_group->list_merged_ent_ids.size();
+
+                    auto const time_merge_start = std::chrono::steady_clock::now();
+                    bool const merged = batch_group->rebuild || upd_base;
+                    u64 merged_bytes = 0;
+
+                    if(batch_group->rebuild)
+                    {
+                        // Every merged geometry holds as many instance
+                        // records as fit in an instance buffer block
+                        uint const inst_size_bytes =
+                                buff_layout->GetVertexSizeBytes(inst_buff_idx);
+
+                        uint const limit_bytes =
+                                (buff_layout->
+                                 GetVertexBufferAllocator(inst_buff_idx)->
+                                 GetBlockSize()/inst_size_bytes)*inst_size_bytes;
+
+                        std::vector<u8> list_inst_data;
+                        for(auto const ent_id : batch_group->list_ents_curr)
+                        {
+                            auto const &single_gm =
+                                    list_batch_data[ent_id].GetGeometry();
+
+                            if(single_gm.GetVertexBuffers().empty() ||
+                               !single_gm.GetVertexBuffer(0))
+                            {
+                                continue;
+                            }
+
+                            auto const &inst_data = *(single_gm.GetVertexBuffer(0));
+                            if(inst_data.size()%inst_size_bytes != 0)
+                            {
+                                throw ks::Exception(
+                                            ks::Exception::ErrorLevel::ERROR,
+                                            "BatchSystem: Instance data size "
+                                            "isn't a multiple of the instance "
+                                            "record size");
+                            }
+
+                            list_inst_data.insert(list_inst_data.end(),
+                                                  inst_data.begin(),
+                                                  inst_data.end());
+                        }
+
+                        uint const merged_count =
+                                (list_inst_data.size()+limit_bytes-1)/limit_bytes;
+
+                        resizeMergedEntityListForBatchGroup(group,merged_count);
+
+                        // The packing stats of instanced groups describe
+                        // the instance buffer
+                        batch_group->packing_stats = BatchPackingStats{};
+                        batch_group->packing_stats.merged_count = merged_count;
+                        batch_group->packing_stats.min_merged_count = merged_count;
+                        batch_group->packing_stats.vx_size_bytes = list_inst_data.size();
+                        batch_group->packing_stats.vx_capacity_bytes =
+                                u64(merged_count)*limit_bytes;
+
+                        merged_bytes += list_inst_data.size();
+
+                        for(uint i=0; i < merged_count; i++)
+                        {
+                            auto& merged_gm =
+                                    m_cmlist_render_data->GetComponent(
+                                        batch_group->list_merged_ent_ids[i]).
+                                    GetGeometry();
+
+                            auto const start = i*limit_bytes;
+                            auto const end =
+                                    std::min<std::size_t>(
+                                        start+limit_bytes,
+                                        list_inst_data.size());
+
+                            merged_gm.GetVertexBuffer(inst_buff_idx)->assign(
+                                        list_inst_data.begin()+start,
+                                        list_inst_data.begin()+end);
+
+                            merged_gm.SetVertexBufferUpdated(inst_buff_idx);
+                        }
+
+                        // Clear updates
+                        for(auto ent_id : batch_group->list_ents_upd)
+                        {
+                            auto& batch_data = list_batch_data[ent_id];
+                            batch_data.SetRebuild(false);
+                            batch_data.GetGeometry().ClearGeometryUpdates();
+                        }
+                    }
+
+                    // The base geometry is only copied to merged
+                    // geometries that are new or when it changes
+                    auto const &list_merged_ent_ids = batch_group->list_merged_ent_ids;
+
+                    for(uint i=0; i < list_merged_ent_ids.size(); i++)
+                    {
+                        if(!upd_base && i < prev_merged_count)
+                        {
+                            continue;
+                        }
+
+                        auto& merged_gm =
+                                m_cmlist_render_data->GetComponent(
+                                    list_merged_ent_ids[i]).GetGeometry();
+
+                        auto const &list_base_vx = base_gm.GetVertexBuffers();
+                        for(uint j=0; j < inst_buff_idx && j < list_base_vx.size(); j++)
+                        {
+                            if(list_base_vx[j])
+                            {
+                                *(merged_gm.GetVertexBuffer(j)) = *(list_base_vx[j]);
+                                merged_gm.SetVertexBufferUpdated(j);
+                                merged_bytes += list_base_vx[j]->size();
+                            }
+                        }
+
+                        if(base_gm.GetIndexBuffer() && merged_gm.GetIndexBuffer())
+                        {
+                            *(merged_gm.GetIndexBuffer()) = *(base_gm.GetIndexBuffer());
+                            merged_gm.SetIndexBufferUpdated();
+                            merged_bytes += base_gm.GetIndexBuffer()->size();
+                        }
+                    }
+
+                    base_gm.ClearGeometryUpdates();
+
+                    batch_group->rebuild = false;
+                    batch_group->list_ents_rem.clear();
+                    batch_group->list_ents_upd.clear();
+
+                    if(merged)
+                    {
+                        recordMergeStats(group,
+                                         detail::GetElapsedMs(time_merge_start),
+                                         merged_bytes,0,0,0);
+                    }
+                }
+            }
+
+            // * Patches the merged geometry of updated entities whose
+            //   geometry kept its size and removes them from the
+            //   batch group's list_ents_upd. In MergeMode::Rebuild
+            //   the group is merged again anyway if any entity can't
+            //   be patched, so nothing is patched in that case.
+            //   Returns the number of bytes that were patched
+            u64 patchMergedGeometrySF(uint group,
+                                      std::vector<BatchData>& list_batch_data)
+            {
+                auto& batch_group = m_list_batch_groups[group];
+                auto const buffer_layout = batch_group->batch->GetBufferLayout();
+                auto const &lkup_ranges = batch_group->lkup_ent_merged_range;
+
+                bool const incremental = (batch_group->chunk_list != nullptr);
+
+                if(!incremental && !batch_group->list_ents_rem.empty())
+                {
+                    return 0;
+                }
+
+                std::vector<Id> list_ents_patch;
+                std::vector<Id> list_ents_merge;
+
+                for(auto const ent_id : batch_group->list_ents_upd)
+                {
+                    auto it = lkup_ranges.find(ent_id);
+
+                    bool const can_patch =
+                            (it != lkup_ranges.end()) &&
+                            detail::GetCanPatchMergedGeometry(
+                                buffer_layout,
+                                list_batch_data[ent_id].GetGeometry(),
+                                it->second,
+                                m_cmlist_render_data->GetComponent(
+                                    it->second.merged_ent_id).GetGeometry());
+
+                    if(can_patch) {
+                        list_ents_patch.push_back(ent_id);
+                    }
+                    else {
+                        list_ents_merge.push_back(ent_id);
+                    }
+                }
+
+                if(!incremental && !list_ents_merge.empty())
+                {
+                    return 0;
+                }
+
+                u64 patched_bytes = 0;
+
+                for(auto const ent_id : list_ents_patch)
+                {
+                    auto const &range = lkup_ranges.find(ent_id)->second;
+                    auto& batch_data = list_batch_data[ent_id];
+
+                    detail::PatchMergedGeometry(
+                                buffer_layout,
+                                batch_data.GetGeometry(),
+                                range,
+                                &(m_cmlist_render_data->GetComponent(
+                                    range.merged_ent_id).GetGeometry()));
+
+                    patched_bytes += detail::GetGeometrySizeBytes(batch_data.GetGeometry());
+
+                    batch_data.SetRebuild(false);
+                    batch_data.GetGeometry().ClearGeometryUpdates();
+                }
+
+                batch_group->list_ents_upd = std::move(list_ents_merge);
+
+                return patched_bytes;
+            }
+
+            // * Returns the number of bytes that were merged
+            u64 mergeChunksSF(uint group,
+                              std::vector<BatchData>& list_batch_data)
+            {
+                auto& batch_group = m_list_batch_groups[group];
+                auto& batch = batch_group->batch;
+                auto& chunk_list = *(batch_group->chunk_list);
+
+                // Update chunk assignments
+                for(auto const ent_id : batch_group->list_ents_rem)
+                {
+                    chunk_list.Remove(ent_id);
+                    batch_group->lkup_ent_merged_range.erase(ent_id);
+                }
+
+                for(auto const ent_id : batch_group->list_ents_upd)
+                {
+                    chunk_list.Update(ent_id,list_batch_data[ent_id].GetGeometry());
+                }
+
+                for(auto const merged_ent_id : chunk_list.RemoveEmptyChunks())
+                {
+                    m_scene->RemoveEntity(merged_ent_id);
+                }
+
+                createMergedEntitiesForChunks(group);
+
+                batch_group->packing_stats = chunk_list.GetPackingStats();
+
+                // Only merge dirty chunks
+                auto& list_chunks = chunk_list.GetChunks();
+                batch_group->list_merged_ent_ids.clear();
+                u64 merged_bytes = 0;
+
+                for(auto& chunk : list_chunks)
+                {
+                    batch_group->list_merged_ent_ids.push_back(
+                                chunk.merged_ent_id);
+
+                    if(!chunk.dirty)
+                    {
+                        continue;
+                    }
+
+                    std::vector<Geometry*> list_single_gm;
+                    list_single_gm.reserve(chunk.list_ent_ids.size());
+
+                    for(auto const ent_id : chunk.list_ent_ids)
+                    {
+                        list_single_gm.push_back(
+                                    &(list_batch_data[ent_id].GetGeometry()));
+                    }
+
+                    auto& merged_gm =
+                            m_cmlist_render_data->GetComponent(
+                                chunk.merged_ent_id).GetGeometry();
+
+                    detail::CreateMergedGeometry(
+                                batch->GetBufferLayout(),
+                                list_single_gm,
+                                &merged_gm,
+                                batch->GetPrimitive());
 
-                        // Call the post merge callback
-                        if(m_post_merge_callback_sf)
-                        {
-                            auto list_list_single_ent_ids =
-                                    detail::CreateSplitSingleGmEntIdLists(
-                                        *list_ents_curr_ptr,
-                                        list_list_single_gm);
+                    merged_gm.SetAllUpdated();
+                    merged_bytes += detail::GetGeometrySizeBytes(merged_gm);
 
-                            m_post_merge_callback_sf(
-                                        group,
-                                        batch_group->list_merged_ent_ids,
-                                        list_list_single_ent_ids);
-                        }
+                    if(detail::GetIsListPrimitive(batch->GetPrimitive()))
+                    {
+                        detail::CreateMergedGeometryRanges(
+                                    batch->GetBufferLayout(),
+                                    list_single_gm,
+                                    chunk.list_ent_ids,
+                                    chunk.merged_ent_id,
+                                    batch_group->lkup_ent_merged_range);
+                    }
+                }
 
-                        // Clear updates
-                        for(auto ent_id : batch_group->list_ents_upd)
-                        {
-                            auto& batch_data = list_batch_data[ent_id];
-                            batch_data.SetRebuild(false);
-                            batch_data.GetGeometry().ClearGeometryUpdates();
-                        }
+                // Call the post merge callback
+                if(m_post_merge_callback_sf)
+                {
+                    std::vector<std::vector<Id>> list_list_single_ent_ids;
+                    list_list_single_ent_ids.reserve(list_chunks.size());
+
+                    for(auto& chunk : list_chunks)
+                    {
+                        list_list_single_ent_ids.push_back(
+                                    chunk.list_ent_ids);
                     }
 
-                    batch_group->list_ents_prev =
-                            batch_group->list_ents_curr;
+                    m_post_merge_callback_sf(
+                                group,
+                                batch_group->list_merged_ent_ids,
+                                list_list_single_ent_ids);
+                }
+
+                chunk_list.ClearDirty();
+
+                // Clear updates
+                for(auto ent_id : batch_group->list_ents_upd)
+                {
+                    auto& batch_data = list_batch_data[ent_id];
+                    batch_data.SetRebuild(false);
+                    batch_data.GetGeometry().ClearGeometryUpdates();
                 }
+
+                return merged_bytes;
             }
 
             void updateBatchGroupsMF(std::vector<uint> const &list_mf_batch_groups,
                                      std::vector<BatchData>& list_batch_data)
             {
-                // Resize BatchGeometry list if necessary
-                if(m_list_batch_geometry.size() < m_scene->GetEntityList().size()) {
-                    m_list_batch_geometry.resize(m_scene->GetEntityList().size());
+                // Resize BatchGeometry list if necessary. Running tasks
+                // read it so it's only resized when there are none
+                if(m_list_batch_tasks.empty() &&
+                   m_list_batch_geometry.GetSize() < m_scene->GetEntityList().size()) {
+                    m_list_batch_geometry.Resize(m_scene->GetEntityList().size());
+                    m_lkup_ent_snapshot_group.resize(m_scene->GetEntityList().size(),0);
                 }
 
+                auto const batchable_mask =
+                        ecs::Scene<SceneKeyType>::template
+                            GetComponentMask<BatchData>();
+
+                auto const &list_entities = m_scene->GetEntityList();
+
                 for(auto const group : list_mf_batch_groups)
                 {
                     auto& batch_group = m_list_batch_groups[group];
@@ -585,25 +1994,40 @@ namespace ks
                     // For a MultiFramed batch we need to know which
                     // Geometry must be removed or copied for processing
                     // in a separate thread
-
-                    std::set_difference(
-                                batch_group->list_ents_prev.begin(),
-                                batch_group->list_ents_prev.end(),
-                                batch_group->list_ents_curr.begin(),
-                                batch_group->list_ents_curr.end(),
-                                std::back_inserter(batch_group->list_ents_rem));
-
                     batch_group->rebuild =
                             batch_group->rebuild ||
                             (!batch_group->list_ents_rem.empty());
 
                     if(batch_group->rebuild)
                     {
-                        // Remove old geometry
+                        // Remove old geometry. No task reads it anymore
+                        // so moved geometry is handed back to entities
+                        // that still have BatchData. Geometry another
+                        // group has since taken is left alone
                         for(auto const ent_id : batch_group->list_ents_rem)
                         {
-                            m_list_batch_geometry[ent_id].GetVertexBuffers().clear();
-                            m_list_batch_geometry[ent_id].GetIndexBuffer().reset();
+                            if(m_lkup_ent_snapshot_group[ent_id] != group)
+                            {
+                                continue;
+                            }
+
+                            if((list_entities[ent_id].mask & batchable_mask) ==
+                               batchable_mask)
+                            {
+                                restoreMovedGeometry(
+                                            ent_id,list_batch_data[ent_id],false);
+                            }
+
+                            m_list_batch_geometry.Remove(ent_id);
+                            m_lkup_ent_snapshot_group[ent_id] = 0;
+                        }
+
+                        if(batch_group->chunk_list)
+                        {
+                            for(auto const ent_id : batch_group->list_ents_rem)
+                            {
+                                batch_group->chunk_list->Remove(ent_id);
+                            }
                         }
 
                         // The updated geometry must be copied over *after*
@@ -611,22 +2035,74 @@ namespace ks
                     }
                 }
 
-                // Copy updated geometry we want to merge
+                // Copy updated geometry we want to merge. Geometry that
+                // doesn't need to be retained is moved instead; the
+                // BatchData must have its buffers set again before it
+                // is next rebuilt unless it leaves the group
                 for(auto const group : list_mf_batch_groups)
                 {
                     auto& batch_group = m_list_batch_groups[group];
 
                     for(auto const ent_id : batch_group->list_ents_upd)
                     {
-                        CopyGeometryBuffers(
-                                    list_batch_data[ent_id].GetGeometry(),
-                                    m_list_batch_geometry[ent_id]);
+                        auto& single_gm = list_batch_data[ent_id].GetGeometry();
+
+                        if(single_gm.GetRetainGeometry())
+                        {
+                            bool const shared =
+                                    m_list_batch_geometry.Copy(
+                                        ent_id,single_gm);
+
+                            auto const copy_bytes =
+                                    detail::GetGeometrySizeBytes(single_gm);
+
+                            if(shared)
+                            {
+                                m_stats.snapshot_shared_bytes += copy_bytes;
+                            }
+                            else
+                            {
+                                batch_group->mf_snapshot_bytes += copy_bytes;
+                                m_stats.snapshot_bytes += copy_bytes;
+                            }
+                        }
+                        else
+                        {
+                            m_list_batch_geometry.Move(ent_id,single_gm);
+                        }
+
+                        m_lkup_ent_snapshot_group[ent_id] = group;
 
                         // Clear updates
                         auto& batch_data = list_batch_data[ent_id];
                         batch_data.SetRebuild(false);
                         batch_data.GetGeometry().ClearGeometryUpdates();
                     }
+
+                    if(batch_group->chunk_list && batch_group->rebuild)
+                    {
+                        auto& chunk_list = *(batch_group->chunk_list);
+
+                        for(auto const ent_id : batch_group->list_ents_upd)
+                        {
+                            chunk_list.Update(ent_id,m_list_batch_geometry.Get(ent_id));
+                        }
+
+                        // The merged entities of emptied chunks are kept
+                        // until this snapshot's result is applied so the
+                        // batch group is updated all at once
+                        for(auto const merged_ent_id : chunk_list.RemoveEmptyChunks())
+                        {
+                            batch_group->list_merged_ent_ids_rem.push_back(
+                                        merged_ent_id);
+                        }
+
+                        // New chunks get an empty merged RenderData
+                        // right away (which won't be drawn)
+                        createMergedEntitiesForChunks(group);
+
+                        batch_group->packing_stats = chunk_list.GetPackingStats();
+                    }
                 }
             }
 
@@ -634,116 +2110,448 @@ namespace ks
                                  std::vector<BatchData>& list_batch_data,
                                  std::vector<RenderData>& list_render_data)
             {
+                // Running tasks for batch groups that have changed since
+                // their snapshot are stale; cancel them so a new snapshot
+                // can be taken as soon as they stop
+                if(m_mf_supersede_tasks)
+                {
+                    for(auto& batch_task : m_list_batch_tasks)
+                    {
+                        if(!batch_task->IsFinished() &&
+                           getBatchTaskIsStale(*batch_task))
+                        {
+                            batch_task->Cancel();
+                        }
+                    }
+                }
 
-                if(m_batch_task && !m_batch_task->IsFinished())
+                // Results are applied in the order the tasks were
+                // created, which is batch group order within each
+                // snapshot, so a finished task only waits on the
+                // tasks ahead of it
+                uint applied_count=0;
+                for(auto& batch_task : m_list_batch_tasks)
                 {
-                    return;
+                    if(!batch_task->IsFinished())
+                    {
+                        break;
+                    }
+
+                    applyBatchTask(*batch_task,list_render_data);
+                    applied_count++;
                 }
 
-                updateBatchGroupsMF(list_mf_batch_groups,
-                                    list_batch_data);
+                m_list_batch_tasks.erase(
+                            m_list_batch_tasks.begin(),
+                            m_list_batch_tasks.begin()+applied_count);
+
+                auto const list_ready_batch_groups =
+                        getReadyMFBatchGroups(list_mf_batch_groups);
+
+                if(!list_ready_batch_groups.empty())
+                {
+                    updateBatchGroupsMF(list_ready_batch_groups,
+                                        list_batch_data);
+
+                    // Invoke the PreTaskCallback if its valid
+                    if(m_pre_task_callback)
+                    {
+                        m_pre_task_callback();
+                    }
+
+                    uint const new_task_idx = m_list_batch_tasks.size();
+
+                    // Create a desc of the current state for each rebuilt
+                    // MultiFrame batch group and launch a separate task
+                    // for each one so they can be merged in parallel
+                    for(auto const group : list_ready_batch_groups)
+                    {
+                        auto& batch_group = m_list_batch_groups[group];
+
+                        if(batch_group->rebuild)
+                        {
+                            auto list_batch_desc =
+                                    make_unique<std::vector<detail::BatchTask::BatchDesc>>();
+
+                            list_batch_desc->push_back(
+                                        detail::BatchTask::BatchDesc{
+                                            batch_group->uid,
+                                            group,
+                                            batch_group->batch->GetBufferLayout(),
+                                            batch_group->batch->GetPackingPolicy(),
+                                            batch_group->batch->GetPrimitive(),
+                                            batch_group->list_ents_curr,
+                                            false,{},{},{},{},
+                                            batch_group->mf_snapshot_bytes
+                                        });
+
+                            batch_group->mf_snapshot_bytes = 0;
+
+                            if(batch_group->chunk_list)
+                            {
+                                setChunkLayoutForBatchDesc(
+                                            group,
+                                            list_batch_desc->back());
+                            }
+
+                            m_list_batch_tasks.push_back(
+                                        make_shared<detail::BatchTask>(
+                                            std::move(list_batch_desc),
+                                            m_list_batch_geometry,
+                                            m_pre_merge_callback_mf));
+                        }
+
+                        batch_group->rebuild = false;
+                        batch_group->list_ents_rem.clear();
+                        batch_group->list_ents_upd.clear();
+                    }
+
+                    for(uint i=new_task_idx; i < m_list_batch_tasks.size(); i++)
+                    {
+                        m_thread_pool.PushBack(m_list_batch_tasks[i]);
+                    }
+                }
+            }
+
+            // * A MultiFrame batch group can take a new snapshot once
+            //   it has no task whose results are waiting to be applied
+            //   and no other group's task reads the geometry of the
+            //   entities it would replace
+            // * Resizing the snapshot or copying it with dedup enabled
+            //   changes storage every task reads, so snapshots of new
+            //   entities or with dedup enabled wait for all tasks
+            std::vector<uint> getReadyMFBatchGroups(
+                    std::vector<uint> const &list_mf_batch_groups)
+            {
+                if(m_list_batch_tasks.empty())
+                {
+                    return list_mf_batch_groups;
+                }
+
+                std::vector<uint> list_ready_batch_groups;
+
+                if(m_list_batch_geometry.GetDedup())
+                {
+                    return list_ready_batch_groups;
+                }
+
+                std::vector<u8> list_group_busy(m_list_batch_groups.GetList().size(),0);
+                for(auto& batch_task : m_list_batch_tasks)
+                {
+                    for(auto const &batch_desc : batch_task->GetListBatchDesc())
+                    {
+                        if(batch_desc.batch_id < list_group_busy.size())
+                        {
+                            list_group_busy[batch_desc.batch_id] = 1;
+                        }
+                    }
+                }
+
+                auto const get_ent_busy =
+                        [&](Id ent_id)
+                        {
+                            if(ent_id >= m_lkup_ent_snapshot_group.size())
+                            {
+                                return true;
+                            }
+
+                            auto const group = m_lkup_ent_snapshot_group[ent_id];
+                            return (group < list_group_busy.size() &&
+                                    list_group_busy[group]);
+                        };
+
+                for(auto const group : list_mf_batch_groups)
+                {
+                    if(list_group_busy[group])
+                    {
+                        continue;
+                    }
 
-                if(m_batch_task)
+                    auto& batch_group = m_list_batch_groups[group];
+
+                    bool const ents_busy =
+                            std::any_of(batch_group->list_ents_upd.begin(),
+                                        batch_group->list_ents_upd.end(),
+                                        get_ent_busy) ||
+                            std::any_of(batch_group->list_ents_rem.begin(),
+                                        batch_group->list_ents_rem.end(),
+                                        get_ent_busy);
+
+                    if(!ents_busy)
+                    {
+                        list_ready_batch_groups.push_back(group);
+                    }
+                }
+
+                return list_ready_batch_groups;
+            }
+
+            // * Syncs back the merged geometry of a finished task to
+            //   the RenderData of its batch groups
+            void applyBatchTask(detail::BatchTask& batch_task,
+                                std::vector<RenderData>& list_render_data)
+            {
+                BatchStats::TaskStats task_stats;
+                task_stats.batch_desc_count = batch_task.GetListBatchDesc().size();
+                task_stats.queue_ms = batch_task.GetQueueMs();
+                task_stats.process_ms = batch_task.GetProcessMs();
+                task_stats.merged_bytes = 0;
+                task_stats.cancelled = batch_task.IsCancelled();
+
+                for(uint i=0; i < batch_task.GetListBatchDesc().size(); i++)
                 {
-                    // Sync back the merged geometry from m_list_batch_geometry
-                    // to its corresponding RenderData geometry
-                    for(uint i=0; i < m_batch_task->GetListBatchDesc().size(); i++)
+                    auto const &batch_desc = batch_task.GetListBatchDesc()[i];
+                    auto const batch_id = batch_desc.batch_id;
+
+                    // The merged entities of removed batch groups
+                    // were released by RemoveBatch
+                    if(!getBatchDescIsValid(batch_desc))
+                    {
+                        continue;
+                    }
+
+                    if(batch_task.IsCancelled())
+                    {
+                        restoreCancelledBatchDesc(batch_desc);
+                    }
+                    else
                     {
-                        auto const &batch_desc = m_batch_task->GetListBatchDesc()[i];
-                        auto const batch_id = batch_desc.batch_id;
+                        auto& list_merged_gm =
+                                batch_task.GetListMergedGeometry(i);
 
-                        if(batch_id < m_list_batch_groups.GetList().size() &&
-                           m_list_batch_groups[batch_id] &&
-                           m_list_batch_groups[batch_id]->uid == batch_desc.uid)
+                        auto& batch_group = m_list_batch_groups[batch_id];
+
+                        if(batch_desc.incremental)
                         {
-                            auto& list_merged_gm =
-                                    m_batch_task->GetListMergedGeometry(i);
+                            releaseMergedEntsForBatchDesc(batch_desc);
 
+                            batch_group->list_merged_ent_ids =
+                                    batch_desc.list_chunk_merged_ent_ids;
+                        }
+                        else
+                        {
                             // Ensure there are enough merged RenderData
                             resizeMergedEntityListForBatchGroup(
                                         batch_id,
                                         list_merged_gm.size());
 
-                            auto& batch_group = m_list_batch_groups[batch_id];
+                            batch_group->packing_stats =
+                                    batch_task.GetPackingStats(i);
+                        }
+
+                        u64 render_data_bytes = 0;
 
-                            for(uint j=0; j < list_merged_gm.size(); j++)
+                        for(uint j=0; j < list_merged_gm.size(); j++)
+                        {
+                            if(batch_desc.incremental &&
+                               !batch_desc.list_chunk_dirty[j])
                             {
-                                auto const merged_ent_id =
-                                        batch_group->list_merged_ent_ids[j];
+                                continue;
+                            }
 
-                                auto& merged_rd_gm =
-                                        list_render_data[merged_ent_id].GetGeometry();
+                            auto const merged_ent_id =
+                                    batch_group->list_merged_ent_ids[j];
 
-                                // TODO move instead of copy
-                                CopyGeometryBuffers(
-                                            list_merged_gm[j],
-                                            merged_rd_gm);
+                            auto& merged_rd_gm =
+                                    list_render_data[merged_ent_id].GetGeometry();
 
-                                merged_rd_gm.SetAllUpdated();
-                            }
+                            // The task is discarded once its results
+                            // are applied so its buffers can be moved
+                            MoveGeometryBuffers(
+                                        list_merged_gm[j],
+                                        merged_rd_gm);
 
-                            // Call the post merge callback
-                            if(m_post_merge_callback_mf)
-                            {
-                                m_post_merge_callback_mf(
-                                            batch_id,
-                                            batch_group->list_merged_ent_ids,
-                                            m_batch_task->GetSplitSingleGmEntIdLists(i));
-                            }
+                            merged_rd_gm.SetAllUpdated();
+                            render_data_bytes +=
+                                    detail::GetGeometrySizeBytes(merged_rd_gm);
+                        }
 
-                            batch_group->list_ents_prev =
-                                    batch_group->list_ents_curr;
+                        task_stats.merged_bytes += batch_task.GetMergedBytes(i);
+
+                        recordMergeStats(batch_id,
+                                         batch_task.GetMergeMs(i),
+                                         batch_task.GetMergedBytes(i),
+                                         render_data_bytes,
+                                         batch_desc.snapshot_bytes,
+                                         batch_task.GetQueueMs());
+
+                        // Call the post merge callback
+                        if(m_post_merge_callback_mf)
+                        {
+                            m_post_merge_callback_mf(
+                                        batch_id,
+                                        batch_group->list_merged_ent_ids,
+                                        batch_task.GetSplitSingleGmEntIdLists(i));
                         }
                     }
-
-                    m_batch_task=nullptr;
                 }
 
-                if(!list_mf_batch_groups.empty())
+                m_stats.list_task_stats.push_back(task_stats);
+            }
+
+            bool getBatchDescIsValid(detail::BatchTask::BatchDesc const &batch_desc)
+            {
+                auto const batch_id = batch_desc.batch_id;
+
+                return (batch_id < m_list_batch_groups.GetList().size() &&
+                        m_list_batch_groups[batch_id] &&
+                        m_list_batch_groups[batch_id]->uid == batch_desc.uid);
+            }
+
+            // * A task is stale if any of its batch groups were
+            //   removed or have changes waiting for a new snapshot
+            bool getBatchTaskIsStale(detail::BatchTask const &batch_task)
+            {
+                for(auto const &batch_desc : batch_task.GetListBatchDesc())
                 {
-                    // Create a desc of the current MultiFrame batch group state
-                    // rn list_batch_descs_new
-                    auto list_batch_desc_next =
-                            make_unique<std::vector<detail::BatchTask::BatchDesc>>();
+                    if(!getBatchDescIsValid(batch_desc))
+                    {
+                        return true;
+                    }
 
-                    for(auto const group : list_mf_batch_groups)
+                    auto& batch_group = m_list_batch_groups[batch_desc.batch_id];
+                    if(batch_group->rebuild || !batch_group->list_ents_rem.empty())
                     {
-                        auto& batch_group = m_list_batch_groups[group];
+                        return true;
+                    }
+                }
 
-                        if(batch_group->rebuild)
+                return false;
+            }
+
+            // * Puts back the state that was handed to a BatchDesc
+            //   whose task was cancelled so the batch group is
+            //   merged again with the next snapshot
+            void restoreCancelledBatchDesc(detail::BatchTask::BatchDesc const &batch_desc)
+            {
+                auto& batch_group = m_list_batch_groups[batch_desc.batch_id];
+                batch_group->rebuild = true;
+
+                if(!batch_desc.incremental)
+                {
+                    return;
+                }
+
+                for(auto& chunk : batch_group->chunk_list->GetChunks())
+                {
+                    for(uint j=0; j < batch_desc.list_chunk_merged_ent_ids.size(); j++)
+                    {
+                        if(batch_desc.list_chunk_merged_ent_ids[j] == chunk.merged_ent_id &&
+                           batch_desc.list_chunk_dirty[j])
                         {
-                            list_batch_desc_next->push_back(
-                                        detail::BatchTask::BatchDesc{
-                                            batch_group->uid,
-                                            group,
-                                            batch_group->batch->GetBufferLayout(),
-                                            batch_group->list_ents_curr
-                                        });
+                            chunk.dirty = true;
+                            break;
                         }
                     }
+                }
+            }
 
-                    // Invoke the PreTaskCallback if its valid
-                    if(m_pre_task_callback)
+            // * Removes the merged entities of chunks that were
+            //   emptied before the desc's snapshot. The batch group
+            //   keeps their ids until now so RemoveBatch can remove
+            //   them while the task is running
+            void releaseMergedEntsForBatchDesc(detail::BatchTask::BatchDesc const &batch_desc)
+            {
+                auto& batch_group = m_list_batch_groups[batch_desc.batch_id];
+                auto& list_merged_ent_ids_rem = batch_group->list_merged_ent_ids_rem;
+
+                for(auto const merged_ent_id : batch_desc.list_merged_ent_ids_rem)
+                {
+                    auto it = std::find(list_merged_ent_ids_rem.begin(),
+                                        list_merged_ent_ids_rem.end(),
+                                        merged_ent_id);
+
+                    if(it != list_merged_ent_ids_rem.end())
                     {
-                        m_pre_task_callback();
+                        m_scene->RemoveEntity(merged_ent_id);
+                        list_merged_ent_ids_rem.erase(it);
                     }
+                }
+            }
+
+            void setChunkLayoutForBatchDesc(Id batch_id,
+                                            detail::BatchTask::BatchDesc& batch_desc)
+            {
+                auto& batch_group = m_list_batch_groups.Get(batch_id);
+                auto& chunk_list = *(batch_group->chunk_list);
+
+                batch_desc.incremental = true;
+
+                for(auto& chunk : chunk_list.GetChunks())
+                {
+                    batch_desc.list_chunk_merged_ent_ids.push_back(
+                                chunk.merged_ent_id);
 
-                    // Launch a new task
-                    m_batch_task =
-                            make_shared<detail::BatchTask>(
-                                std::move(list_batch_desc_next),
-                                m_list_batch_geometry,
-                                m_pre_merge_callback_mf);
+                    batch_desc.list_list_chunk_ent_ids.push_back(
+                                chunk.list_ent_ids);
 
-                    m_thread_pool.PushBack(m_batch_task);
+                    batch_desc.list_chunk_dirty.push_back(
+                                chunk.dirty ? 1 : 0);
                 }
+
+                batch_desc.list_merged_ent_ids_rem =
+                        batch_group->list_merged_ent_ids_rem;
+
+                chunk_list.ClearDirty();
             }
 
-            void createMergedEntityForBatchGroup(Id batch_id)
+            void resetGroupStats(Id batch_id)
+            {
+                if(m_stats.list_group_stats.size() <= batch_id)
+                {
+                    m_stats.list_group_stats.resize(batch_id+1);
+                }
+
+                m_stats.list_group_stats[batch_id] = BatchStats::GroupStats{};
+                m_stats.list_group_stats[batch_id].valid = true;
+            }
+
+            void recordMergeStats(Id batch_id,
+                                  double merge_ms,
+                                  u64 merged_bytes,
+                                  u64 render_data_bytes,
+                                  u64 snapshot_bytes,
+                                  double task_queue_ms)
+            {
+                auto& batch_group = m_list_batch_groups[batch_id];
+                auto& packing_stats = batch_group->packing_stats;
+                auto& group_stats = m_stats.list_group_stats[batch_id];
+
+                group_stats.merge_count++;
+                group_stats.merge_ms = merge_ms;
+                group_stats.task_queue_ms = task_queue_ms;
+                group_stats.snapshot_bytes = snapshot_bytes;
+                group_stats.merged_bytes = merged_bytes;
+                group_stats.render_data_bytes = render_data_bytes;
+                group_stats.chunk_count = batch_group->list_merged_ent_ids.size();
+                group_stats.chunk_fill_ratio =
+                        (packing_stats.vx_capacity_bytes > 0) ?
+                            double(packing_stats.vx_size_bytes)/
+                            packing_stats.vx_capacity_bytes : 0.0;
+
+                m_stats.merge_count++;
+                m_stats.merged_bytes += merged_bytes;
+                m_stats.render_data_bytes += render_data_bytes;
+            }
+
+            void createMergedEntitiesForChunks(Id batch_id)
             {
                 auto& batch_group = m_list_batch_groups.Get(batch_id);
-                auto& batch = batch_group->batch;
 
+                for(auto& chunk : batch_group->chunk_list->GetChunks())
+                {
+                    if(chunk.merged_ent_id == 0)
+                    {
+                        chunk.merged_ent_id =
+                                createMergedEntity(batch_group->batch);
+                    }
+                }
+            }
+
+            // * BatchType: Batch or InstancedBatch
+            template<typename BatchType>
+            Id createMergedEntity(shared_ptr<BatchType>& batch)
+            {
                 // Create the merged Entity and RenderData
                 auto merged_ent_id = m_scene->CreateEntity();
                 auto& render_data =
@@ -775,7 +2583,17 @@ namespace ks
                             make_unique<std::vector<u8>>();
                 }
 
-                batch_group->list_merged_ent_ids.push_back(merged_ent_id);
+                return merged_ent_id;
+            }
+
+            void createMergedEntityForBatchGroup(Id batch_id)
+            {
+                auto& batch_group = m_list_batch_groups.Get(batch_id);
+
+                batch_group->list_merged_ent_ids.push_back(
+                            batch_group->instanced_batch ?
+                                createMergedEntity(batch_group->instanced_batch) :
+                                createMergedEntity(batch_group->batch));
             }
 
             void resizeMergedEntityListForBatchGroup(Id batch_id, uint new_size)
@@ -812,9 +2630,11 @@ namespace ks
             // * Used to store single geometry for the BatchTask
             //   so that it can be accessed and manipulated
             //   asynchronously by another thread
-            std::vector<Geometry> m_list_batch_geometry;
+            detail::BatchGeometryList m_list_batch_geometry;
 
-            shared_ptr<detail::BatchTask> m_batch_task;
+            // * The BatchTasks for the current MultiFrame snapshot,
+            //   in batch group order
+            std::vector<shared_ptr<detail::BatchTask>> m_list_batch_tasks;
 
             // * Single frame callbacks
             BatchPreMergeCallback m_pre_merge_callback_sf;
@@ -825,8 +2645,29 @@ namespace ks
             BatchPreMergeCallback m_pre_merge_callback_mf;
             BatchPostMergeCallback m_post_merge_callback_mf;
 
+            bool m_mf_supersede_tasks{false};
+
+            // * Time sliced budget (0 means no limit)
+            double m_ts_budget_ms{2.0};
+            uint m_ts_budget_bytes{0};
+
+            BatchStats m_stats;
+
             Id m_batch_group_uid_counter;
 
+            // * Entities whose BatchData changed since the last
+            //   Update and the batch group each entity is in
+            shared_ptr<EntityChangeList> m_batch_data_changes;
+            std::vector<Id> m_lkup_ent_group;
+
+            // * The MultiFrame group whose snapshot last took each
+            //   entity's geometry (0 if none)
+            std::vector<Id> m_lkup_ent_snapshot_group;
+
+            // * <group id, entities> for BatchData whose group
+            //   isn't registered yet
+            std::unordered_map<Id,std::vector<Id>> m_lkup_group_pending_ents;
+
             // The thread pool must be destroyed before any resources
             // used by it or the task (like list_batch_geometry) so keep
             // it last (destruction happens in rev order so this will
@@ -14,6 +14,7 @@
    limitations under the License.
 */
 
+#include <algorithm>
 #include <ks/draw/KsDrawComponents.hpp>
 
 namespace ks
@@ -23,20 +24,139 @@ namespace ks
         // ============================================================= //
         // ============================================================= //
 
+        SizeClasses::SizeClasses(std::vector<uint> list_class_sizes,
+                                 uint max_size_bytes)
+        {
+            for(auto class_size : list_class_sizes) {
+                if(class_size == 0 || class_size > max_size_bytes) {
+                    continue;
+                }
+
+                // Round up to a multiple of 4
+                class_size = ((class_size+3)/4)*4;
+                if(class_size <= max_size_bytes) {
+                    m_list_class_sizes.push_back(class_size);
+                }
+            }
+
+            std::sort(m_list_class_sizes.begin(),
+                      m_list_class_sizes.end());
+
+            m_list_class_sizes.erase(
+                        std::unique(m_list_class_sizes.begin(),
+                                    m_list_class_sizes.end()),
+                        m_list_class_sizes.end());
+        }
+
+        uint SizeClasses::GetCount() const
+        {
+            return m_list_class_sizes.size();
+        }
+
+        uint SizeClasses::GetClassSizeBytes(uint class_idx) const
+        {
+            return m_list_class_sizes[class_idx];
+        }
+
+        uint SizeClasses::GetClass(uint size_bytes) const
+        {
+            auto it = std::lower_bound(m_list_class_sizes.begin(),
+                                       m_list_class_sizes.end(),
+                                       size_bytes);
+
+            return std::distance(m_list_class_sizes.begin(),it);
+        }
+
+        uint SizeClasses::GetAllocSizeBytes(uint size_bytes) const
+        {
+            uint const class_idx = GetClass(size_bytes);
+            return (class_idx < m_list_class_sizes.size()) ?
+                        m_list_class_sizes[class_idx] : size_bytes;
+        }
+
+        uint SizeClasses::GetSlabSizeBytes(uint class_idx,
+                                           uint max_block_size_bytes) const
+        {
+            u64 const slab_size_bytes =
+                    u64(m_list_class_sizes[class_idx])*k_slab_range_count;
+
+            return std::min<u64>(slab_size_bytes,max_block_size_bytes);
+        }
+
+        std::vector<uint> SizeClasses::GenPow2Classes(uint min_size_bytes,
+                                                      uint max_size_bytes)
+        {
+            std::vector<uint> list_class_sizes;
+            for(u64 class_size = std::max(min_size_bytes,1u);
+                class_size <= max_size_bytes; class_size *= 2)
+            {
+                list_class_sizes.push_back(class_size);
+            }
+
+            return list_class_sizes;
+        }
+
+        // ============================================================= //
+        // ============================================================= //
+
         BufferLayout::BufferLayout(
                 gl::Buffer::Usage usage,
                 std::vector<gl::VertexLayout> list_vx_layout,
                 std::vector<shared_ptr<VertexBufferAllocator>> list_vx_allocators,
-                shared_ptr<IndexBufferAllocator> ix_allocator) :
+                shared_ptr<IndexBufferAllocator> ix_allocator,
+                IndexType ix_type,
+                std::vector<uint> list_vx_divisors,
+                std::vector<uint> list_size_classes) :
             m_usage(usage),
             m_list_vx_layout(list_vx_layout),
             m_list_vx_allocators(list_vx_allocators),
             m_ix_allocator(ix_allocator),
             m_is_indexed(ix_allocator!=nullptr),
+            m_ix_type(ix_type),
             m_vx_buffer_count(list_vx_layout.size()),
-            m_list_vx_size_bytes(genListVertexLayoutSizes(m_list_vx_layout))
+            m_list_vx_size_bytes(genListVertexLayoutSizes(m_list_vx_layout)),
+            m_list_vx_divisors(list_vx_divisors),
+            m_is_instanced(false)
         {
+            m_list_vx_divisors.resize(m_vx_buffer_count,0);
+
+            for(auto const divisor : m_list_vx_divisors) {
+                m_is_instanced = m_is_instanced || (divisor > 0);
+            }
 
+            if(list_size_classes.empty()) {
+                return;
+            }
+
+            // Every class has to fit in a block of each allocator
+            uint max_size_bytes = std::numeric_limits<uint>::max();
+            for(auto const &vx_allocator : m_list_vx_allocators) {
+                max_size_bytes = std::min(max_size_bytes,vx_allocator->GetBlockSize());
+            }
+            if(m_ix_allocator) {
+                max_size_bytes = std::min(max_size_bytes,m_ix_allocator->GetBlockSize());
+            }
+
+            m_size_classes = SizeClasses(list_size_classes,max_size_bytes);
+
+            m_list_vx_class_allocators.resize(m_vx_buffer_count);
+            for(uint i=0; i < m_vx_buffer_count; i++) {
+                for(uint j=0; j < m_size_classes.GetCount(); j++) {
+                    m_list_vx_class_allocators[i].push_back(
+                                make_shared<VertexBufferAllocator>(
+                                    m_size_classes.GetSlabSizeBytes(
+                                        j,m_list_vx_allocators[i]->GetBlockSize())));
+                }
+            }
+
+            if(m_ix_allocator) {
+                for(uint j=0; j < m_size_classes.GetCount(); j++) {
+                    m_list_ix_class_allocators.push_back(
+                                make_shared<IndexBufferAllocator>(
+                                    m_size_classes.GetSlabSizeBytes(
+                                        j,m_ix_allocator->GetBlockSize())));
+                }
+            }
         }
 
         BufferLayout::~BufferLayout()
@@ -67,11 +187,44 @@ namespace ks
             return m_ix_allocator;
         }
 
+        shared_ptr<VertexBufferAllocator> const &
+        BufferLayout::GetVertexBufferAllocator(uint index, uint size_bytes) const
+        {
+            uint const class_idx = m_size_classes.GetClass(size_bytes);
+            return (class_idx < m_size_classes.GetCount()) ?
+                        m_list_vx_class_allocators[index][class_idx] :
+                        m_list_vx_allocators[index];
+        }
+
+        shared_ptr<IndexBufferAllocator> const &
+        BufferLayout::GetIndexBufferAllocator(uint size_bytes) const
+        {
+            uint const class_idx = m_size_classes.GetClass(size_bytes);
+            return (class_idx < m_size_classes.GetCount()) ?
+                        m_list_ix_class_allocators[class_idx] :
+                        m_ix_allocator;
+        }
+
+        SizeClasses const & BufferLayout::GetSizeClasses() const
+        {
+            return m_size_classes;
+        }
+
         bool BufferLayout::GetIsIndexed() const
         {
             return m_is_indexed;
         }
 
+        IndexType BufferLayout::GetIndexType() const
+        {
+            return m_ix_type;
+        }
+
+        uint BufferLayout::GetIndexSizeBytes() const
+        {
+            return (m_ix_type == IndexType::UInt32) ? 4 : 2;
+        }
+
         uint BufferLayout::GetVertexBufferCount() const
         {
             return m_vx_buffer_count;
@@ -82,6 +235,16 @@ namespace ks
             return m_list_vx_size_bytes[index];
         }
 
+        uint BufferLayout::GetVertexBufferDivisor(uint index) const
+        {
+            return m_list_vx_divisors[index];
+        }
+
+        bool BufferLayout::GetIsInstanced() const
+        {
+            return m_is_instanced;
+        }
+
         std::vector<uint> BufferLayout::genListVertexLayoutSizes(
                 std::vector<gl::VertexLayout> const &list_vx_layout)
         {
@@ -115,6 +278,18 @@ namespace ks
             return m_upd_ix;
         }
 
+        std::vector<Geometry::ListUpdateRanges> const &
+        Geometry::GetUpdatedVertexBufferRanges() const
+        {
+            return m_list_upd_vx_ranges;
+        }
+
+        Geometry::ListUpdateRanges const &
+        Geometry::GetUpdatedIndexBufferRanges() const
+        {
+            return m_list_upd_ix_ranges;
+        }
+
         std::vector<UPtrBuffer> const & Geometry::GetVertexBuffers() const
         {
             return m_list_vx_buffs;
@@ -158,12 +333,14 @@ namespace ks
 
         void Geometry::SetVertexBufferUpdated(uint index)
         {
-            for(auto const idx : m_list_upd_vx) {
-                if(idx == index) {
+            for(uint i=0; i < m_list_upd_vx.size(); i++) {
+                if(m_list_upd_vx[i] == index) {
+                    m_list_upd_vx_ranges[i].clear();
                     return;
                 }
             }
             m_list_upd_vx.push_back(index);
+            m_list_upd_vx_ranges.emplace_back();
             m_upd_geometry = true;
         }
 
@@ -172,18 +349,55 @@ namespace ks
             if(m_ix_buff) {
                 m_upd_ix = true;
                 m_upd_geometry = true;
+                m_list_upd_ix_ranges.clear();
+            }
+        }
+
+        void Geometry::SetVertexBufferRangeUpdated(uint index,
+                                                   uint start_byte,
+                                                   uint size_bytes)
+        {
+            for(uint i=0; i < m_list_upd_vx.size(); i++) {
+                if(m_list_upd_vx[i] == index) {
+                    if(!m_list_upd_vx_ranges[i].empty()) {
+                        m_list_upd_vx_ranges[i].emplace_back(start_byte,size_bytes);
+                    }
+                    return;
+                }
             }
+            m_list_upd_vx.push_back(index);
+            m_list_upd_vx_ranges.push_back(
+                        ListUpdateRanges{{start_byte,size_bytes}});
+            m_upd_geometry = true;
+        }
+
+        void Geometry::SetIndexBufferRangeUpdated(uint start_byte,
+                                                  uint size_bytes)
+        {
+            if(!m_ix_buff) {
+                return;
+            }
+
+            if(m_upd_ix && m_list_upd_ix_ranges.empty()) {
+                return;
+            }
+            m_list_upd_ix_ranges.emplace_back(start_byte,size_bytes);
+            m_upd_ix = true;
+            m_upd_geometry = true;
         }
 
         void Geometry::SetAllUpdated()
         {
             m_list_upd_vx.clear();
+            m_list_upd_vx_ranges.clear();
             for(uint i=0; i < m_list_vx_buffs.size(); i++) {
                 m_list_upd_vx.push_back(i);
+                m_list_upd_vx_ranges.emplace_back();
             }
 
             if(m_ix_buff) {
                 m_upd_ix = true;
+                m_list_upd_ix_ranges.clear();
             }
             m_upd_geometry = true;
         }
@@ -193,6 +407,36 @@ namespace ks
             m_upd_geometry = false;
             m_upd_ix = false;
             m_list_upd_vx.clear();
+            m_list_upd_vx_ranges.clear();
+            m_list_upd_ix_ranges.clear();
+        }
+
+        // ============================================================= //
+        // ============================================================= //
+
+        void EntityChangeList::Add(Id ent_id)
+        {
+            if(m_lkup_ent_added.size() <= ent_id) {
+                m_lkup_ent_added.resize(ent_id+1,0);
+            }
+
+            if(m_lkup_ent_added[ent_id] == 0) {
+                m_lkup_ent_added[ent_id] = 1;
+                m_list_ent_ids.push_back(ent_id);
+            }
+        }
+
+        std::vector<Id>& EntityChangeList::GetList()
+        {
+            return m_list_ent_ids;
+        }
+
+        void EntityChangeList::Clear()
+        {
+            for(auto const ent_id : m_list_ent_ids) {
+                m_lkup_ent_added[ent_id] = 0;
+            }
+            m_list_ent_ids.clear();
         }
 
         // ============================================================= //
@@ -225,11 +469,28 @@ namespace ks
         void BatchData::SetGroupId(Id group_id)
         {
             m_group_id = group_id;
+            notifyChanged();
         }
 
         void BatchData::SetRebuild(bool rebuild)
         {
             m_rebuild = rebuild;
+            if(m_rebuild) {
+                notifyChanged();
+            }
+        }
+
+        void BatchData::SetChangeList(Id ent_id, EntityChangeList* change_list)
+        {
+            m_ent_id = ent_id;
+            m_change_list = change_list;
+        }
+
+        void BatchData::notifyChanged()
+        {
+            if(m_change_list) {
+                m_change_list->Add(m_ent_id);
+            }
         }
 
         // ============================================================= //
@@ -17,6 +17,8 @@
 #ifndef KS_DRAW_COMPONENTS_HPP
 #define KS_DRAW_COMPONENTS_HPP
 
+#include <limits>
+
 #include <ks/shared/KsRangeAllocator.hpp>
 #include <ks/shared/KsThreadPool.hpp>
 #include <ks/shared/KsRecycleIndexList.hpp>
@@ -61,22 +63,114 @@ namespace ks
             Transparent
         };
 
+        // * SingleFrame: merged in full during the Update that
+        //   the batch group changed in
+        // * TimeSliced: merged on the update thread across as many
+        //   Updates as the BatchSystem's time sliced budget needs
+        // * MultiFrame: merged by worker threads and applied in a
+        //   later Update
+        // TimeSliced and MultiFrame batch groups keep drawing their
+        //   last complete merge until a new one is finished
         enum class UpdatePriority : u8
         {
             SingleFrame,
+            TimeSliced,
             MultiFrame
         };
 
+        // * Rebuild: every merged geometry in a batch group is
+        //   rebuilt when any of its single geometries change
+        // * Incremental: single geometries keep their assigned
+        //   merged geometry (chunk) and only the chunks that
+        //   had geometry added, removed or updated are rebuilt
+        //   (pre merge callbacks aren't used in this mode since
+        //   the chunk assignment decides the merge order)
+        enum class MergeMode : u8
+        {
+            Rebuild,
+            Incremental
+        };
+
+        // * Sequential: single geometries are merged in order and a
+        //   new merged geometry is started when the next one doesn't fit
+        // * FirstFitDecreasing: single geometries are sorted by size and
+        //   each is placed in the first merged geometry with space for it
+        // * BestFitDecreasing: as FirstFitDecreasing but each is placed
+        //   in the merged geometry it leaves the least space in
+        // The decreasing policies usually need fewer merged geometries
+        // (and draw calls) but don't keep the draw order of single
+        // geometries across merged geometries. MergeMode::Incremental
+        // places geometry as it's added; BestFitDecreasing picks the
+        // tightest chunk there and the other policies the first one
+        enum class PackingPolicy : u8
+        {
+            Sequential,
+            FirstFitDecreasing,
+            BestFitDecreasing
+        };
+
+        // * UInt32 indices need GL_OES_element_index_uint on
+        //   OpenGL ES 2
+        enum class IndexType : u8
+        {
+            UInt16,
+            UInt32
+        };
+
         // ============================================================= //
         // ============================================================= //
 
+        // * Size classes for slab allocation; each size is
+        //   rounded up to the smallest class that fits it so
+        //   every range of a class has the same size and freed
+        //   ranges can be reused by any range of that class
+        // * Sizes larger than the largest class aren't rounded
+        class SizeClasses final
+        {
+        public:
+            static const uint k_slab_range_count = 256;
+
+            // * Class sizes are sorted and rounded up to a multiple
+            //   of 4 bytes so ranges stay aligned; classes larger
+            //   than @max_size_bytes are dropped
+            SizeClasses(std::vector<uint> list_class_sizes={},
+                        uint max_size_bytes=std::numeric_limits<uint>::max());
+
+            uint GetCount() const;
+
+            uint GetClassSizeBytes(uint class_idx) const;
+
+            // * Returns GetCount() if @size_bytes doesn't fit any class
+            uint GetClass(uint size_bytes) const;
+
+            // * The number of bytes to allocate for @size_bytes
+            uint GetAllocSizeBytes(uint size_bytes) const;
+
+            // * The block size for the allocators of a class; blocks
+            //   hold k_slab_range_count ranges of the class but are
+            //   no larger than @max_block_size_bytes
+            uint GetSlabSizeBytes(uint class_idx,
+                                  uint max_block_size_bytes) const;
+
+            // * Classes that double in size from @min_size_bytes
+            //   up to @max_size_bytes
+            static std::vector<uint> GenPow2Classes(uint min_size_bytes,
+                                                    uint max_size_bytes);
+
+        private:
+            std::vector<uint> m_list_class_sizes;
+        };
+
         class BufferLayout final
         {
         public:
             BufferLayout(gl::Buffer::Usage usage,
                          std::vector<gl::VertexLayout> list_vx_layout,
                          std::vector<shared_ptr<VertexBufferAllocator>> list_vx_allocators,
-                         shared_ptr<IndexBufferAllocator> ix_allocator=nullptr);
+                         shared_ptr<IndexBufferAllocator> ix_allocator=nullptr,
+                         IndexType ix_type=IndexType::UInt16,
+                         std::vector<uint> list_vx_divisors={},
+                         std::vector<uint> list_size_classes={});
 
             ~BufferLayout();
 
@@ -91,12 +185,32 @@ namespace ks
             shared_ptr<IndexBufferAllocator> const &
             GetIndexBufferAllocator() const;
 
+            // * The allocator for ranges of @size_bytes, which
+            //   depends on the size class if any are set
+            shared_ptr<VertexBufferAllocator> const &
+            GetVertexBufferAllocator(uint index, uint size_bytes) const;
+
+            shared_ptr<IndexBufferAllocator> const &
+            GetIndexBufferAllocator(uint size_bytes) const;
+
+            SizeClasses const & GetSizeClasses() const;
+
             bool GetIsIndexed() const;
 
+            IndexType GetIndexType() const;
+
+            uint GetIndexSizeBytes() const;
+
             uint GetVertexBufferCount() const;
 
             uint GetVertexSizeBytes(uint index) const;
 
+            // * The number of instances each vertex of a VertexBuffer
+            //   is used for; 0 means per vertex (not instanced)
+            uint GetVertexBufferDivisor(uint index) const;
+
+            bool GetIsInstanced() const;
+
             static std::vector<uint> genListVertexLayoutSizes(
                     std::vector<gl::VertexLayout> const &list_vx_layout);
 
@@ -106,9 +220,18 @@ namespace ks
             std::vector<shared_ptr<VertexBufferAllocator>> m_list_vx_allocators;
             shared_ptr<IndexBufferAllocator> m_ix_allocator;
 
+            // * Allocators for each size class; blocks are slabs
+            //   sized by SizeClasses::GetSlabSizeBytes
+            SizeClasses m_size_classes;
+            std::vector<std::vector<shared_ptr<VertexBufferAllocator>>> m_list_vx_class_allocators;
+            std::vector<shared_ptr<IndexBufferAllocator>> m_list_ix_class_allocators;
+
             bool m_is_indexed;
+            IndexType m_ix_type;
             uint m_vx_buffer_count;
             std::vector<uint> m_list_vx_size_bytes;
+            std::vector<uint> m_list_vx_divisors;
+            bool m_is_instanced;
         };
 
         // ============================================================= //
@@ -123,9 +246,19 @@ namespace ks
             Geometry(Geometry&&) = default;
             Geometry& operator = (Geometry&&) = default;
 
+            // <start byte, size bytes>
+            using ListUpdateRanges = std::vector<std::pair<uint,uint>>;
+
             bool GetUpdatedGeometry() const;
             std::vector<u8> const & GetUpdatedVertexBuffers() const;
             bool GetUpdatedIndexBuffer() const;
+
+            // * The updated byte ranges for each buffer in
+            //   GetUpdatedVertexBuffers (in the same order). An
+            //   empty list means the whole buffer was updated
+            std::vector<ListUpdateRanges> const & GetUpdatedVertexBufferRanges() const;
+            ListUpdateRanges const & GetUpdatedIndexBufferRanges() const;
+
             std::vector<UPtrBuffer> const & GetVertexBuffers() const;
             UPtrBuffer const & GetVertexBuffer(uint index) const;
             UPtrBuffer const & GetIndexBuffer() const;
@@ -137,6 +270,12 @@ namespace ks
             void SetRetainGeometry(bool retain);
             void SetVertexBufferUpdated(uint index);
             void SetIndexBufferUpdated();
+
+            // * Only the given range of the buffer was updated. Has
+            //   no effect if the whole buffer is already updated
+            void SetVertexBufferRangeUpdated(uint index, uint start_byte, uint size_bytes);
+            void SetIndexBufferRangeUpdated(uint start_byte, uint size_bytes);
+
             void SetAllUpdated();
             void ClearGeometryUpdates(); // rn ClearUpdates
 
@@ -145,6 +284,8 @@ namespace ks
             bool m_upd_geometry{false};
             bool m_upd_ix{false};
             std::vector<u8> m_list_upd_vx;
+            std::vector<ListUpdateRanges> m_list_upd_vx_ranges;
+            ListUpdateRanges m_list_upd_ix_ranges;
 
             std::vector<UPtrBuffer> m_list_vx_buffs;
             UPtrBuffer m_ix_buff;
@@ -176,13 +317,19 @@ namespace ks
                   shared_ptr<ListUniformUPtrs> list_uniforms,
                   std::vector<u8> list_draw_stages,
                   Transparency transparency,
-                  UpdatePriority priority) :
+                  UpdatePriority priority,
+                  MergeMode merge_mode=MergeMode::Rebuild,
+                  PackingPolicy packing_policy=PackingPolicy::Sequential,
+                  gl::Primitive primitive=gl::Primitive::Triangles) :
                 m_key(key),
                 m_buffer_layout(buffer_layout),
                 m_list_uniforms(list_uniforms),
                 m_list_draw_stages(list_draw_stages),
                 m_transparency(transparency),
                 m_priority(priority),
+                m_merge_mode(merge_mode),
+                m_packing_policy(packing_policy),
+                m_primitive(primitive),
                 m_upd(true)
             {}
 
@@ -218,6 +365,26 @@ namespace ks
                 return m_priority;
             }
 
+            MergeMode GetMergeMode() const
+            {
+                return m_merge_mode;
+            }
+
+            PackingPolicy GetPackingPolicy() const
+            {
+                return m_packing_policy;
+            }
+
+            // * The primitive of the single geometries in the batch
+            //   group. Strips are stitched together with degenerate
+            //   triangles, fans become triangle lists and line strips
+            //   and loops become line lists. The key should use the
+            //   merged primitive (see detail::GetMergedPrimitive)
+            gl::Primitive GetPrimitive() const
+            {
+                return m_primitive;
+            }
+
             void SetKey(DrawKeyType key)
             {
                 m_key = key;
@@ -248,6 +415,104 @@ namespace ks
             std::vector<u8> m_list_draw_stages;
             Transparency m_transparency;
             UpdatePriority m_priority;
+            MergeMode m_merge_mode;
+            PackingPolicy m_packing_policy;
+            gl::Primitive m_primitive;
+
+            bool m_upd;
+        };
+
+        // ============================================================= //
+        // ============================================================= //
+
+        // * Draws one base geometry once for every instance record
+        //   in the batch group with hardware instancing
+        // * The last VertexBuffer in the BufferLayout holds the
+        //   instance records and must have a divisor of 1. The
+        //   other VertexBuffers and the IndexBuffer hold the base
+        //   geometry, which is set with GetBaseGeometry (and its
+        //   updated flags)
+        // * VertexBuffer 0 of each BatchData in the group holds
+        //   one or more instance records
+        template<typename DrawKeyType>
+        class InstancedBatch final
+        {
+        public:
+            InstancedBatch(DrawKeyType key,
+                           BufferLayout const * buffer_layout,
+                           shared_ptr<ListUniformUPtrs> list_uniforms,
+                           std::vector<u8> list_draw_stages,
+                           Transparency transparency) :
+                m_key(key),
+                m_buffer_layout(buffer_layout),
+                m_list_uniforms(list_uniforms),
+                m_list_draw_stages(list_draw_stages),
+                m_transparency(transparency),
+                m_upd(true)
+            {}
+
+            ~InstancedBatch() = default;
+
+            DrawKeyType GetKey() const
+            {
+                return m_key;
+            }
+
+            BufferLayout const * GetBufferLayout() const
+            {
+                return m_buffer_layout;
+            }
+
+            shared_ptr<ListUniformUPtrs>& GetUniformList()
+            {
+                return m_list_uniforms;
+            }
+
+            std::vector<u8> const & GetDrawStages() const
+            {
+                return m_list_draw_stages;
+            }
+
+            Transparency GetTransparency() const
+            {
+                return m_transparency;
+            }
+
+            Geometry& GetBaseGeometry()
+            {
+                return m_base_geometry;
+            }
+
+            void SetKey(DrawKeyType key)
+            {
+                m_key = key;
+                m_upd = true;
+            }
+
+            void SetDrawStages(std::vector<u8> list_draw_stages)
+            {
+                m_list_draw_stages = list_draw_stages;
+                m_upd = true;
+            }
+
+            void SetTransparency(Transparency transparency)
+            {
+                m_transparency = transparency;
+                m_upd = true;
+            }
+
+            void ClearUpdated()
+            {
+                m_upd = false;
+            }
+
+        private:
+            DrawKeyType m_key;
+            BufferLayout const * m_buffer_layout;
+            shared_ptr<ListUniformUPtrs> m_list_uniforms;
+            std::vector<u8> m_list_draw_stages;
+            Transparency m_transparency;
+            Geometry m_base_geometry;
 
             bool m_upd;
         };
@@ -326,6 +591,11 @@ namespace ks
                 return m_enabled;
             }
 
+            u8 GetUploadPriority() const
+            {
+                return m_upload_priority;
+            }
+
             void SetKey(DrawKeyType key)
             {
                 m_key = key;
@@ -346,6 +616,14 @@ namespace ks
                 m_enabled = enabled;
             }
 
+            // * Geometry with a higher priority is uploaded first
+            //   when uploads are limited (see
+            //   DrawCallUpdater::SetUploadBudget)
+            void SetUploadPriority(u8 priority)
+            {
+                m_upload_priority = priority;
+            }
+
         private:
             Id m_uid;
             DrawKeyType m_key;
@@ -356,6 +634,7 @@ namespace ks
 
             // update/behaviour flags
             bool m_enabled{false};
+            u8 m_upload_priority{0};
 
             // geometry
             Geometry m_geometry;
@@ -384,6 +663,23 @@ namespace ks
         // ============================================================= //
         // ============================================================= //
 
+        // * Records the ids of changed entities (each once until
+        //   the list is cleared) so systems only have to look at
+        //   those entities. Used for BatchData that was created,
+        //   removed, moved to another batch group or marked for
+        //   rebuild and for RenderData that was created or removed
+        class EntityChangeList final
+        {
+        public:
+            void Add(Id ent_id);
+            std::vector<Id>& GetList();
+            void Clear();
+
+        private:
+            std::vector<Id> m_list_ent_ids;
+            std::vector<u8> m_lkup_ent_added;
+        };
+
         class BatchData final
         {
         public:
@@ -401,10 +697,18 @@ namespace ks
             void SetGroupId(Id group_id);
             void SetRebuild(bool rebuild);
 
+            // Set by the BatchSystem when the BatchData is created
+            void SetChangeList(Id ent_id, EntityChangeList* change_list);
+
         private:
+            void notifyChanged();
+
             Id m_group_id{0};
             Geometry m_geometry;
-            bool m_rebuild;
+            bool m_rebuild{false};
+
+            Id m_ent_id{0};
+            EntityChangeList* m_change_list{nullptr};
         };
 
         // ============================================================= //
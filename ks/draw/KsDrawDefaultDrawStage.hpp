@@ -17,6 +17,7 @@
 #ifndef KS_DRAW_DEFAULT_DRAW_STAGE_HPP
 #define KS_DRAW_DEFAULT_DRAW_STAGE_HPP
 
+#include <map>
 #include <ks/draw/KsDrawDrawStage.hpp>
 #include <ks/draw/KsDrawRenderSystem.hpp>
 
@@ -41,6 +42,9 @@ namespace ks
                 // reset stats
                 this->m_stats.reset();
 
+                // Shaders may have been recreated since the last Render
+                m_lkup_attr_locs.clear();
+
                 auto& list_draw_calls = p.list_draw_calls;
                 auto& list_opq_draw_calls = *(p.list_opq_draw_calls);
                 auto& list_xpr_draw_calls = *(p.list_xpr_draw_calls);
@@ -124,6 +128,10 @@ namespace ks
 
                 auto primitive = draw_call.key.GetPrimitive();
 
+                bool const instanced =
+                        draw_call.buffer_layout &&
+                        draw_call.buffer_layout->GetIsInstanced();
+
                 if(draw_call.draw_ix.buffer) {
                     // bind vertex buffers
                     bool ok = true;
@@ -137,10 +145,25 @@ namespace ks
 
                     assert(ok);
 
-                    ks::gl::DrawElements(
-                                primitive,
-                                draw_call.draw_ix.start_byte,
-                                draw_call.draw_ix.size_bytes);
+                    if(instanced) {
+                        setVertexAttribDivisors(shader,draw_call,true);
+
+                        detail::DrawElementsInstanced(
+                                    primitive,
+                                    draw_call.ix_type,
+                                    draw_call.draw_ix.start_byte,
+                                    draw_call.draw_ix.size_bytes,
+                                    draw_call.instance_count);
+
+                        setVertexAttribDivisors(shader,draw_call,false);
+                    }
+                    else {
+                        detail::DrawElements(
+                                    primitive,
+                                    draw_call.ix_type,
+                                    draw_call.draw_ix.start_byte,
+                                    draw_call.draw_ix.size_bytes);
+                    }
 
                     for(auto& range : draw_call.list_draw_vx) {
                         range.buffer->GLUnbind();
@@ -155,12 +178,40 @@ namespace ks
                                     shader,range.start_byte);
                     }
 
-                    auto& first_range = draw_call.list_draw_vx[0];
+                    if(instanced) {
+                        // The vertex count comes from the first
+                        // range that isn't per instance
+                        uint base_idx = 0;
+                        while(base_idx < draw_call.list_draw_vx.size() &&
+                              draw_call.buffer_layout->
+                                GetVertexBufferDivisor(base_idx) > 0) {
+                            base_idx++;
+                        }
+
+                        // Layouts with only per instance ranges
+                        // have no vertices to draw
+                        if(base_idx < draw_call.list_draw_vx.size()) {
+                            auto& base_range = draw_call.list_draw_vx[base_idx];
+
+                            setVertexAttribDivisors(shader,draw_call,true);
 
-                    ks::gl::DrawArrays(
-                                primitive,
-                                first_range.buffer->GetVertexSizeBytes(),
-                                0,first_range.size_bytes);
+                            detail::DrawArraysInstanced(
+                                        primitive,
+                                        base_range.buffer->GetVertexSizeBytes(),
+                                        base_range.size_bytes,
+                                        draw_call.instance_count);
+
+                            setVertexAttribDivisors(shader,draw_call,false);
+                        }
+                    }
+                    else {
+                        auto& first_range = draw_call.list_draw_vx[0];
+
+                        ks::gl::DrawArrays(
+                                    primitive,
+                                    first_range.buffer->GetVertexSizeBytes(),
+                                    0,first_range.size_bytes);
+                    }
 
                     for(auto& range : draw_call.list_draw_vx) {
                         range.buffer->GLUnbind();
@@ -170,6 +221,49 @@ namespace ks
                 this->m_stats.draw_calls++;
             }
 
+            // * Per instance attributes are reset to a divisor of 0
+            //   after drawing so they don't affect other draw calls
+            //   that use the same attribute locations
+            void setVertexAttribDivisors(gl::ShaderProgram* shader,
+                                         DrawCall<DrawKeyType> const &draw_call,
+                                         bool enable)
+            {
+                auto const buffer_layout = draw_call.buffer_layout;
+
+                for(uint i=0; i < draw_call.list_draw_vx.size(); i++)
+                {
+                    auto const divisor =
+                            buffer_layout->GetVertexBufferDivisor(i);
+
+                    if(divisor > 0) {
+                        detail::SetVertexAttribDivisor(
+                                    getAttributeLocations(
+                                        shader,
+                                        buffer_layout->GetVertexLayout(i)),
+                                    enable ? divisor : 0);
+                    }
+                }
+            }
+
+            // * Attribute locations are looked up once per shader
+            //   and vertex layout in each Render
+            std::vector<sint> const &
+            getAttributeLocations(gl::ShaderProgram* shader,
+                                  gl::VertexLayout const &vx_layout)
+            {
+                auto const key = std::make_pair(shader,&vx_layout);
+
+                auto it = m_lkup_attr_locs.find(key);
+                if(it == m_lkup_attr_locs.end()) {
+                    it = m_lkup_attr_locs.emplace(
+                                key,
+                                detail::GetAttributeLocations(
+                                    shader,vx_layout)).first;
+                }
+
+                return it->second;
+            }
+
         private:
             void setupState(DrawParams<DrawKeyType>& p,
                             DrawKeyType& prev_key,
@@ -236,6 +330,12 @@ namespace ks
                     prev_key = curr_key;
                 }
             }
+
+            // <shader, vertex layout>, attribute locations
+            std::map<
+                std::pair<gl::ShaderProgram const *,gl::VertexLayout const *>,
+                std::vector<sint>
+            > m_lkup_attr_locs;
         };
     }
 }
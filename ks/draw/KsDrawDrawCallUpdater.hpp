@@ -17,7 +17,12 @@
 #ifndef KS_DRAW_DRAW_CALL_UPDATER_HPP
 #define KS_DRAW_DRAW_CALL_UPDATER_HPP
 
-#include <set>
+#include <algorithm>
+#include <cstring>
+#include <limits>
+#include <map>
+#include <numeric>
+#include <unordered_map>
 #include <ks/draw/KsDrawComponents.hpp>
 #include <ks/draw/KsDrawDrawStage.hpp>
 
@@ -59,93 +64,125 @@ namespace ks
                 bool vx_ranges_valid{false};
                 bool ix_range_valid{false};
 
+                // Set while the ranges were released to stay under
+                // the memory budget (see SetMemoryBudget)
+                bool evicted{false};
+
                 std::vector<VertexBufferAllocator::Range> list_vx_ranges;
                 IndexBufferAllocator::Range ix_range;
 
+                // The dense index of the buffer each range is in
+                // (see markBufferToSync)
+                std::vector<uint> list_vx_buffer_idx;
+                uint ix_buffer_idx{0};
+
+                // The size of the data in each range; ranges are
+                // larger than their data when rounded up to a
+                // size class
+                std::vector<uint> list_vx_sizes;
+                uint ix_size{0};
+
                 BufferLayout const * buffer_layout{nullptr};
             };
 
-            void Update(std::vector<PairIds> const &list_ent_rd_curr,
-                        std::vector<RenderData>& list_render_data)
+            // * Per Update counts of the uploads queued for each
+            //   buffer (one per range) and the uploads actually
+            //   issued after adjacent ranges were merged
+            struct UploadStats
             {
-                m_list_ent_rd_prev = m_list_ent_rd_curr;
-                m_list_ent_rd_curr = list_ent_rd_curr;
-
-                m_list_ents_rem.clear();
-                m_list_ents_add.clear();
-                m_list_ents_upd.clear();
-
-                m_list_buffers_to_init.clear();
-                m_list_buffers_to_sync.clear();
-                m_list_new_buffers.clear();
+                uint upload_count{0};
+                uint merged_upload_count{0};
+                u64 upload_bytes{0};
+                u64 gap_bytes{0};
 
-                // We need to resize the RenderGeometry list if
-                // its smaller than the entity count
-                m_entity_count = list_render_data.size();
-                if(m_list_geometry_ranges.size() < m_entity_count) {
-                    m_list_geometry_ranges.resize(m_entity_count);
-                }
+                // Updated ranges whose data still fit in place
+                uint in_place_count{0};
 
-                // Create lists for added and removed Entities by
-                // diffing against unique RenderData ids
-                createDiffs(m_list_ents_rem,m_list_ents_add);
+                // Bytes of merged runs copied to the staging arena
+                u64 staging_bytes{0};
 
-                // Process removed RenderData/Geometry
-                for(auto const ent_id : m_list_ents_rem)
-                {
-                    auto& geometry_ranges = m_list_geometry_ranges[ent_id];
-                    removeGeometryRanges(geometry_ranges);
-                }
+                // Updated geometry left for a later Update because
+                // it didn't fit in the upload budget
+                uint deferred_count{0};
+                u64 deferred_bytes{0};
+            };
 
-                // Process added RenderData/Geometry
-                for(auto const ent_id : m_list_ents_add)
-                {
-                    auto& render_data = list_render_data[ent_id];
-                    auto& geometry = render_data.GetGeometry();
-                    auto& geometry_ranges = m_list_geometry_ranges[ent_id];
+            // * Per Update counts of the ranges moved by compaction
+            //   and the buffers it freed
+            struct CompactStats
+            {
+                uint moved_range_count{0};
+                u64 moved_bytes{0};
+                uint freed_buffer_count{0};
+            };
 
-                    auto const vx_buff_count =
-                            render_data.GetBufferLayout()->
-                                GetVertexBufferCount();
+            // * Per Update counts of empty buffers that are being
+            //   kept and of the empty buffers that were freed
+            struct ReclaimStats
+            {
+                uint empty_buffer_count{0};
+                uint freed_buffer_count{0};
+            };
 
-                    geometry_ranges.buffer_layout = render_data.GetBufferLayout();
-                    geometry_ranges.list_vx_ranges.resize(vx_buff_count);
-                    geometry_ranges.valid = true;
+            // * Per Update counts of the geometry evicted to stay
+            //   under the memory budget and of the geometry that was
+            //   restored because it was drawn again
+            struct BudgetStats
+            {
+                uint evicted_count{0};
+                u64 evicted_bytes{0};
+                uint restored_count{0};
+                u64 restored_bytes{0};
+                uint freed_buffer_count{0};
+
+                // Size of all buffers at the end of the Update
+                u64 buffer_bytes{0};
+            };
 
-                    // Ensure this is uploaded in the case where RenderData
-                    // has been removed/added but GeometryData is the same
-                    // TODO Shoudl this be removed?
-                    for(uint i=0; i < vx_buff_count; i++) {
-                        geometry.SetVertexBufferUpdated(i);
-                    }
+            // * Updates from the full list of <Entity Id, RenderData Id>
+            //   for every Entity that currently has RenderData
+            void Update(std::vector<PairIds> const &list_ent_rd_curr,
+                        std::vector<RenderData>& list_render_data)
+            {
+                beginUpdate(list_render_data);
 
-                    if(geometry_ranges.buffer_layout->GetIsIndexed()) {
-                        geometry.SetIndexBufferUpdated();
-                    }
-                }
+                // Create lists for added and removed Entities by
+                // comparing against the RenderData ids from the
+                // last Update
+                createDiffs(list_ent_rd_curr,
+                            m_list_ents_rem,
+                            m_list_ents_add);
 
-                // Process all current RenderData/Geometry
-                for(auto const ent_rd : m_list_ent_rd_curr)
-                {
-                    auto& render_data = list_render_data[ent_rd.first];
-                    auto& geometry = render_data.GetGeometry();
+                processUpdate(list_render_data);
+            }
 
-                    if(geometry.GetUpdatedGeometry() &&
-                       checkUpdatedGeometry(geometry))
-                    {
-                        createGeometryRanges(
-                                    m_list_geometry_ranges[ent_rd.first],
-                                    geometry);
+            // * Updates from only the Entities whose RenderData was
+            //   created or removed since the last Update, so finding
+            //   added and removed RenderData costs O(changes) instead
+            //   of O(Entities)
+            // * An Entity may be listed more than once and listed
+            //   Entities that didn't change are ignored
+            void UpdateChanged(std::vector<Id> const &list_ents_changed,
+                               std::vector<RenderData>& list_render_data)
+            {
+                beginUpdate(list_render_data);
 
-                        geometry.ClearGeometryUpdates();
+                createDiffs(list_ents_changed,
+                            list_render_data,
+                            m_list_ents_rem,
+                            m_list_ents_add);
 
-                        m_list_ents_upd.push_back(ent_rd.first);
-                    }
-                }
+                processUpdate(list_render_data);
             }
 
+            // * Must be called after the buffers from GetBuffersToSync
+            //   have been synced since it recycles the staging arena
             void Sync(std::vector<DrawCall>& list_draw_calls)
             {
+                if(m_staging_arena) {
+                    m_staging_arena->clear();
+                }
+
                 // Resize draw_calls if necessary
                 if(list_draw_calls.size() < m_list_geometry_ranges.size()) {
                     list_draw_calls.resize(m_list_geometry_ranges.size());
@@ -157,6 +194,8 @@ namespace ks
                     auto& draw_call = list_draw_calls[ent_id];
                     draw_call.list_draw_vx.clear();
                     draw_call.draw_ix.buffer = nullptr;
+                    draw_call.buffer_layout = nullptr;
+                    draw_call.instance_count = 0;
                     draw_call.list_uniforms = nullptr;
                     draw_call.valid = false;
                 }
@@ -172,6 +211,9 @@ namespace ks
                                 (geometry.vx_ranges_valid);
 
                     if(!geometry_valid) {
+                        // Evicted geometry isn't drawn until its
+                        // ranges are restored
+                        list_draw_calls[ent_id].valid = false;
                         continue;
                     }
 
@@ -180,18 +222,35 @@ namespace ks
                     draw_call.list_draw_vx.resize(
                                 geometry.list_vx_ranges.size());
 
+                    draw_call.buffer_layout = geometry.buffer_layout;
+                    draw_call.instance_count = 0;
+
                     for(uint i=0; i < geometry.list_vx_ranges.size(); i++) {
                         auto& vx_alloc_range = geometry.list_vx_ranges[i];
                         auto& draw_range = draw_call.list_draw_vx[i];
                         draw_range.buffer = vx_alloc_range.block->data;
                         draw_range.start_byte = vx_alloc_range.start;
-                        draw_range.size_bytes = vx_alloc_range.size;
+                        draw_range.size_bytes = geometry.list_vx_sizes[i];
+
+                        auto const divisor =
+                                geometry.buffer_layout->GetVertexBufferDivisor(i);
+
+                        if(divisor > 0) {
+                            uint const vx_count =
+                                    geometry.list_vx_sizes[i]/
+                                    geometry.buffer_layout->GetVertexSizeBytes(i);
+
+                            draw_call.instance_count =
+                                    std::max(draw_call.instance_count,
+                                             vx_count*divisor);
+                        }
                     }
 
                     if(geometry.buffer_layout->GetIsIndexed()) {
                         draw_call.draw_ix.buffer = geometry.ix_range.block->data;
                         draw_call.draw_ix.start_byte = geometry.ix_range.start;
-                        draw_call.draw_ix.size_bytes = geometry.ix_range.size;
+                        draw_call.draw_ix.size_bytes = geometry.ix_size;
+                        draw_call.ix_type = geometry.buffer_layout->GetIndexType();
                     }
                     draw_call.valid = true;
                 }
@@ -203,20 +262,171 @@ namespace ks
                 m_list_ents_rem.clear();
                 m_list_ents_add.clear();
                 m_list_ents_upd.clear();
+                m_list_ent_updated.clear();
                 m_list_ent_rd_curr.clear();
-                m_list_ent_rd_prev.clear();
+                m_list_ent_rd_id.clear();
+                m_list_ent_curr_idx.clear();
+                m_list_ent_listed.clear();
                 m_list_geometry_ranges.clear();
                 m_list_buffers_to_init.clear();
-                m_list_buffers_to_sync.clear();
+                clearBuffersToSync();
                 m_list_new_buffers.clear();
+                m_list_removed_buffers.clear();
+                m_compact_buffer_idx = k_invalid_buffer_idx;
+                m_compact_stats = CompactStats();
+                m_reclaim_stats = ReclaimStats();
+                m_list_ent_drawn_update.clear();
+                m_budget_stats = BudgetStats();
+
+                for(auto& list_uploads : m_list_buffer_uploads) {
+                    list_uploads.clear();
+                }
+                m_list_upload_data.clear();
+                m_list_buffer_range_owners.clear();
+                m_upload_stats = UploadStats();
+                m_staging_arena.reset();
+            }
+
+            // * Queued uploads to the same buffer that are closer
+            //   than @gap_bytes are merged into a single upload.
+            //   Adjacent and overlapping ranges are always merged.
+            // * Bridging a gap means uploading the bytes in between
+            //   again, so a gap is only bridged if it is free space
+            //   or belongs to geometry that was retained
+            //   (Geometry::SetRetainGeometry) and has no updates
+            //   waiting to be uploaded
+            void SetUploadGapThreshold(uint gap_bytes)
+            {
+                bool const tracked_owners = getTrackRangeOwners();
+                m_upload_gap_threshold = gap_bytes;
+                updateTrackRangeOwners(tracked_owners);
+            }
+
+            uint GetUploadGapThreshold() const
+            {
+                return m_upload_gap_threshold;
+            }
+
+            // * Limits the geometry uploaded in each Update to about
+            //   @bytes_per_update. Updated geometry is uploaded in order
+            //   of RenderData::GetUploadPriority; once the budget is
+            //   used up the rest is left for later Updates. At least
+            //   one Entity's geometry is uploaded every Update
+            // * Deferred geometry keeps its last DrawCall; geometry
+            //   that was never uploaded isn't drawn until it is.
+            //   Its ranges aren't bridged by merged uploads or moved
+            //   by compaction until it's uploaded
+            // * Retained geometry moved by compaction isn't counted
+            // * A @bytes_per_update of 0 disables the budget
+            void SetUploadBudget(uint bytes_per_update)
+            {
+                m_upload_budget_bytes = bytes_per_update;
+            }
+
+            uint GetUploadBudget() const
+            {
+                return m_upload_budget_bytes;
+            }
+
+            // * Upload counts for the last Update
+            UploadStats const & GetUploadStats() const
+            {
+                return m_upload_stats;
+            }
+
+            // * Moves ranges out of sparsely used buffers over several
+            //   Updates so the emptied buffers can be freed:
+            // * A buffer is compacted if less than @max_fill_ratio of
+            //   it is used and its ranges fit in the other buffers of
+            //   the same allocator. At most @max_bytes_per_update are
+            //   moved each Update (but at least one range)
+            // * Only ranges of geometry that was retained can be moved
+            //   since the data has to be uploaded again
+            // * A @max_fill_ratio of 0 disables compaction
+            void SetCompaction(float max_fill_ratio,
+                               uint max_bytes_per_update)
+            {
+                bool const tracked_owners = getTrackRangeOwners();
+                m_compact_fill_ratio = max_fill_ratio;
+                m_compact_bytes_per_update = max_bytes_per_update;
+                m_compact_buffer_idx = k_invalid_buffer_idx;
+                updateTrackRangeOwners(tracked_owners);
+            }
+
+            CompactStats const & GetCompactStats() const
+            {
+                return m_compact_stats;
+            }
+
+            // * Buffers that have been empty for more than
+            //   @grace_updates Updates are freed, except for the
+            //   @warm_reserve_count most recently emptied buffers
+            //   of each allocator which are kept so scenes that
+            //   keep adding and removing geometry don't recreate
+            //   buffers every few Updates
+            void SetBufferReclaim(uint grace_updates,
+                                  uint warm_reserve_count)
+            {
+                m_reclaim_grace_updates = grace_updates;
+                m_reclaim_warm_reserve = warm_reserve_count;
+            }
+
+            ReclaimStats const & GetReclaimStats() const
+            {
+                return m_reclaim_stats;
+            }
+
+            // * Keeps the size of all buffers under @budget_bytes by
+            //   releasing the ranges of geometry that hasn't been
+            //   drawn (see MarkDrawn) for more than @evict_after_updates
+            //   Updates, least recently drawn first. Empty buffers are
+            //   freed before any geometry is evicted
+            // * Only retained geometry (Geometry::SetRetainGeometry)
+            //   is evicted. It's uploaded again from the retained data
+            //   in the first Update after it's marked as drawn
+            // * A @budget_bytes of 0 disables the budget
+            void SetMemoryBudget(u64 budget_bytes,
+                                 uint evict_after_updates)
+            {
+                m_budget_bytes = budget_bytes;
+                m_budget_evict_updates = evict_after_updates;
+            }
+
+            u64 GetMemoryBudget() const
+            {
+                return m_budget_bytes;
             }
 
-            std::set<gl::Buffer*>& GetBuffersToInit()
+            // * Records that the Entity's DrawCall was (or, if its
+            //   geometry is evicted, would have been) drawn since
+            //   the last Update
+            void MarkDrawn(Id const ent_id)
+            {
+                if(ent_id < m_list_ent_drawn_update.size()) {
+                    m_list_ent_drawn_update[ent_id] = m_update_count;
+                }
+            }
+
+            bool GetEvicted(Id const ent_id) const
+            {
+                return (ent_id < m_list_geometry_ranges.size() &&
+                        m_list_geometry_ranges[ent_id].evicted);
+            }
+
+            BudgetStats const & GetBudgetStats() const
+            {
+                return m_budget_stats;
+            }
+
+            // * Buffers created in the last Update (in order)
+            std::vector<gl::Buffer*>& GetBuffersToInit()
             {
                 return m_list_buffers_to_init;
             }
 
-            std::set<gl::Buffer*>& GetBuffersToSync()
+            // * Buffers updated in the last Update, each listed
+            //   once in the order they were first updated
+            std::vector<gl::Buffer*>& GetBuffersToSync()
             {
                 return m_list_buffers_to_sync;
             }
@@ -226,6 +436,13 @@ namespace ks
                 return m_list_new_buffers;
             }
 
+            // * Buffers freed in the last Update; these should
+            //   be cleaned up on the render thread
+            std::vector<shared_ptr<gl::Buffer>>& GetRemovedBuffers()
+            {
+                return m_list_removed_buffers;
+            }
+
             std::vector<Id>& GetRemovedEntities()
             {
                 return m_list_ents_rem;
@@ -246,62 +463,302 @@ namespace ks
 #ifndef KS_ENV_AUTO_TEST
         private:
 #endif
-            void createDiffs(std::vector<Id>& list_ents_rem,
+            void beginUpdate(std::vector<RenderData> const &list_render_data)
+            {
+                m_list_ents_rem.clear();
+                m_list_ents_add.clear();
+
+                m_list_buffers_to_init.clear();
+                clearBuffersToSync();
+                m_list_new_buffers.clear();
+                m_list_removed_buffers.clear();
+                m_upload_stats = UploadStats();
+                m_compact_stats = CompactStats();
+                m_reclaim_stats = ReclaimStats();
+                m_budget_stats = BudgetStats();
+                m_update_count++;
+
+                for(auto const ent_id : m_list_ents_upd) {
+                    m_list_ent_updated[ent_id] = 0;
+                }
+                m_list_ents_upd.clear();
+
+                // We need to resize the RenderGeometry list if
+                // its smaller than the entity count
+                m_entity_count = list_render_data.size();
+                if(m_list_geometry_ranges.size() < m_entity_count) {
+                    m_list_geometry_ranges.resize(m_entity_count);
+                    m_list_ent_updated.resize(m_entity_count,0);
+                    m_list_ent_drawn_update.resize(m_entity_count,0);
+                }
+            }
+
+            void processUpdate(std::vector<RenderData>& list_render_data)
+            {
+                // Process removed RenderData/Geometry
+                for(auto const ent_id : m_list_ents_rem)
+                {
+                    auto& geometry_ranges = m_list_geometry_ranges[ent_id];
+                    removeGeometryRanges(geometry_ranges);
+                }
+
+                // Process added RenderData/Geometry
+                for(auto const ent_id : m_list_ents_add)
+                {
+                    auto& render_data = list_render_data[ent_id];
+                    auto& geometry = render_data.GetGeometry();
+                    auto& geometry_ranges = m_list_geometry_ranges[ent_id];
+
+                    auto const vx_buff_count =
+                            render_data.GetBufferLayout()->
+                                GetVertexBufferCount();
+
+                    geometry_ranges.buffer_layout = render_data.GetBufferLayout();
+                    geometry_ranges.list_vx_ranges.resize(vx_buff_count);
+                    geometry_ranges.list_vx_buffer_idx.resize(vx_buff_count,0);
+                    geometry_ranges.list_vx_sizes.resize(vx_buff_count,0);
+                    geometry_ranges.valid = true;
+
+                    // Added geometry counts as drawn in this Update
+                    m_list_ent_drawn_update[ent_id] = m_update_count-1;
+
+                    // Ensure this is uploaded in the case where RenderData
+                    // has been removed/added but GeometryData is the same
+                    // TODO Shoudl this be removed?
+                    for(uint i=0; i < vx_buff_count; i++) {
+                        geometry.SetVertexBufferUpdated(i);
+                    }
+
+                    if(geometry_ranges.buffer_layout->GetIsIndexed()) {
+                        geometry.SetIndexBufferUpdated();
+                    }
+                }
+
+                // Process all current RenderData/Geometry
+                for(auto const &ent_rd : m_list_ent_rd_curr)
+                {
+                    auto& render_data = list_render_data[ent_rd.first];
+                    auto& geometry = render_data.GetGeometry();
+                    auto& geometry_ranges = m_list_geometry_ranges[ent_rd.first];
+
+                    // Evicted geometry is restored once it's drawn again;
+                    // until then any updates are kept in the retained data
+                    if(geometry_ranges.evicted)
+                    {
+                        if(m_budget_bytes > 0 &&
+                           getUndrawnUpdates(ent_rd.first) > 0 &&
+                           geometry.GetRetainGeometry()) {
+                            continue;
+                        }
+                        restoreGeometryRanges(geometry_ranges,geometry);
+                    }
+
+                    if(geometry.GetUpdatedGeometry() &&
+                       checkUpdatedGeometry(geometry))
+                    {
+                        if(m_upload_budget_bytes > 0) {
+                            m_list_upload_ents.push_back(ent_rd.first);
+                            continue;
+                        }
+
+                        uploadGeometry(ent_rd.first,geometry);
+                    }
+                }
+
+                if(m_upload_budget_bytes > 0) {
+                    uploadGeometryInBudget(list_render_data);
+                }
+
+                compactBuffers(list_render_data);
+                enforceMemoryBudget(list_render_data);
+                reclaimEmptyBuffers();
+
+                // Merge the queued uploads for each buffer
+                planUploads(list_render_data);
+                m_list_upload_data.clear();
+            }
+
+            void uploadGeometry(Id const ent_id, Geometry& geometry)
+            {
+                createGeometryRanges(
+                            ent_id,
+                            m_list_geometry_ranges[ent_id],
+                            geometry);
+
+                geometry.ClearGeometryUpdates();
+
+                m_list_ents_upd.push_back(ent_id);
+                m_list_ent_updated[ent_id] = 1;
+            }
+
+            // * Uploads the geometry in m_list_upload_ents by priority
+            //   until m_upload_budget_bytes is used up. The updates of
+            //   the rest are kept in their Geometry for the next Update
+            void uploadGeometryInBudget(std::vector<RenderData>& list_render_data)
+            {
+                std::stable_sort(
+                            m_list_upload_ents.begin(),
+                            m_list_upload_ents.end(),
+                            [&list_render_data](Id a, Id b) {
+                                return (list_render_data[a].GetUploadPriority() >
+                                        list_render_data[b].GetUploadPriority());
+                            });
+
+                u64 upload_bytes = 0;
+                bool deferring = false;
+
+                for(auto const ent_id : m_list_upload_ents)
+                {
+                    auto& geometry = list_render_data[ent_id].GetGeometry();
+                    uint const size_bytes = getUploadSizeBytes(geometry);
+
+                    // Stop at the first geometry that doesn't fit so
+                    // lower priority geometry can't get ahead of it
+                    if(!deferring && upload_bytes > 0 &&
+                       upload_bytes+size_bytes > m_upload_budget_bytes) {
+                        deferring = true;
+                    }
+
+                    if(deferring) {
+                        m_upload_stats.deferred_count++;
+                        m_upload_stats.deferred_bytes += size_bytes;
+                        continue;
+                    }
+
+                    uploadGeometry(ent_id,geometry);
+                    upload_bytes += size_bytes;
+                }
+
+                m_list_upload_ents.clear();
+            }
+
+            // * The bytes that uploading the updated parts of
+            //   @geometry would take
+            uint getUploadSizeBytes(Geometry& geometry)
+            {
+                auto const get_size_bytes =
+                        [](UPtrBuffer const &data,
+                           Geometry::ListUpdateRanges const &list_upd_ranges) {
+                            if(list_upd_ranges.empty()) {
+                                return uint(data->size());
+                            }
+                            uint size_bytes = 0;
+                            for(auto const &upd_range : list_upd_ranges) {
+                                size_bytes += upd_range.second;
+                            }
+                            return size_bytes;
+                        };
+
+                uint size_bytes = 0;
+
+                auto const &list_upd_vx = geometry.GetUpdatedVertexBuffers();
+                auto const &list_upd_vx_ranges = geometry.GetUpdatedVertexBufferRanges();
+
+                for(uint i=0; i < list_upd_vx.size(); i++) {
+                    size_bytes += get_size_bytes(
+                                geometry.GetVertexBuffer(list_upd_vx[i]),
+                                list_upd_vx_ranges[i]);
+                }
+
+                if(geometry.GetUpdatedIndexBuffer()) {
+                    size_bytes += get_size_bytes(
+                                geometry.GetIndexBuffer(),
+                                geometry.GetUpdatedIndexBufferRanges());
+                }
+
+                return size_bytes;
+            }
+
+            // * Compares the RenderData id of each listed Entity with
+            //   the one from the last Update. Entities that were in
+            //   the last Update but aren't listed were removed
+            void createDiffs(std::vector<PairIds> const &list_ent_rd_curr,
+                             std::vector<Id>& list_ents_rem,
                              std::vector<Id>& list_ents_add)
             {
-                auto compare_less_rd =
-                        [this](PairIds const &a, PairIds const &b) -> bool
+                for(auto const &ent_rd : list_ent_rd_curr)
                 {
-                    return (a.second < b.second);
-                };
+                    auto const ent_id = ent_rd.first;
+                    reserveEntity(ent_id);
+                    m_list_ent_listed[ent_id] = 1;
 
-                // TODO opt if either new or old calls are empty
-                // (no need to do a sort or set_diff in those cases)
-                std::vector<PairIds> list_ents_rd_rem;
-                list_ents_rd_rem.reserve(m_list_ent_rd_prev.size());
+                    auto const prev_rd_id = m_list_ent_rd_id[ent_id];
+                    if(prev_rd_id != ent_rd.second)
+                    {
+                        if(prev_rd_id != 0) {
+                            list_ents_rem.push_back(ent_id);
+                        }
+                        list_ents_add.push_back(ent_id);
+                        m_list_ent_rd_id[ent_id] = ent_rd.second;
+                    }
+                }
 
-                std::vector<PairIds> list_ents_rd_add;
-                list_ents_rd_add.reserve(m_list_ent_rd_curr.size());
+                for(auto const &ent_rd : m_list_ent_rd_curr)
+                {
+                    if(m_list_ent_listed[ent_rd.first] == 0)
+                    {
+                        list_ents_rem.push_back(ent_rd.first);
+                        m_list_ent_rd_id[ent_rd.first] = 0;
+                    }
+                }
 
+                m_list_ent_rd_curr = list_ent_rd_curr;
 
-                // Sort curr RenderData entities by uid
-                std::sort(m_list_ent_rd_curr.begin(),
-                          m_list_ent_rd_curr.end(),
-                          compare_less_rd);
+                for(uint i=0; i < m_list_ent_rd_curr.size(); i++)
+                {
+                    auto const ent_id = m_list_ent_rd_curr[i].first;
+                    m_list_ent_listed[ent_id] = 0;
+                    m_list_ent_curr_idx[ent_id] = i;
+                }
+            }
 
-                // Split into added calls and removed calls
+            void createDiffs(std::vector<Id> const &list_ents_changed,
+                             std::vector<RenderData>& list_render_data,
+                             std::vector<Id>& list_ents_rem,
+                             std::vector<Id>& list_ents_add)
+            {
+                for(auto const ent_id : list_ents_changed)
+                {
+                    reserveEntity(ent_id);
 
-                // Get elements in the previous set of render
-                // data but not in this set
-                std::set_difference(
-                    m_list_ent_rd_prev.begin(),
-                    m_list_ent_rd_prev.end(),
-                    m_list_ent_rd_curr.begin(),
-                    m_list_ent_rd_curr.end(),
-                    std::back_inserter(list_ents_rd_rem),
-                    compare_less_rd);
+                    Id const rd_id =
+                            (ent_id < list_render_data.size()) ?
+                                list_render_data[ent_id].GetUniqueId() : 0;
 
+                    auto const prev_rd_id = m_list_ent_rd_id[ent_id];
+                    if(prev_rd_id == rd_id) {
+                        continue;
+                    }
 
-                // Get elements in this set of render data
-                // but not in the previous set
-                std::set_difference(
-                    m_list_ent_rd_curr.begin(),
-                    m_list_ent_rd_curr.end(),
-                    m_list_ent_rd_prev.begin(),
-                    m_list_ent_rd_prev.end(),
-                    std::back_inserter(list_ents_rd_add),
-                    compare_less_rd);
+                    if(prev_rd_id != 0)
+                    {
+                        list_ents_rem.push_back(ent_id);
+
+                        // Swap and pop from the current list
+                        auto const idx = m_list_ent_curr_idx[ent_id];
+                        auto const &ent_rd_last = m_list_ent_rd_curr.back();
+                        m_list_ent_curr_idx[ent_rd_last.first] = idx;
+                        m_list_ent_rd_curr[idx] = ent_rd_last;
+                        m_list_ent_rd_curr.pop_back();
+                    }
 
+                    if(rd_id != 0)
+                    {
+                        list_ents_add.push_back(ent_id);
+                        m_list_ent_curr_idx[ent_id] = m_list_ent_rd_curr.size();
+                        m_list_ent_rd_curr.emplace_back(ent_id,rd_id);
+                    }
 
-                // Create EntityId lists
-                list_ents_rem.reserve(list_ents_rd_rem.size());
-                for(auto& ent_rd : list_ents_rd_rem) {
-                    list_ents_rem.push_back(ent_rd.first);
+                    m_list_ent_rd_id[ent_id] = rd_id;
                 }
+            }
 
-                list_ents_add.reserve(list_ents_rd_add.size());
-                for(auto& ent_rd : list_ents_rd_add) {
-                    list_ents_add.push_back(ent_rd.first);
+            void reserveEntity(Id const ent_id)
+            {
+                if(m_list_ent_rd_id.size() <= ent_id) {
+                    m_list_ent_rd_id.resize(ent_id+1,0);
+                    m_list_ent_listed.resize(ent_id+1,0);
+                    m_list_ent_curr_idx.resize(ent_id+1,0);
                 }
             }
 
@@ -328,24 +785,18 @@ namespace ks
 
             void removeGeometryRanges(GeometryRanges& gm_ranges)
             {
-                bool empty;
-
                 // release buffer ranges
                 if(gm_ranges.vx_ranges_valid)
                 {
                     for(uint i=0; i < gm_ranges.list_vx_ranges.size(); i++)
                     {
-                        gm_ranges.buffer_layout->
-                                GetVertexBufferAllocator(i)->
-                                ReleaseRange(gm_ranges.list_vx_ranges[i],empty);
+                        releaseVxBuffRange(gm_ranges,i);
                     }
                 }
 
                 if(gm_ranges.ix_range_valid)
                 {
-                    gm_ranges.buffer_layout->
-                            GetIndexBufferAllocator()->
-                            ReleaseRange(gm_ranges.ix_range,empty);
+                    releaseIxBuffRange(gm_ranges);
                 }
 
                 // reset all, sets:
@@ -355,61 +806,79 @@ namespace ks
                 gm_ranges = GeometryRanges();
             }
 
-            void createGeometryRanges(GeometryRanges& gm_ranges,
+            void createGeometryRanges(Id const ent_id,
+                                      GeometryRanges& gm_ranges,
                                       Geometry& geometry)
             {
                 auto const keep_buff_data =
                         geometry.GetRetainGeometry();
 
 
+                auto const &list_upd_vx = geometry.GetUpdatedVertexBuffers();
+                auto const &list_upd_vx_ranges = geometry.GetUpdatedVertexBufferRanges();
+
                 // Vertex Buffers
-                for(auto const index : geometry.GetUpdatedVertexBuffers())
+                for(uint i=0; i < list_upd_vx.size(); i++)
                 {
+                    auto const index = list_upd_vx[i];
                     auto& vx_range = gm_ranges.list_vx_ranges[index];
                     auto& vx_data = geometry.GetVertexBuffer(index);
 
-                    // Release the previous ranges
-                    if(gm_ranges.vx_ranges_valid) {
-                        bool empty;
-                        gm_ranges.buffer_layout->
-                                GetVertexBufferAllocator(index)->
-                                    ReleaseRange(vx_range,empty);
+                    // Only upload the updated parts of the data if
+                    // it still fits the range it was uploaded to
+                    if(keep_buff_data &&
+                       gm_ranges.vx_ranges_valid &&
+                       !list_upd_vx_ranges[i].empty() &&
+                       gm_ranges.list_vx_sizes[index] == vx_data->size())
+                    {
+                        updateBufferRanges(
+                                    vx_range.block->data,
+                                    gm_ranges.list_vx_buffer_idx[index],
+                                    vx_range.start,
+                                    list_upd_vx_ranges[i],
+                                    vx_data.get());
+                        continue;
                     }
 
-                    // Acquire new range
-                    bool created_buffer;
-                    acquireVxBuffRange(
-                                gm_ranges,
-                                index,
-                                vx_data->size(),
-                                created_buffer);
+                    // Keep the previous range if the data still fits
+                    bool created_buffer = false;
+                    bool const reused =
+                            gm_ranges.vx_ranges_valid &&
+                            reuseVxBuffRange(gm_ranges,index,vx_data->size());
+
+                    if(!reused) {
+                        // Release the previous ranges
+                        if(gm_ranges.vx_ranges_valid) {
+                            releaseVxBuffRange(gm_ranges,index);
+                        }
+
+                        // Acquire new range
+                        acquireVxBuffRange(
+                                    gm_ranges,
+                                    index,
+                                    vx_data->size(),
+                                    created_buffer);
+                    }
 
                     shared_ptr<gl::Buffer> buffer = vx_range.block->data;
+                    uint const buffer_idx = gm_ranges.list_vx_buffer_idx[index];
 
                     if(created_buffer) {
-                        m_list_buffers_to_init.insert(buffer.get());
+                        m_list_buffers_to_init.push_back(buffer.get());
                         m_list_new_buffers.push_back(buffer);
                     }
 
+                    addRangeOwner(buffer_idx,vx_range.start,vx_data->size(),
+                                  ent_id,index);
+
                     // Update the vertex buffer
-                    if(keep_buff_data) {
-                        buffer->UpdateBuffer(
-                                    make_unique<gl::Buffer::UpdateKeepData>(
-                                        gl::Buffer::Update::Defaults,
-                                        vx_range.start,
-                                        0,vx_range.size,
-                                        vx_data.get()));
-                    }
-                    else {
-                        buffer->UpdateBuffer(
-                                    make_unique<gl::Buffer::UpdateFreeData>(
-                                        gl::Buffer::Update::Defaults,
-                                        vx_range.start,
-                                        0,vx_range.size,
-                                        vx_data.release()));
-                    }
-
-                    m_list_buffers_to_sync.insert(buffer.get());
+                    queueUpload(buffer_idx,
+                                buffer.get(),
+                                vx_range.start,
+                                vx_data->size(),
+                                0,
+                                vx_data,
+                                keep_buff_data);
 
                     gm_ranges.vx_ranges_valid = true;
                 }
@@ -419,49 +888,472 @@ namespace ks
                 {
                     auto& ix_data = geometry.GetIndexBuffer();
 
-                    // Release the previous range
-                    if(gm_ranges.ix_range_valid) {
-                        bool empty;
-                        gm_ranges.buffer_layout->
-                                GetIndexBufferAllocator()->
-                                    ReleaseRange(gm_ranges.ix_range,empty);
+                    if(keep_buff_data &&
+                       gm_ranges.ix_range_valid &&
+                       !geometry.GetUpdatedIndexBufferRanges().empty() &&
+                       gm_ranges.ix_size == ix_data->size())
+                    {
+                        updateBufferRanges(
+                                    gm_ranges.ix_range.block->data,
+                                    gm_ranges.ix_buffer_idx,
+                                    gm_ranges.ix_range.start,
+                                    geometry.GetUpdatedIndexBufferRanges(),
+                                    ix_data.get());
+                        return;
                     }
 
-                    // Acquire new range
-                    bool created_buffer;
-                    acquireIxBuffRange(
-                                gm_ranges,
-                                ix_data->size(),
-                                created_buffer);
+                    // Keep the previous range if the data still fits
+                    bool created_buffer = false;
+                    bool const reused =
+                            gm_ranges.ix_range_valid &&
+                            reuseIxBuffRange(gm_ranges,ix_data->size());
+
+                    if(!reused) {
+                        // Release the previous range
+                        if(gm_ranges.ix_range_valid) {
+                            releaseIxBuffRange(gm_ranges);
+                        }
+
+                        // Acquire new range
+                        acquireIxBuffRange(
+                                    gm_ranges,
+                                    ix_data->size(),
+                                    created_buffer);
+                    }
 
                     shared_ptr<gl::Buffer> buffer =
                             gm_ranges.ix_range.block->data;
 
                     if(created_buffer) {
-                        m_list_buffers_to_init.insert(buffer.get());
+                        m_list_buffers_to_init.push_back(buffer.get());
                         m_list_new_buffers.push_back(buffer);
                     }
 
+                    addRangeOwner(gm_ranges.ix_buffer_idx,
+                                  gm_ranges.ix_range.start,
+                                  ix_data->size(),
+                                  ent_id,k_ix_stream);
+
                     // Update the index buffer
-                    if(keep_buff_data) {
+                    queueUpload(gm_ranges.ix_buffer_idx,
+                                buffer.get(),
+                                gm_ranges.ix_range.start,
+                                ix_data->size(),
+                                0,
+                                ix_data,
+                                keep_buff_data);
+                }
+            }
+
+            template<typename T> // gl::VertexBuffer or gl::IndexBuffer
+            void updateBufferRanges(shared_ptr<T> const &buffer,
+                                    uint const buffer_idx,
+                                    uint const range_start,
+                                    Geometry::ListUpdateRanges const &list_upd_ranges,
+                                    std::vector<u8>* data)
+            {
+                for(auto const &upd_range : list_upd_ranges)
+                {
+                    m_list_buffer_uploads[buffer_idx].push_back(
+                                PendingUpload{
+                                    range_start+upd_range.first,
+                                    upd_range.second,
+                                    upd_range.first,
+                                    data,
+                                    k_not_owned});
+                }
+
+                markBufferToSync(buffer_idx,buffer.get());
+            }
+
+            // * Queues an upload of @size bytes of @data (starting at
+            //   @src_offset) to @dst_start. If the data isn't kept it
+            //   is moved out of the Geometry and freed after the
+            //   upload. Nothing is sent to the buffer until planUploads
+            void queueUpload(uint const buffer_idx,
+                             gl::Buffer* buffer,
+                             uint const dst_start,
+                             uint const size,
+                             uint const src_offset,
+                             UPtrBuffer& data,
+                             bool const keep_data)
+            {
+                uint owned_idx = k_not_owned;
+                std::vector<u8>* data_ptr = data.get();
+
+                if(!keep_data) {
+                    owned_idx = m_list_upload_data.size();
+                    m_list_upload_data.push_back(std::move(data));
+                }
+
+                m_list_buffer_uploads[buffer_idx].push_back(
+                            PendingUpload{
+                                dst_start,
+                                size,
+                                src_offset,
+                                data_ptr,
+                                owned_idx});
+
+                markBufferToSync(buffer_idx,buffer);
+            }
+
+            // * Sorts the uploads queued for each buffer by their
+            //   destination and merges runs of ranges that overlap,
+            //   touch or are separated by a gap no larger than
+            //   m_upload_gap_threshold into single uploads
+            void planUploads(std::vector<RenderData>& list_render_data)
+            {
+                for(uint k=0; k < m_list_buffer_sync_idxs.size(); k++)
+                {
+                    uint const buffer_idx = m_list_buffer_sync_idxs[k];
+                    gl::Buffer* buffer = m_list_buffers_to_sync[k];
+                    auto& list_uploads = m_list_buffer_uploads[buffer_idx];
+                    uint const upload_count = list_uploads.size();
+
+                    m_upload_stats.upload_count += upload_count;
+
+                    // Sort by destination; uploads with the same start
+                    // stay in the order they were queued
+                    m_list_upload_order.resize(upload_count);
+                    std::iota(m_list_upload_order.begin(),
+                              m_list_upload_order.end(),0);
+
+                    std::stable_sort(
+                                m_list_upload_order.begin(),
+                                m_list_upload_order.end(),
+                                [&list_uploads](uint a, uint b) {
+                                    return (list_uploads[a].dst_start <
+                                            list_uploads[b].dst_start);
+                                });
+
+                    uint i=0;
+                    while(i < upload_count)
+                    {
+                        uint const first = i;
+                        auto const &first_upload =
+                                list_uploads[m_list_upload_order[i]];
+
+                        uint const run_start = first_upload.dst_start;
+                        uint run_end = run_start+first_upload.size;
+
+                        for(i=i+1; i < upload_count; i++)
+                        {
+                            auto const &upload =
+                                    list_uploads[m_list_upload_order[i]];
+
+                            if(upload.dst_start > run_end)
+                            {
+                                uint const gap = upload.dst_start-run_end;
+                                if(gap > m_upload_gap_threshold ||
+                                   !fillUploadGap(buffer_idx,
+                                                  run_end,
+                                                  upload.dst_start,
+                                                  nullptr,
+                                                  list_render_data))
+                                {
+                                    break;
+                                }
+                            }
+
+                            run_end = std::max(run_end,
+                                               upload.dst_start+upload.size);
+                        }
+
+                        issueUpload(buffer,
+                                    buffer_idx,
+                                    first,i,
+                                    run_start,run_end,
+                                    list_render_data);
+                    }
+
+                    list_uploads.clear();
+                }
+            }
+
+            // * Issues a single upload for the sorted queued uploads
+            //   in [first,last) which cover [run_start,run_end)
+            void issueUpload(gl::Buffer* buffer,
+                             uint const buffer_idx,
+                             uint const first,
+                             uint const last,
+                             uint const run_start,
+                             uint const run_end,
+                             std::vector<RenderData>& list_render_data)
+            {
+                auto& list_uploads = m_list_buffer_uploads[buffer_idx];
+                uint const run_size = run_end-run_start;
+
+                m_upload_stats.merged_upload_count++;
+                m_upload_stats.upload_bytes += run_size;
+
+                // Single uploads are sent from the retained Geometry
+                // data or take over the data moved out of it, so
+                // neither is copied
+                if(last-first == 1)
+                {
+                    auto const &upload = list_uploads[m_list_upload_order[first]];
+                    if(upload.owned_idx == k_not_owned)
+                    {
                         buffer->UpdateBuffer(
                                     make_unique<gl::Buffer::UpdateKeepData>(
                                         gl::Buffer::Update::Defaults,
-                                        gm_ranges.ix_range.start,
-                                        0,gm_ranges.ix_range.size,
-                                        ix_data.get()));
+                                        upload.dst_start,
+                                        upload.src_offset,
+                                        upload.size,
+                                        upload.data));
                     }
-                    else {
+                    else
+                    {
                         buffer->UpdateBuffer(
                                     make_unique<gl::Buffer::UpdateFreeData>(
                                         gl::Buffer::Update::Defaults,
-                                        gm_ranges.ix_range.start,
-                                        0,gm_ranges.ix_range.size,
-                                        ix_data.release()));
+                                        upload.dst_start,
+                                        upload.src_offset,
+                                        upload.size,
+                                        m_list_upload_data[upload.owned_idx].release()));
+                    }
+                    return;
+                }
+
+                // Copy the run into the staging arena, starting
+                // with any gaps between the queued ranges
+                uint const staging_offset = acquireStaging(run_size);
+                u8* run_data = m_staging_arena->data()+staging_offset;
+
+                uint cursor = run_start;
+                for(uint i=first; i < last; i++)
+                {
+                    auto const &upload = list_uploads[m_list_upload_order[i]];
+                    if(upload.dst_start > cursor)
+                    {
+                        m_upload_stats.gap_bytes += upload.dst_start-cursor;
+
+                        fillUploadGap(buffer_idx,
+                                      cursor,
+                                      upload.dst_start,
+                                      run_data+(cursor-run_start),
+                                      list_render_data);
+                    }
+                    cursor = std::max(cursor,upload.dst_start+upload.size);
+                }
+
+                // Overlapping ranges are copied in the order they
+                // were queued so that the last update wins
+                std::sort(m_list_upload_order.begin()+first,
+                          m_list_upload_order.begin()+last);
+
+                for(uint i=first; i < last; i++)
+                {
+                    auto const &upload = list_uploads[m_list_upload_order[i]];
+                    std::memcpy(run_data+(upload.dst_start-run_start),
+                                upload.data->data()+upload.src_offset,
+                                upload.size);
+                }
+
+                buffer->UpdateBuffer(
+                            make_unique<gl::Buffer::UpdateKeepData>(
+                                gl::Buffer::Update::Defaults,
+                                run_start,
+                                staging_offset,
+                                run_size,
+                                m_staging_arena.get()));
+            }
+
+            // * Reserves @size bytes in the staging arena and returns
+            //   their offset. The arena only grows until the buffers
+            //   are synced so existing offsets stay valid
+            uint acquireStaging(uint const size)
+            {
+                if(!m_staging_arena) {
+                    m_staging_arena = make_unique<std::vector<u8>>();
+                }
+
+                // Keep each upload 4 byte aligned
+                uint const offset = (m_staging_arena->size()+3) & ~3u;
+                m_staging_arena->resize(offset+size);
+
+                m_upload_stats.staging_bytes += size;
+
+                return offset;
+            }
+
+            // * Checks if the clean bytes in [start,end) can be
+            //   uploaded again and copies them to @dst if its set.
+            //   Free space can always be uploaded; used space
+            //   needs the owning geometry's retained data, which
+            //   must not have updates that weren't uploaded yet
+            bool fillUploadGap(uint const buffer_idx,
+                               uint const start,
+                               uint const end,
+                               u8* dst,
+                               std::vector<RenderData>& list_render_data)
+            {
+                if(buffer_idx >= m_list_buffer_range_owners.size()) {
+                    return true;
+                }
+
+                auto const &lkup_owners = m_list_buffer_range_owners[buffer_idx];
+                auto it = lkup_owners.upper_bound(start);
+                if(it != lkup_owners.begin()) {
+                    --it;
+                }
+
+                for(; it != lkup_owners.end() && it->first < end; ++it)
+                {
+                    uint const owner_start = it->first;
+                    uint const owner_end = owner_start+it->second.size;
+                    if(owner_end <= start) {
+                        continue;
+                    }
+
+                    auto const &geometry =
+                            list_render_data[it->second.ent_id].GetGeometry();
+
+                    auto const &data =
+                            (it->second.stream == k_ix_stream) ?
+                                geometry.GetIndexBuffer() :
+                                geometry.GetVertexBuffer(it->second.stream);
+
+                    if(!geometry.GetRetainGeometry() ||
+                       geometry.GetUpdatedGeometry() ||
+                       !data || data->size() != it->second.size) {
+                        return false;
+                    }
+
+                    if(dst) {
+                        uint const copy_start = std::max(start,owner_start);
+                        uint const copy_end = std::min(end,owner_end);
+                        std::memcpy(dst+(copy_start-start),
+                                    data->data()+(copy_start-owner_start),
+                                    copy_end-copy_start);
+                    }
+                }
+
+                return true;
+            }
+
+            // * Range owners are only tracked while a gap threshold
+            //   or compaction is set since they're only needed to
+            //   fill gaps and to find the ranges in a buffer
+            bool getTrackRangeOwners() const
+            {
+                return (m_upload_gap_threshold > 0 ||
+                        m_compact_fill_ratio > 0.0f);
+            }
+
+            void updateTrackRangeOwners(bool const tracked_owners)
+            {
+                bool const track_owners = getTrackRangeOwners();
+                if(track_owners == tracked_owners) {
+                    return;
+                }
+
+                m_list_buffer_range_owners.clear();
+                if(!track_owners) {
+                    return;
+                }
+
+                // Start tracking the owners of existing ranges
+                for(Id ent_id=0; ent_id < m_list_geometry_ranges.size(); ent_id++)
+                {
+                    auto const &gm_ranges = m_list_geometry_ranges[ent_id];
+                    if(gm_ranges.vx_ranges_valid) {
+                        for(uint i=0; i < gm_ranges.list_vx_ranges.size(); i++) {
+                            addRangeOwner(gm_ranges.list_vx_buffer_idx[i],
+                                          gm_ranges.list_vx_ranges[i].start,
+                                          gm_ranges.list_vx_sizes[i],
+                                          ent_id,i);
+                        }
+                    }
+                    if(gm_ranges.ix_range_valid) {
+                        addRangeOwner(gm_ranges.ix_buffer_idx,
+                                      gm_ranges.ix_range.start,
+                                      gm_ranges.ix_size,
+                                      ent_id,k_ix_stream);
                     }
+                }
+            }
+
+            void addRangeOwner(uint const buffer_idx,
+                               uint const start,
+                               uint const size,
+                               Id const ent_id,
+                               uint const stream)
+            {
+                if(!getTrackRangeOwners()) {
+                    return;
+                }
+
+                if(m_list_buffer_range_owners.size() <= buffer_idx) {
+                    m_list_buffer_range_owners.resize(buffer_idx+1);
+                }
+
+                m_list_buffer_range_owners[buffer_idx][start] =
+                        RangeOwner{size,ent_id,stream};
+            }
+
+            void removeRangeOwner(uint const buffer_idx, uint const start)
+            {
+                if(buffer_idx < m_list_buffer_range_owners.size()) {
+                    m_list_buffer_range_owners[buffer_idx].erase(start);
+                }
+            }
+
+            // * Every buffer gets a dense index the first time one of
+            //   its ranges is acquired. Ranges keep the index so that
+            //   marking a buffer to be synced is a flag check and at
+            //   most one push_back (no lookup or allocation per update)
+            uint getBufferIndex(gl::Buffer const * buffer)
+            {
+                auto it = m_lkup_buffer_idx.find(buffer);
+                if(it != m_lkup_buffer_idx.end()) {
+                    return it->second;
+                }
 
-                    m_list_buffers_to_sync.insert(buffer.get());
+                // Reuse the indices of freed buffers
+                if(!m_list_free_buffer_idxs.empty()) {
+                    uint const buffer_idx = m_list_free_buffer_idxs.back();
+                    m_list_free_buffer_idxs.pop_back();
+                    m_lkup_buffer_idx.emplace(buffer,buffer_idx);
+                    return buffer_idx;
                 }
+
+                uint const buffer_idx = m_list_buffer_sync_flags.size();
+                m_lkup_buffer_idx.emplace(buffer,buffer_idx);
+                m_list_buffer_sync_flags.push_back(0);
+                m_list_buffer_uploads.emplace_back();
+                m_list_buffer_blocks.emplace_back();
+
+                return buffer_idx;
+            }
+
+            void releaseBufferIndex(uint const buffer_idx,
+                                    gl::Buffer const * buffer)
+            {
+                m_lkup_buffer_idx.erase(buffer);
+                m_list_buffer_blocks[buffer_idx] = BufferBlock();
+                if(buffer_idx < m_list_buffer_range_owners.size()) {
+                    m_list_buffer_range_owners[buffer_idx].clear();
+                }
+                m_list_free_buffer_idxs.push_back(buffer_idx);
+            }
+
+            void markBufferToSync(uint const buffer_idx, gl::Buffer* buffer)
+            {
+                if(m_list_buffer_sync_flags[buffer_idx] == 0) {
+                    m_list_buffer_sync_flags[buffer_idx] = 1;
+                    m_list_buffers_to_sync.push_back(buffer);
+                    m_list_buffer_sync_idxs.push_back(buffer_idx);
+                }
+            }
+
+            void clearBuffersToSync()
+            {
+                for(auto const buffer_idx : m_list_buffer_sync_idxs) {
+                    m_list_buffer_sync_flags[buffer_idx] = 0;
+                }
+                m_list_buffer_sync_idxs.clear();
+                m_list_buffers_to_sync.clear();
             }
 
             void acquireVxBuffRange(GeometryRanges& gm_ranges,
@@ -469,26 +1361,29 @@ namespace ks
                                     uint const list_vx_sz,
                                     bool& created_buffer)
             {
-                auto& vx_allocator = gm_ranges.buffer_layout->
-                        GetVertexBufferAllocator(vx_buff_index);
+                shared_ptr<VertexBufferAllocator> vx_allocator =
+                        gm_ranges.buffer_layout->
+                            GetVertexBufferAllocator(vx_buff_index,list_vx_sz);
+
+                uint const alloc_sz = gm_ranges.buffer_layout->
+                        GetSizeClasses().GetAllocSizeBytes(list_vx_sz);
 
                 VertexBufferAllocator::Range& vx_range =
                         gm_ranges.list_vx_ranges[vx_buff_index];
 
-                uint const block_sz = vx_allocator->GetBlockSize();
-
-                if(block_sz < list_vx_sz) {
-                    throw GeometryBufferAllocFailed(
-                                "draw: GeometryUpdateTask: "
-                                "list_vx size exceeds capacity: "
-                                "block_sz: "+ks::ToString(block_sz)+", "
-                                "list_vx_sz: "+ks::ToString(list_vx_sz));
+                // Data larger than a block gets a dedicated buffer
+                // that's just large enough to hold it
+                bool const dedicated = (vx_allocator->GetBlockSize() < list_vx_sz);
+                if(dedicated) {
+                    vx_allocator = make_shared<VertexBufferAllocator>(list_vx_sz);
                 }
 
+                uint const block_sz = vx_allocator->GetBlockSize();
+
                 created_buffer = false;
 
                 // Find space to store the data
-                vx_range = vx_allocator->AcquireRange(list_vx_sz);
+                vx_range = vx_allocator->AcquireRange(alloc_sz);
 
                 if(vx_range.size==0) {
                     // Allocate a new block
@@ -499,9 +1394,9 @@ namespace ks
                                     gm_ranges.buffer_layout->GetBufferUsage()));
                     created_buffer = true;
 
-                    vx_range = vx_allocator->AcquireRange(list_vx_sz);
+                    vx_range = vx_allocator->AcquireRange(alloc_sz);
 
-                    assert(vx_range.size == list_vx_sz);
+                    assert(vx_range.size == alloc_sz);
 
                     // Reserve space for an entire block in the gl buffer
                     // (just uploads null data)
@@ -510,6 +1405,21 @@ namespace ks
                                     gl::Buffer::Update::ReUpload,
                                     0,0,block_sz));
                 }
+
+                uint const buffer_idx =
+                        getBufferIndex(vx_range.block->data.get());
+
+                auto& buffer_block = m_list_buffer_blocks[buffer_idx];
+                buffer_block.vx_allocator = vx_allocator.get();
+                buffer_block.vx_block = vx_range.block;
+                if(dedicated) {
+                    buffer_block.dedicated_vx_allocator = vx_allocator;
+                }
+                buffer_block.size_bytes = block_sz;
+                buffer_block.used_bytes += vx_range.size;
+
+                gm_ranges.list_vx_buffer_idx[vx_buff_index] = buffer_idx;
+                gm_ranges.list_vx_sizes[vx_buff_index] = list_vx_sz;
             }
 
             void acquireIxBuffRange(GeometryRanges& gm_ranges,
@@ -519,19 +1429,22 @@ namespace ks
                 auto buff_usage = gm_ranges.buffer_layout->
                         GetBufferUsage();
 
-                auto& ix_allocator = gm_ranges.buffer_layout->
-                        GetIndexBufferAllocator();
+                shared_ptr<IndexBufferAllocator> ix_allocator =
+                        gm_ranges.buffer_layout->
+                            GetIndexBufferAllocator(list_ix_sz);
 
-                uint const block_sz = ix_allocator->GetBlockSize();
+                uint const alloc_sz = gm_ranges.buffer_layout->
+                        GetSizeClasses().GetAllocSizeBytes(list_ix_sz);
 
-                if(block_sz < list_ix_sz) {
-                    throw GeometryBufferAllocFailed(
-                                "draw: GeometryUpdateTask: "
-                                "list_ix size exceeds capacity");
+                bool const dedicated = (ix_allocator->GetBlockSize() < list_ix_sz);
+                if(dedicated) {
+                    ix_allocator = make_shared<IndexBufferAllocator>(list_ix_sz);
                 }
 
+                uint const block_sz = ix_allocator->GetBlockSize();
+
                 created_buffer = false;
-                gm_ranges.ix_range = ix_allocator->AcquireRange(list_ix_sz);
+                gm_ranges.ix_range = ix_allocator->AcquireRange(alloc_sz);
 
                 if(gm_ranges.ix_range.size == 0) {
                     ix_allocator->CreateBlock(
@@ -539,8 +1452,8 @@ namespace ks
 
                     created_buffer = true;
 
-                    gm_ranges.ix_range = ix_allocator->AcquireRange(list_ix_sz);
-                    assert(gm_ranges.ix_range.size == list_ix_sz);
+                    gm_ranges.ix_range = ix_allocator->AcquireRange(alloc_sz);
+                    assert(gm_ranges.ix_range.size == alloc_sz);
 
                     gm_ranges.ix_range.block->data->UpdateBuffer(
                                 make_unique<gl::Buffer::Update>(
@@ -548,9 +1461,708 @@ namespace ks
                                     0,0,block_sz));
                 }
 
+                uint const buffer_idx =
+                        getBufferIndex(gm_ranges.ix_range.block->data.get());
+
+                auto& buffer_block = m_list_buffer_blocks[buffer_idx];
+                buffer_block.ix_allocator = ix_allocator.get();
+                buffer_block.ix_block = gm_ranges.ix_range.block;
+                if(dedicated) {
+                    buffer_block.dedicated_ix_allocator = ix_allocator;
+                }
+                buffer_block.size_bytes = block_sz;
+                buffer_block.used_bytes += gm_ranges.ix_range.size;
+
+                gm_ranges.ix_buffer_idx = buffer_idx;
+                gm_ranges.ix_size = list_ix_sz;
                 gm_ranges.ix_range_valid = true;
             }
 
+            void releaseVxBuffRange(GeometryRanges& gm_ranges,
+                                    uint const vx_buff_index)
+            {
+                auto const &vx_range = gm_ranges.list_vx_ranges[vx_buff_index];
+                uint const buffer_idx = gm_ranges.list_vx_buffer_idx[vx_buff_index];
+
+                removeRangeOwner(buffer_idx,vx_range.start);
+                m_list_buffer_blocks[buffer_idx].used_bytes -= vx_range.size;
+                m_release_count++;
+
+                bool empty;
+                m_list_buffer_blocks[buffer_idx].vx_allocator->
+                        ReleaseRange(vx_range,empty);
+
+                if(empty) {
+                    markBufferEmpty(buffer_idx);
+                }
+            }
+
+            void releaseIxBuffRange(GeometryRanges& gm_ranges)
+            {
+                uint const buffer_idx = gm_ranges.ix_buffer_idx;
+
+                removeRangeOwner(buffer_idx,gm_ranges.ix_range.start);
+                m_list_buffer_blocks[buffer_idx].used_bytes -= gm_ranges.ix_range.size;
+                m_release_count++;
+
+                bool empty;
+                m_list_buffer_blocks[buffer_idx].ix_allocator->
+                        ReleaseRange(gm_ranges.ix_range,empty);
+
+                if(empty) {
+                    markBufferEmpty(buffer_idx);
+                }
+            }
+
+            bool reuseVxBuffRange(GeometryRanges& gm_ranges,
+                                  uint const vx_buff_index,
+                                  uint const list_vx_sz)
+            {
+                auto& vx_range = gm_ranges.list_vx_ranges[vx_buff_index];
+                auto const buffer_layout = gm_ranges.buffer_layout;
+                uint const buffer_idx = gm_ranges.list_vx_buffer_idx[vx_buff_index];
+                auto const &buffer_block = m_list_buffer_blocks[buffer_idx];
+
+                // Data that doesn't fit in a block can stay in its
+                // dedicated buffer
+                auto allocator = buffer_layout->GetVertexBufferAllocator(
+                            vx_buff_index,list_vx_sz).get();
+
+                if(buffer_block.dedicated_vx_allocator &&
+                   allocator->GetBlockSize() < list_vx_sz) {
+                    allocator = buffer_block.vx_allocator;
+                }
+
+                bool const reused =
+                        shrinkBuffRange(
+                            vx_range,
+                            buffer_idx,
+                            buffer_block.vx_allocator,
+                            allocator,
+                            buffer_layout->GetSizeClasses().
+                                GetAllocSizeBytes(list_vx_sz));
+
+                if(reused) {
+                    gm_ranges.list_vx_sizes[vx_buff_index] = list_vx_sz;
+                }
+
+                return reused;
+            }
+
+            bool reuseIxBuffRange(GeometryRanges& gm_ranges,
+                                  uint const list_ix_sz)
+            {
+                auto& ix_range = gm_ranges.ix_range;
+                auto const buffer_layout = gm_ranges.buffer_layout;
+                uint const buffer_idx = gm_ranges.ix_buffer_idx;
+                auto const &buffer_block = m_list_buffer_blocks[buffer_idx];
+
+                auto allocator = buffer_layout->GetIndexBufferAllocator(
+                            list_ix_sz).get();
+
+                if(buffer_block.dedicated_ix_allocator &&
+                   allocator->GetBlockSize() < list_ix_sz) {
+                    allocator = buffer_block.ix_allocator;
+                }
+
+                bool const reused =
+                        shrinkBuffRange(
+                            ix_range,
+                            buffer_idx,
+                            buffer_block.ix_allocator,
+                            allocator,
+                            buffer_layout->GetSizeClasses().
+                                GetAllocSizeBytes(list_ix_sz));
+
+                if(reused) {
+                    gm_ranges.ix_size = list_ix_sz;
+                }
+
+                return reused;
+            }
+
+            // * Keeps @range for data that needs @alloc_sz bytes if
+            //   it fits and would come from the same allocator. The
+            //   unused tail of the range is released in place
+            template<typename AllocatorType>
+            bool shrinkBuffRange(typename AllocatorType::Range& range,
+                                 uint const buffer_idx,
+                                 AllocatorType* range_allocator,
+                                 AllocatorType* allocator,
+                                 uint const alloc_sz)
+            {
+                if(alloc_sz == 0 ||
+                   alloc_sz > range.size ||
+                   allocator != range_allocator) {
+                    return false;
+                }
+
+                if(alloc_sz < range.size) {
+                    auto tail_range = range;
+                    tail_range.start += alloc_sz;
+                    tail_range.size -= alloc_sz;
+
+                    // The rest of the range is still used so the
+                    // buffer can't become empty
+                    bool empty;
+                    allocator->ReleaseRange(tail_range,empty);
+
+                    m_list_buffer_blocks[buffer_idx].used_bytes -= tail_range.size;
+                    m_release_count++;
+
+                    range.size = alloc_sz;
+                }
+
+                m_upload_stats.in_place_count++;
+
+                return true;
+            }
+
+            void markBufferEmpty(uint const buffer_idx)
+            {
+                auto& buffer_block = m_list_buffer_blocks[buffer_idx];
+                buffer_block.empty_update = m_update_count;
+
+                if(!buffer_block.listed_empty) {
+                    buffer_block.listed_empty = true;
+                    m_list_empty_buffer_idxs.push_back(buffer_idx);
+                }
+            }
+
+            // * Frees buffers that stayed empty for longer than the
+            //   grace period while keeping a warm reserve of empty
+            //   buffers for each allocator
+            void reclaimEmptyBuffers()
+            {
+                // Drop buffers that were used again or freed
+                uint count=0;
+                for(uint i=0; i < m_list_empty_buffer_idxs.size(); i++)
+                {
+                    auto const buffer_idx = m_list_empty_buffer_idxs[i];
+                    auto& buffer_block = m_list_buffer_blocks[buffer_idx];
+
+                    if(buffer_block.size_bytes == 0) {
+                        continue; // freed
+                    }
+
+                    if(buffer_block.used_bytes > 0) {
+                        buffer_block.listed_empty = false;
+                        continue;
+                    }
+
+                    // Dedicated buffers only fit the range they were
+                    // created for so they're freed right away
+                    if(buffer_block.GetIsDedicated() && freeBuffer(buffer_idx)) {
+                        m_reclaim_stats.freed_buffer_count++;
+                        continue;
+                    }
+
+                    m_list_empty_buffer_idxs[count] = buffer_idx;
+                    count++;
+                }
+                m_list_empty_buffer_idxs.resize(count);
+
+                if(m_list_empty_buffer_idxs.size() <= m_reclaim_warm_reserve) {
+                    m_reclaim_stats.empty_buffer_count =
+                            m_list_empty_buffer_idxs.size();
+                    return;
+                }
+
+                // Most recently emptied first
+                std::stable_sort(
+                            m_list_empty_buffer_idxs.begin(),
+                            m_list_empty_buffer_idxs.end(),
+                            [this](uint a, uint b) {
+                                return (m_list_buffer_blocks[a].empty_update >
+                                        m_list_buffer_blocks[b].empty_update);
+                            });
+
+                // <allocator, empty buffers kept>
+                m_list_reserve_counts.clear();
+
+                count=0;
+                for(uint i=0; i < m_list_empty_buffer_idxs.size(); i++)
+                {
+                    auto const buffer_idx = m_list_empty_buffer_idxs[i];
+                    auto& buffer_block = m_list_buffer_blocks[buffer_idx];
+
+                    void const * allocator =
+                            (buffer_block.vx_allocator) ?
+                                static_cast<void const *>(buffer_block.vx_allocator) :
+                                static_cast<void const *>(buffer_block.ix_allocator);
+
+                    auto it = std::find_if(
+                                m_list_reserve_counts.begin(),
+                                m_list_reserve_counts.end(),
+                                [allocator](std::pair<void const *,uint> const &a) {
+                                    return (a.first == allocator);
+                                });
+
+                    if(it == m_list_reserve_counts.end()) {
+                        m_list_reserve_counts.emplace_back(allocator,0);
+                        it = std::prev(m_list_reserve_counts.end());
+                    }
+
+                    bool const in_reserve = (it->second < m_reclaim_warm_reserve);
+                    bool const expired =
+                            (m_update_count-buffer_block.empty_update >
+                             m_reclaim_grace_updates);
+
+                    if(!in_reserve && expired && freeBuffer(buffer_idx)) {
+                        m_reclaim_stats.freed_buffer_count++;
+                        continue;
+                    }
+
+                    if(in_reserve) {
+                        it->second++;
+                    }
+
+                    m_list_empty_buffer_idxs[count] = buffer_idx;
+                    count++;
+                }
+                m_list_empty_buffer_idxs.resize(count);
+
+                m_reclaim_stats.empty_buffer_count =
+                        m_list_empty_buffer_idxs.size();
+            }
+
+            // * Moves up to m_compact_bytes_per_update bytes of ranges
+            //   out of the least used buffer below m_compact_fill_ratio
+            //   and frees the buffer once it's empty. The buffer being
+            //   compacted is kept across Updates
+            void compactBuffers(std::vector<RenderData>& list_render_data)
+            {
+                if(m_compact_fill_ratio <= 0.0f) {
+                    return;
+                }
+
+                uint moved_bytes = 0;
+                while(moved_bytes < m_compact_bytes_per_update ||
+                      m_compact_stats.moved_range_count == 0)
+                {
+                    if(m_compact_buffer_idx == k_invalid_buffer_idx) {
+                        m_compact_buffer_idx = getBufferToCompact();
+                        if(m_compact_buffer_idx == k_invalid_buffer_idx) {
+                            return;
+                        }
+                    }
+
+                    auto const buffer_idx = m_compact_buffer_idx;
+                    auto& buffer_block = m_list_buffer_blocks[buffer_idx];
+
+                    if(buffer_block.used_bytes == 0) {
+                        if(freeBuffer(buffer_idx)) {
+                            m_compact_stats.freed_buffer_count++;
+                            m_compact_buffer_idx = k_invalid_buffer_idx;
+                            continue;
+                        }
+                        return; // try again next Update
+                    }
+
+                    auto const &lkup_owners =
+                            m_list_buffer_range_owners[buffer_idx];
+
+                    if(lkup_owners.empty()) {
+                        // Has ranges with unknown owners
+                        buffer_block.compact_release_count = m_release_count;
+                        m_compact_buffer_idx = k_invalid_buffer_idx;
+                        continue;
+                    }
+
+                    auto const owner = lkup_owners.begin()->second;
+
+                    // Ranges that were updated in this Update may
+                    // have uploads queued and deferred ones have data
+                    // that doesn't match their range yet; move them later
+                    if(m_list_ent_updated[owner.ent_id] ||
+                       list_render_data[owner.ent_id].GetGeometry().GetUpdatedGeometry()) {
+                        return;
+                    }
+
+                    if(!moveBuffRange(owner.ent_id,owner.stream,list_render_data)) {
+                        // Skip this buffer until more space is released
+                        buffer_block.compact_release_count = m_release_count;
+                        m_compact_buffer_idx = k_invalid_buffer_idx;
+                        continue;
+                    }
+
+                    moved_bytes += owner.size;
+                    m_compact_stats.moved_range_count++;
+                    m_compact_stats.moved_bytes += owner.size;
+                }
+            }
+
+            uint getBufferToCompact() const
+            {
+                uint buffer_idx = k_invalid_buffer_idx;
+                float min_fill_ratio = m_compact_fill_ratio;
+
+                for(uint i=0; i < m_list_buffer_blocks.size(); i++)
+                {
+                    auto const &buffer_block = m_list_buffer_blocks[i];
+                    // Empty buffers are left to reclaimEmptyBuffers and
+                    // dedicated buffers only fit their own range
+                    if(buffer_block.size_bytes == 0 ||
+                       buffer_block.used_bytes == 0 ||
+                       buffer_block.GetIsDedicated() ||
+                       buffer_block.compact_release_count == m_release_count) {
+                        continue;
+                    }
+
+                    // The owners of all ranges need to be known
+                    uint const owner_count =
+                            (i < m_list_buffer_range_owners.size()) ?
+                                m_list_buffer_range_owners[i].size() : 0;
+
+                    if(buffer_block.used_bytes > 0 && owner_count == 0) {
+                        continue;
+                    }
+
+                    float const fill_ratio =
+                            float(buffer_block.used_bytes)/
+                            float(buffer_block.size_bytes);
+
+                    if(fill_ratio < min_fill_ratio) {
+                        min_fill_ratio = fill_ratio;
+                        buffer_idx = i;
+                    }
+                }
+
+                return buffer_idx;
+            }
+
+            // * Moves a range to another existing buffer and queues
+            //   an upload of the retained data. Fails if the geometry
+            //   wasn't retained, has updates that weren't uploaded
+            //   or the range only fits in its own buffer
+            bool moveBuffRange(Id const ent_id,
+                               uint const stream,
+                               std::vector<RenderData>& list_render_data)
+            {
+                auto& gm_ranges = m_list_geometry_ranges[ent_id];
+                auto& geometry = list_render_data[ent_id].GetGeometry();
+                bool const is_ix = (stream == k_ix_stream);
+
+                auto& data = (is_ix) ?
+                            geometry.GetIndexBuffer() :
+                            geometry.GetVertexBuffer(stream);
+
+                uint const size = (is_ix) ?
+                            gm_ranges.ix_size :
+                            gm_ranges.list_vx_sizes[stream];
+
+                if(!geometry.GetRetainGeometry() ||
+                   geometry.GetUpdatedGeometry() ||
+                   !data || data->size() != size) {
+                    return false;
+                }
+
+                // Acquire the new range before releasing the old one
+                // so the range can't be placed in the same spot
+                bool moved = false;
+                if(is_ix) {
+                    moved = moveBuffRange(
+                                gm_ranges.ix_range,
+                                gm_ranges.ix_buffer_idx,
+                                m_list_buffer_blocks[gm_ranges.ix_buffer_idx].
+                                    ix_allocator,
+                                [this,&gm_ranges]() {
+                                    releaseIxBuffRange(gm_ranges);
+                                });
+                }
+                else {
+                    moved = moveBuffRange(
+                                gm_ranges.list_vx_ranges[stream],
+                                gm_ranges.list_vx_buffer_idx[stream],
+                                m_list_buffer_blocks[gm_ranges.list_vx_buffer_idx[stream]].
+                                    vx_allocator,
+                                [this,&gm_ranges,stream]() {
+                                    releaseVxBuffRange(gm_ranges,stream);
+                                });
+                }
+
+                if(!moved) {
+                    return false;
+                }
+
+                uint const buffer_idx = (is_ix) ?
+                            gm_ranges.ix_buffer_idx :
+                            gm_ranges.list_vx_buffer_idx[stream];
+
+                uint const start = (is_ix) ?
+                            gm_ranges.ix_range.start :
+                            gm_ranges.list_vx_ranges[stream].start;
+
+                auto& buffer_block = m_list_buffer_blocks[buffer_idx];
+                gl::Buffer* buffer = (is_ix) ?
+                            static_cast<gl::Buffer*>(buffer_block.ix_block->data.get()) :
+                            static_cast<gl::Buffer*>(buffer_block.vx_block->data.get());
+
+                addRangeOwner(buffer_idx,start,size,ent_id,stream);
+                queueUpload(buffer_idx,buffer,start,size,0,data,true);
+
+                // The DrawCall needs the new range
+                m_list_ents_upd.push_back(ent_id);
+                m_list_ent_updated[ent_id] = 1;
+
+                return true;
+            }
+
+            template<typename AllocatorType, typename ReleaseFn>
+            bool moveBuffRange(typename AllocatorType::Range& range,
+                               uint& buffer_idx,
+                               AllocatorType* allocator,
+                               ReleaseFn release_range)
+            {
+                auto new_range = allocator->AcquireRange(range.size);
+                if(new_range.size == 0) {
+                    return false;
+                }
+
+                if(new_range.block == range.block) {
+                    bool empty;
+                    allocator->ReleaseRange(new_range,empty);
+                    return false;
+                }
+
+                release_range();
+
+                uint const new_buffer_idx =
+                        getBufferIndex(new_range.block->data.get());
+
+                m_list_buffer_blocks[new_buffer_idx].used_bytes += new_range.size;
+
+                range = new_range;
+                buffer_idx = new_buffer_idx;
+
+                return true;
+            }
+
+            // * The number of Updates since the Entity was last drawn,
+            //   not counting the current one
+            uint getUndrawnUpdates(Id const ent_id) const
+            {
+                return (m_update_count-m_list_ent_drawn_update[ent_id]-1);
+            }
+
+            // * Frees empty buffers and then evicts the geometry of
+            //   the least recently drawn Entities until the buffers
+            //   fit in m_budget_bytes
+            void enforceMemoryBudget(std::vector<RenderData>& list_render_data)
+            {
+                if(m_budget_bytes == 0) {
+                    return;
+                }
+
+                u64 buffer_bytes = 0;
+                for(auto const &buffer_block : m_list_buffer_blocks) {
+                    buffer_bytes += buffer_block.size_bytes;
+                }
+
+                for(auto const buffer_idx : m_list_empty_buffer_idxs)
+                {
+                    if(buffer_bytes <= m_budget_bytes) {
+                        break;
+                    }
+                    freeBudgetBuffer(buffer_idx,buffer_bytes);
+                }
+
+                if(buffer_bytes > m_budget_bytes)
+                {
+                    m_list_evict_ents.clear();
+                    for(auto const &ent_rd : m_list_ent_rd_curr)
+                    {
+                        auto const ent_id = ent_rd.first;
+                        auto const &gm_ranges = m_list_geometry_ranges[ent_id];
+
+                        // Geometry updated in this Update has uploads queued
+                        if(gm_ranges.evicted ||
+                           m_list_ent_updated[ent_id] ||
+                           !(gm_ranges.vx_ranges_valid || gm_ranges.ix_range_valid) ||
+                           getUndrawnUpdates(ent_id) <= m_budget_evict_updates ||
+                           !list_render_data[ent_id].GetGeometry().GetRetainGeometry()) {
+                            continue;
+                        }
+
+                        m_list_evict_ents.push_back(ent_id);
+                    }
+
+                    // Least recently drawn first
+                    std::stable_sort(
+                                m_list_evict_ents.begin(),
+                                m_list_evict_ents.end(),
+                                [this](Id a, Id b) {
+                                    return (m_list_ent_drawn_update[a] <
+                                            m_list_ent_drawn_update[b]);
+                                });
+
+                    for(auto const ent_id : m_list_evict_ents)
+                    {
+                        if(buffer_bytes <= m_budget_bytes) {
+                            break;
+                        }
+                        evictGeometryRanges(ent_id,buffer_bytes);
+                    }
+                }
+
+                m_budget_stats.buffer_bytes = buffer_bytes;
+            }
+
+            // * Releases the Entity's ranges and frees any buffer
+            //   that becomes empty. The DrawCall is invalidated in
+            //   the next Sync
+            void evictGeometryRanges(Id const ent_id, u64& buffer_bytes)
+            {
+                auto& gm_ranges = m_list_geometry_ranges[ent_id];
+
+                if(gm_ranges.vx_ranges_valid)
+                {
+                    for(uint i=0; i < gm_ranges.list_vx_ranges.size(); i++)
+                    {
+                        m_budget_stats.evicted_bytes +=
+                                gm_ranges.list_vx_ranges[i].size;
+
+                        releaseVxBuffRange(gm_ranges,i);
+                        freeBudgetBuffer(gm_ranges.list_vx_buffer_idx[i],buffer_bytes);
+                        gm_ranges.list_vx_ranges[i] = VertexBufferAllocator::Range();
+                    }
+                }
+
+                if(gm_ranges.ix_range_valid)
+                {
+                    m_budget_stats.evicted_bytes += gm_ranges.ix_range.size;
+
+                    releaseIxBuffRange(gm_ranges);
+                    freeBudgetBuffer(gm_ranges.ix_buffer_idx,buffer_bytes);
+                    gm_ranges.ix_range = IndexBufferAllocator::Range();
+                }
+
+                gm_ranges.vx_ranges_valid = false;
+                gm_ranges.ix_range_valid = false;
+                gm_ranges.evicted = true;
+                m_budget_stats.evicted_count++;
+
+                m_list_ents_upd.push_back(ent_id);
+                m_list_ent_updated[ent_id] = 1;
+            }
+
+            // * Marks all of the evicted geometry as updated so
+            //   createGeometryRanges uploads it again
+            void restoreGeometryRanges(GeometryRanges& gm_ranges,
+                                       Geometry& geometry)
+            {
+                for(uint i=0; i < gm_ranges.list_vx_ranges.size(); i++) {
+                    geometry.SetVertexBufferUpdated(i);
+                    m_budget_stats.restored_bytes +=
+                            geometry.GetVertexBuffer(i)->size();
+                }
+
+                if(gm_ranges.buffer_layout->GetIsIndexed()) {
+                    geometry.SetIndexBufferUpdated();
+                    m_budget_stats.restored_bytes +=
+                            geometry.GetIndexBuffer()->size();
+                }
+
+                gm_ranges.evicted = false;
+                m_budget_stats.restored_count++;
+            }
+
+            void freeBudgetBuffer(uint const buffer_idx, u64& buffer_bytes)
+            {
+                auto const &buffer_block = m_list_buffer_blocks[buffer_idx];
+                if(buffer_block.size_bytes == 0 || buffer_block.used_bytes > 0) {
+                    return;
+                }
+
+                uint const size_bytes = buffer_block.size_bytes;
+                if(freeBuffer(buffer_idx)) {
+                    buffer_bytes -= size_bytes;
+                    m_budget_stats.freed_buffer_count++;
+                }
+            }
+
+            // * Removes an empty buffer from its allocator; the gl
+            //   buffer is cleaned up by the RenderSystem through
+            //   GetRemovedBuffers. Buffers with queued uploads are
+            //   kept until the next Update
+            bool freeBuffer(uint const buffer_idx)
+            {
+                if(m_list_buffer_sync_flags[buffer_idx] != 0) {
+                    return false;
+                }
+
+                auto const buffer_block = m_list_buffer_blocks[buffer_idx];
+                shared_ptr<gl::Buffer> buffer;
+
+                if(buffer_block.vx_block) {
+                    buffer = buffer_block.vx_block->data;
+                    buffer_block.vx_allocator->RemoveBlock(buffer_block.vx_block);
+                }
+                else {
+                    buffer = buffer_block.ix_block->data;
+                    buffer_block.ix_allocator->RemoveBlock(buffer_block.ix_block);
+                }
+
+                releaseBufferIndex(buffer_idx,buffer.get());
+                m_list_removed_buffers.push_back(std::move(buffer));
+
+                if(m_compact_buffer_idx == buffer_idx) {
+                    m_compact_buffer_idx = k_invalid_buffer_idx;
+                }
+
+                return true;
+            }
+
+
+            struct PendingUpload
+            {
+                uint dst_start;
+                uint size;
+                uint src_offset;
+                std::vector<u8>* data;
+                uint owned_idx; // index into m_list_upload_data
+            };
+
+            struct RangeOwner
+            {
+                uint size;
+                Id ent_id;
+                uint stream; // vertex buffer index or k_ix_stream
+            };
+
+            // * The allocator block behind each buffer index
+            struct BufferBlock
+            {
+                VertexBufferAllocator* vx_allocator{nullptr};
+                VertexBufferAllocator::Block* vx_block{nullptr};
+                IndexBufferAllocator* ix_allocator{nullptr};
+                IndexBufferAllocator::Block* ix_block{nullptr};
+                uint size_bytes{0};
+                uint used_bytes{0};
+
+                // Set for a buffer created for a single range that
+                // didn't fit in a block; the allocator is only used
+                // by this buffer
+                shared_ptr<VertexBufferAllocator> dedicated_vx_allocator;
+                shared_ptr<IndexBufferAllocator> dedicated_ix_allocator;
+
+                bool GetIsDedicated() const
+                {
+                    return (dedicated_vx_allocator || dedicated_ix_allocator);
+                }
+
+                // m_release_count when compacting this buffer last
+                // failed; it isn't tried again until space is released
+                uint compact_release_count{std::numeric_limits<uint>::max()};
+
+                // m_update_count when the buffer was last emptied
+                uint empty_update{0};
+                bool listed_empty{false};
+            };
+
+            static const uint k_not_owned = std::numeric_limits<uint>::max();
+            static const uint k_ix_stream = std::numeric_limits<uint>::max();
+            static const uint k_invalid_buffer_idx = std::numeric_limits<uint>::max();
 
             uint m_entity_count;
 
@@ -560,11 +2172,72 @@ namespace ks
             std::vector<Id> m_list_ents_upd;
 
             std::vector<PairIds> m_list_ent_rd_curr;
-            std::vector<PairIds> m_list_ent_rd_prev;
+
+            // * Indexed by Entity Id: the RenderData id from the last
+            //   Update (0 if none), the index into m_list_ent_rd_curr
+            //   and a scratch flag used by createDiffs
+            std::vector<Id> m_list_ent_rd_id;
+            std::vector<uint> m_list_ent_curr_idx;
+            std::vector<u8> m_list_ent_listed;
             std::vector<GeometryRanges> m_list_geometry_ranges;
-            std::set<gl::Buffer*> m_list_buffers_to_init;
-            std::set<gl::Buffer*> m_list_buffers_to_sync;
+            std::vector<gl::Buffer*> m_list_buffers_to_init;
+            std::vector<gl::Buffer*> m_list_buffers_to_sync;
             std::vector<shared_ptr<gl::Buffer>> m_list_new_buffers;
+
+            // * Dirty buffer tracking; the flags and lookup are
+            //   indexed by buffer index and persist across Updates
+            std::unordered_map<gl::Buffer const *,uint> m_lkup_buffer_idx;
+            std::vector<u8> m_list_buffer_sync_flags;
+            std::vector<uint> m_list_buffer_sync_idxs;
+
+            // * Upload planning; queued uploads are indexed by
+            //   buffer index and issued at the end of each Update
+            std::vector<std::vector<PendingUpload>> m_list_buffer_uploads;
+            std::vector<UPtrBuffer> m_list_upload_data;
+            std::vector<uint> m_list_upload_order;
+            uint m_upload_gap_threshold{0};
+            UploadStats m_upload_stats;
+
+            // * Upload budget; updated Entities are listed here
+            //   and sorted by priority when the budget is set
+            std::vector<Id> m_list_upload_ents;
+            uint m_upload_budget_bytes{0};
+
+            // * Staging data for merged upload runs. It's written
+            //   by Update, read by the buffers in GLSync and cleared
+            //   as a whole by Sync, keeping its capacity for the
+            //   next Update
+            UPtrBuffer m_staging_arena;
+
+            // * <range start, owner> for each buffer index
+            std::vector<std::map<uint,RangeOwner>> m_list_buffer_range_owners;
+
+            // * Buffer blocks and compaction
+            std::vector<BufferBlock> m_list_buffer_blocks;
+            std::vector<uint> m_list_free_buffer_idxs;
+            std::vector<shared_ptr<gl::Buffer>> m_list_removed_buffers;
+            std::vector<u8> m_list_ent_updated;
+            uint m_release_count{0};
+            float m_compact_fill_ratio{0.0f};
+            uint m_compact_bytes_per_update{0};
+            uint m_compact_buffer_idx{k_invalid_buffer_idx};
+            CompactStats m_compact_stats;
+
+            // * Empty buffer reclaiming
+            std::vector<uint> m_list_empty_buffer_idxs;
+            std::vector<std::pair<void const *,uint>> m_list_reserve_counts;
+            uint m_update_count{0};
+            uint m_reclaim_grace_updates{120};
+            uint m_reclaim_warm_reserve{1};
+            ReclaimStats m_reclaim_stats;
+
+            // * Memory budget; the Update each Entity was last drawn
+            //   in is indexed by Entity Id
+            std::vector<uint> m_list_ent_drawn_update;
+            std::vector<Id> m_list_evict_ents;
+            u64 m_budget_bytes{0};
+            uint m_budget_evict_updates{0};
+            BudgetStats m_budget_stats;
         };
 
         // ============================================================= //
@@ -0,0 +1,126 @@
+/*
+   Copyright (C) 2015 Preet Desai (preet.desai@gmail.com)
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+*/
+
+#include <ks/draw/KsDrawDrawStage.hpp>
+
+namespace ks
+{
+    namespace draw
+    {
+        namespace detail
+        {
+            // ============================================================= //
+            // ============================================================= //
+
+            namespace
+            {
+                GLenum GetGLPrimitive(gl::Primitive primitive)
+                {
+                    switch(primitive)
+                    {
+                        case gl::Primitive::Triangles:      return GL_TRIANGLES;
+                        case gl::Primitive::TriangleFan:    return GL_TRIANGLE_FAN;
+                        case gl::Primitive::TriangleStrip:  return GL_TRIANGLE_STRIP;
+                        case gl::Primitive::Lines:          return GL_LINES;
+                        case gl::Primitive::LineLoop:       return GL_LINE_LOOP;
+                        case gl::Primitive::LineStrip:      return GL_LINE_STRIP;
+                        case gl::Primitive::Points:         return GL_POINTS;
+                    }
+
+                    return GL_TRIANGLES;
+                }
+            }
+
+            void DrawElements(gl::Primitive primitive,
+                              IndexType ix_type,
+                              uint start_byte,
+                              uint size_bytes)
+            {
+                if(ix_type == IndexType::UInt16) {
+                    gl::DrawElements(primitive,start_byte,size_bytes);
+                    return;
+                }
+
+                glDrawElements(
+                            GetGLPrimitive(primitive),
+                            size_bytes/4,
+                            GL_UNSIGNED_INT,
+                            reinterpret_cast<GLvoid const*>(
+                                static_cast<std::uintptr_t>(start_byte)));
+            }
+
+            void DrawElementsInstanced(gl::Primitive primitive,
+                                       IndexType ix_type,
+                                       uint start_byte,
+                                       uint size_bytes,
+                                       uint instance_count)
+            {
+                bool const ix_u16 = (ix_type == IndexType::UInt16);
+
+                glDrawElementsInstanced(
+                            GetGLPrimitive(primitive),
+                            size_bytes/(ix_u16 ? 2 : 4),
+                            ix_u16 ? GL_UNSIGNED_SHORT : GL_UNSIGNED_INT,
+                            reinterpret_cast<GLvoid const*>(
+                                static_cast<std::uintptr_t>(start_byte)),
+                            instance_count);
+            }
+
+            void DrawArraysInstanced(gl::Primitive primitive,
+                                     uint vx_size_bytes,
+                                     uint size_bytes,
+                                     uint instance_count)
+            {
+                // The vertex attributes are already offset to
+                // the start of the range when they're bound
+                glDrawArraysInstanced(
+                            GetGLPrimitive(primitive),
+                            0,
+                            size_bytes/vx_size_bytes,
+                            instance_count);
+            }
+
+            std::vector<sint> GetAttributeLocations(gl::ShaderProgram* shader,
+                                                    gl::VertexLayout const &vx_layout)
+            {
+                std::vector<sint> list_attr_locs;
+                list_attr_locs.reserve(vx_layout.size());
+
+                for(auto const &attr : vx_layout)
+                {
+                    list_attr_locs.push_back(
+                                shader->GetAttributeLocation(attr.name));
+                }
+
+                return list_attr_locs;
+            }
+
+            void SetVertexAttribDivisor(std::vector<sint> const &list_attr_locs,
+                                        uint divisor)
+            {
+                for(auto const location : list_attr_locs)
+                {
+                    if(location >= 0) {
+                        glVertexAttribDivisor(location,divisor);
+                    }
+                }
+            }
+
+            // ============================================================= //
+            // ============================================================= //
+        }
+    }
+}
@@ -42,10 +42,49 @@ namespace ks
             DrawKeyType key;
             std::vector<DrawRange<gl::VertexBuffer>> list_draw_vx;
             DrawRange<gl::IndexBuffer> draw_ix;
+            IndexType ix_type;
+            BufferLayout const * buffer_layout;
+
+            // * The number of instances to draw if the
+            //   BufferLayout is instanced
+            uint instance_count;
+
             shared_ptr<ListUniformUPtrs> list_uniforms;
             bool valid;
         };
 
+        namespace detail
+        {
+            // * gl::DrawElements only handles UInt16 indices so
+            //   UInt32 ranges are drawn with glDrawElements directly
+            void DrawElements(gl::Primitive primitive,
+                              IndexType ix_type,
+                              uint start_byte,
+                              uint size_bytes);
+
+            // * Instanced draws need OpenGL 3.3 or OpenGL ES 3.0
+            void DrawElementsInstanced(gl::Primitive primitive,
+                                       IndexType ix_type,
+                                       uint start_byte,
+                                       uint size_bytes,
+                                       uint instance_count);
+
+            void DrawArraysInstanced(gl::Primitive primitive,
+                                     uint vx_size_bytes,
+                                     uint size_bytes,
+                                     uint instance_count);
+
+            // * The location of each attribute in vx_layout in
+            //   shader (-1 for attributes the shader doesn't use)
+            std::vector<sint> GetAttributeLocations(gl::ShaderProgram* shader,
+                                                    gl::VertexLayout const &vx_layout);
+
+            // * Sets the divisor of every attribute location
+            //   from GetAttributeLocations that's active
+            void SetVertexAttribDivisor(std::vector<sint> const &list_attr_locs,
+                                        uint divisor);
+        }
+
         using StateSetCb = std::function<void(gl::StateSet*)>;
 
         // * Params required to issue a set of DrawCalls for a given stage
@@ -0,0 +1,77 @@
+/*
+   Copyright (C) 2015 Preet Desai (preet.desai@gmail.com)
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+*/
+
+
+#ifndef KS_DRAW_RENDER_DATA_COMPONENT_LIST_HPP
+#define KS_DRAW_RENDER_DATA_COMPONENT_LIST_HPP
+
+#include <ks/ecs/KsEcs.hpp>
+#include <ks/draw/KsDrawComponents.hpp>
+
+namespace ks
+{
+    namespace draw
+    {
+        // ============================================================= //
+        // ============================================================= //
+
+        // * Records RenderData that was created or removed so the
+        //   RenderSystem doesn't have to scan every entity to find
+        //   them. RenderData must be created with Create (and not
+        //   assigned directly to the sparse list)
+        template<typename SceneKeyType,typename DrawKeyType>
+        class RenderDataComponentList final :
+                public ecs::ComponentList<SceneKeyType,RenderData<DrawKeyType>>
+        {
+            using Base = ecs::ComponentList<SceneKeyType,RenderData<DrawKeyType>>;
+
+        public:
+            RenderDataComponentList(ecs::Scene<SceneKeyType>& scene) :
+                Base(scene)
+            {}
+
+            template<typename... Args>
+            RenderData<DrawKeyType>& Create(Id ent_id, Args&&... args)
+            {
+                auto& render_data =
+                        Base::Create(ent_id,std::forward<Args>(args)...);
+
+                m_change_list.Add(ent_id);
+
+                return render_data;
+            }
+
+            void RemoveComponent(Id ent_id) override
+            {
+                Base::RemoveComponent(ent_id);
+                m_change_list.Add(ent_id);
+            }
+
+            EntityChangeList& GetChangeList()
+            {
+                return m_change_list;
+            }
+
+        private:
+            EntityChangeList m_change_list;
+        };
+
+        // ============================================================= //
+        // ============================================================= //
+    }
+}
+
+#endif // KS_DRAW_RENDER_DATA_COMPONENT_LIST_HPP
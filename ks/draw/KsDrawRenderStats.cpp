@@ -43,6 +43,16 @@ namespace ks
             buffer_mem_bytes = 0;
             texture_count = 0;
             texture_mem_bytes = 0;
+            upload_count = 0;
+            merged_upload_count = 0;
+            deferred_upload_count = 0;
+            deferred_upload_bytes = 0;
+            compact_moved_bytes = 0;
+            compact_freed_buffers = 0;
+            empty_buffer_count = 0;
+            reclaimed_buffer_count = 0;
+            evicted_bytes = 0;
+            restored_bytes = 0;
         }
 
         void RenderStats::GenRenderText()
@@ -68,7 +78,17 @@ namespace ks
             text_update_times += "update: " + ks::ToStringFormat(update_ms,3,7,'0') + "ms\n";
             text_update_times += "sync: " + ks::ToStringFormat(sync_ms,3,7,'0') + "ms\n";
             text_update_data += "buffer count/mem: " + ks::ToString(buffer_count) +
-                           "/" + ks::ToString(buffer_mem_bytes) + " bytes";
+                           "/" + ks::ToString(buffer_mem_bytes) + " bytes\n";
+            text_update_data += "uploads/merged: " + ks::ToString(upload_count) +
+                           "/" + ks::ToString(merged_upload_count) + "\n";
+            text_update_data += "uploads deferred: " + ks::ToString(deferred_upload_count) +
+                           "/" + ks::ToString(deferred_upload_bytes) + " bytes\n";
+            text_update_data += "compact moved/freed: " + ks::ToString(compact_moved_bytes) +
+                           " bytes/" + ks::ToString(compact_freed_buffers) + "\n";
+            text_update_data += "buffers empty/reclaimed: " + ks::ToString(empty_buffer_count) +
+                           "/" + ks::ToString(reclaimed_buffer_count) + "\n";
+            text_update_data += "budget evicted/restored: " + ks::ToString(evicted_bytes) +
+                           "/" + ks::ToString(restored_bytes) + " bytes";
         }
 
         void RenderStats::GenCustomText()
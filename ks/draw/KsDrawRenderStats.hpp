@@ -49,6 +49,16 @@ namespace ks
             uint buffer_mem_bytes;
             uint texture_count;
             uint texture_mem_bytes;
+            uint upload_count;
+            uint merged_upload_count;
+            uint deferred_upload_count;
+            u64 deferred_upload_bytes;
+            u64 compact_moved_bytes;
+            uint compact_freed_buffers;
+            uint empty_buffer_count;
+            uint reclaimed_buffer_count;
+            u64 evicted_bytes;
+            u64 restored_bytes;
 
             // set by the rendersystem
             std::string custom_info;
@@ -25,6 +25,7 @@
 
 #include <ks/draw/KsDrawSystem.hpp>
 #include <ks/draw/KsDrawRenderStats.hpp>
+#include <ks/draw/KsDrawRenderDataComponentList.hpp>
 #include <ks/draw/KsDrawDebugTextDrawStage.hpp>
 #include <ks/draw/KsDrawDrawCallUpdater.hpp>
 
@@ -58,7 +59,7 @@ namespace ks
             using RenderData = draw::RenderData<DrawKeyType>;
 
             using RenderDataComponentList =
-                ecs::ComponentList<SceneKeyType,RenderData>;
+                draw::RenderDataComponentList<SceneKeyType,DrawKeyType>;
 
             using DrawCall = draw::DrawCall<DrawKeyType>;
 
@@ -224,6 +225,59 @@ namespace ks
                 m_stats.custom_info = std::move(msg);
             }
 
+            // * If enabled, Update only looks at entities whose
+            //   RenderData was created or removed since the last
+            //   Update instead of scanning every entity. All
+            //   RenderData must then be created through the
+            //   RenderDataComponentList's Create
+            void SetTrackRenderDataChanges(bool track)
+            {
+                if(track && !m_track_render_data_changes) {
+                    // Changes before this weren't used so
+                    // start with a full scan
+                    m_scan_render_data = true;
+                }
+                m_track_render_data_changes = track;
+            }
+
+            // * See DrawCallUpdater::SetUploadGapThreshold
+            void SetUploadGapThreshold(uint gap_bytes)
+            {
+                m_draw_call_updater.SetUploadGapThreshold(gap_bytes);
+            }
+
+            // * See DrawCallUpdater::SetCompaction
+            void SetCompaction(float max_fill_ratio,
+                               uint max_bytes_per_update)
+            {
+                m_draw_call_updater.SetCompaction(
+                            max_fill_ratio,max_bytes_per_update);
+            }
+
+            // * See DrawCallUpdater::SetBufferReclaim
+            void SetBufferReclaim(uint grace_updates,
+                                  uint warm_reserve_count)
+            {
+                m_draw_call_updater.SetBufferReclaim(
+                            grace_updates,warm_reserve_count);
+            }
+
+            // * See DrawCallUpdater::SetUploadBudget
+            void SetUploadBudget(uint bytes_per_update)
+            {
+                m_draw_call_updater.SetUploadBudget(bytes_per_update);
+            }
+
+            // * See DrawCallUpdater::SetMemoryBudget. RenderData counts
+            //   as drawn while it's enabled and has a DrawStage that's
+            //   currently rendered
+            void SetMemoryBudget(u64 budget_bytes,
+                                 uint evict_after_updates)
+            {
+                m_draw_call_updater.SetMemoryBudget(
+                            budget_bytes,evict_after_updates);
+            }
+
             // ============================================================= //
 
             Id RegisterDrawStage(shared_ptr<DrawStage> draw_stage)
@@ -456,6 +510,7 @@ namespace ks
 
                 //
                 m_draw_call_updater.Reset();
+                m_scan_render_data = true;
                 m_list_buffers.clear();
                 m_list_draw_calls.clear();
                 m_list_opq_draw_calls_by_stage.clear();
@@ -470,29 +525,61 @@ namespace ks
                 m_stats.ClearUpdateStats();
                 auto timing_start = std::chrono::high_resolution_clock::now();
 
-                std::vector<PairIds> list_ent_rd;
-
-                auto &list_entities = m_scene->GetEntityList();
-
-                // Get the current list of Drawable entities
-                auto const drawable_mask =
-                        ecs::Scene<SceneKeyType>::template
-                            GetComponentMask<RenderData>();
-
                 auto &list_render_data =
                         m_cmlist_render_data->GetSparseList();
 
+                auto& render_data_changes =
+                        m_cmlist_render_data->GetChangeList();
 
-                for(uint ent_id=0; ent_id < list_entities.size(); ent_id++)
+                if(m_track_render_data_changes && !m_scan_render_data)
+                {
+                    m_draw_call_updater.UpdateChanged(
+                                render_data_changes.GetList(),
+                                list_render_data);
+                }
+                else
                 {
-                    if((list_entities[ent_id].mask & drawable_mask) == drawable_mask)
+                    std::vector<PairIds> list_ent_rd;
+
+                    auto &list_entities = m_scene->GetEntityList();
+
+                    // Get the current list of Drawable entities
+                    auto const drawable_mask =
+                            ecs::Scene<SceneKeyType>::template
+                                GetComponentMask<RenderData>();
+
+                    for(uint ent_id=0; ent_id < list_entities.size(); ent_id++)
                     {
-                        RenderData& render_data = list_render_data[ent_id];
-                        list_ent_rd.emplace_back(ent_id,render_data.GetUniqueId());
+                        if((list_entities[ent_id].mask & drawable_mask) == drawable_mask)
+                        {
+                            RenderData& render_data = list_render_data[ent_id];
+                            list_ent_rd.emplace_back(ent_id,render_data.GetUniqueId());
+                        }
                     }
+
+                    m_draw_call_updater.Update(list_ent_rd,list_render_data);
+                    m_scan_render_data = false;
                 }
 
-                m_draw_call_updater.Update(list_ent_rd,list_render_data);
+                render_data_changes.Clear();
+
+                auto const &upload_stats = m_draw_call_updater.GetUploadStats();
+                m_stats.upload_count = upload_stats.upload_count;
+                m_stats.merged_upload_count = upload_stats.merged_upload_count;
+                m_stats.deferred_upload_count = upload_stats.deferred_count;
+                m_stats.deferred_upload_bytes = upload_stats.deferred_bytes;
+
+                auto const &compact_stats = m_draw_call_updater.GetCompactStats();
+                m_stats.compact_moved_bytes = compact_stats.moved_bytes;
+                m_stats.compact_freed_buffers = compact_stats.freed_buffer_count;
+
+                auto const &reclaim_stats = m_draw_call_updater.GetReclaimStats();
+                m_stats.empty_buffer_count = reclaim_stats.empty_buffer_count;
+                m_stats.reclaimed_buffer_count = reclaim_stats.freed_buffer_count;
+
+                auto const &budget_stats = m_draw_call_updater.GetBudgetStats();
+                m_stats.evicted_bytes = budget_stats.evicted_bytes;
+                m_stats.restored_bytes = budget_stats.restored_bytes;
 
                 auto timing_end = std::chrono::high_resolution_clock::now();
                 m_stats.update_ms = std::chrono::duration_cast<
@@ -546,10 +633,20 @@ namespace ks
                     m_list_xpr_draw_calls_by_stage[i].clear();
                 }
 
+                bool const track_drawn =
+                        (m_draw_call_updater.GetMemoryBudget() > 0);
+
                 for(uint ent_id=0; ent_id < m_list_draw_calls.size(); ent_id++)
                 {
                     auto& draw_call = m_list_draw_calls[ent_id];
 
+                    if(track_drawn &&
+                       (draw_call.valid || m_draw_call_updater.GetEvicted(ent_id)) &&
+                       getDrawn(list_render_data[ent_id]))
+                    {
+                        m_draw_call_updater.MarkDrawn(ent_id);
+                    }
+
                     if(draw_call.valid)
                     {
                         auto& render_data = list_render_data[ent_id];
@@ -701,10 +798,33 @@ namespace ks
                         }
                     }
 
+                    m_list_draw_stage_active.assign(
+                                m_list_draw_stages_sync.size(),0);
+
+                    for(auto stage : m_list_draw_stage_idxs_sync) {
+                        m_list_draw_stage_active[stage] = 1;
+                    }
+
                     m_sync_draw_stages = false;
                 }
             }
 
+            bool getDrawn(RenderData const &render_data) const
+            {
+                if(!render_data.GetEnabled()) {
+                    return false;
+                }
+
+                for(auto stage : render_data.GetDrawStages()) {
+                    if(stage < m_list_draw_stage_active.size() &&
+                       m_list_draw_stage_active[stage]) {
+                        return true;
+                    }
+                }
+
+                return false;
+            }
+
             void syncShaders()
             {
                 m_list_shaders.Sync();
@@ -754,6 +874,20 @@ namespace ks
 
             void syncBuffers()
             {
+                // Clean up freed buffers
+                for(auto& buff : m_draw_call_updater.GetRemovedBuffers()) {
+                    buff->GLCleanUp();
+
+                    auto it = std::find(m_list_buffers.begin(),
+                                        m_list_buffers.end(),
+                                        buff);
+
+                    if(it != m_list_buffers.end()) {
+                        *it = std::move(m_list_buffers.back());
+                        m_list_buffers.pop_back();
+                    }
+                }
+
                 // Init new buffers
                 for(gl::Buffer* buff : m_draw_call_updater.GetBuffersToInit()) {
                     bool ok = buff->GLInit();
@@ -825,6 +959,7 @@ namespace ks
             bool m_sync_draw_stages;
             std::vector<u8> m_list_draw_stage_idxs_sync; // topo sorted
             std::vector<shared_ptr<DrawStage>> m_list_draw_stages_sync; // sparse
+            std::vector<u8> m_list_draw_stage_active; // by stage index
             Graph<shared_ptr<DrawStage>,u8> m_graph_draw_stages_async;
 
             unique_ptr<DebugTextDrawStage> m_debug_text_draw_stage;
@@ -863,6 +998,9 @@ namespace ks
             // == debug == //
             std::string const m_log_prefix{"draw::RenderSystem: "};
             RenderStats m_stats;
+
+            bool m_track_render_data_changes{false};
+            bool m_scan_render_data{true};
         };
     }
 }
@@ -14,6 +14,9 @@
    limitations under the License.
 */
 
+#include <atomic>
+#include <thread>
+
 #include <catch/catch.hpp>
 
 #include <ks/draw/KsDrawComponents.hpp>
@@ -398,6 +401,234 @@ TEST_CASE("ks::draw::BatchSystem")
         REQUIRE(list_batch0_ents.size()==0);
     }
 
+    SECTION("Move entities between batch groups")
+    {
+        ks::shared_ptr<ks::draw::Batch<ks::draw::DefaultDrawKey>> batch_b =
+                ks::make_shared<ks::draw::Batch<ks::draw::DefaultDrawKey>>(
+                    ks::draw::DefaultDrawKey{},
+                    &buffer_layout,
+                    nullptr,
+                    std::vector<ks::u8>{},
+                    ks::draw::Transparency::Opaque,
+                    ks::draw::UpdatePriority::SingleFrame);
+
+        auto const batch_b_id = batch_system->RegisterBatch(batch_b);
+
+        auto const ent1 = scene->CreateEntity();
+        auto batch_data1 = CreateBatchData(scene.get(),ent1,batch0_id);
+        FillGeometry(batch_data1,2);
+        batch_data1->SetRebuild(true);
+
+        auto const ent2 = scene->CreateEntity();
+        auto batch_data2 = CreateBatchData(scene.get(),ent2,batch0_id);
+        FillGeometry(batch_data2,3);
+        batch_data2->SetRebuild(true);
+
+        batch_system->Update(tp0,tp1);
+
+        auto list_batch0_ents = batch_system->GetBatchEntities(batch0_id);
+        REQUIRE(list_batch0_ents.size()==1);
+        REQUIRE(list_render_data[list_batch0_ents[0]].GetGeometry().
+                GetVertexBuffer(0)->size() == GetVertexSizeBytes(5));
+
+        // Move entity 1 to batch_b
+        batch_data1->SetGroupId(batch_b_id);
+        batch_data1->SetRebuild(true);
+        batch_system->Update(tp0,tp1);
+
+        list_batch0_ents = batch_system->GetBatchEntities(batch0_id);
+        auto list_batch_b_ents = batch_system->GetBatchEntities(batch_b_id);
+        REQUIRE(list_batch0_ents.size()==1);
+        REQUIRE(list_batch_b_ents.size()==1);
+        REQUIRE(list_render_data[list_batch0_ents[0]].GetGeometry().
+                GetVertexBuffer(0)->size() == GetVertexSizeBytes(3));
+        REQUIRE(list_render_data[list_batch_b_ents[0]].GetGeometry().
+                GetVertexBuffer(0)->size() == GetVertexSizeBytes(2));
+
+        // Entities in a removed group rejoin a new
+        // group that reuses its id
+        batch_system->RemoveBatch(batch_b_id);
+        auto const batch_c_id = batch_system->RegisterBatch(batch_b);
+        REQUIRE(batch_c_id == batch_b_id);
+
+        batch_data1->SetRebuild(true);
+        batch_system->Update(tp0,tp1);
+
+        auto list_batch_c_ents = batch_system->GetBatchEntities(batch_c_id);
+        REQUIRE(list_batch_c_ents.size()==1);
+        REQUIRE(list_render_data[list_batch_c_ents[0]].GetGeometry().
+                GetVertexBuffer(0)->size() == GetVertexSizeBytes(2));
+
+        // Removing the BatchData removes the entity from its group
+        scene->RemoveEntity(ent1);
+        batch_system->Update(tp0,tp1);
+        REQUIRE(batch_system->GetBatchEntities(batch_c_id).empty());
+    }
+
+    SECTION("Entities join batch groups registered after their BatchData")
+    {
+        ks::shared_ptr<ks::draw::Batch<ks::draw::DefaultDrawKey>> batch_b =
+                ks::make_shared<ks::draw::Batch<ks::draw::DefaultDrawKey>>(
+                    ks::draw::DefaultDrawKey{},
+                    &buffer_layout,
+                    nullptr,
+                    std::vector<ks::u8>{},
+                    ks::draw::Transparency::Opaque,
+                    ks::draw::UpdatePriority::SingleFrame);
+
+        // Free an id so the next RegisterBatch returns it
+        auto const batch_b_id = batch_system->RegisterBatch(batch_b);
+        batch_system->RemoveBatch(batch_b_id);
+
+        auto const ent1 = scene->CreateEntity();
+        auto batch_data1 = CreateBatchData(scene.get(),ent1,batch_b_id);
+        FillGeometry(batch_data1,2);
+        batch_data1->SetRebuild(true);
+
+        batch_system->Update(tp0,tp1);
+        batch_system->Update(tp0,tp1);
+
+        REQUIRE(batch_system->RegisterBatch(batch_b) == batch_b_id);
+        batch_system->Update(tp0,tp1);
+
+        auto list_batch_b_ents = batch_system->GetBatchEntities(batch_b_id);
+        REQUIRE(list_batch_b_ents.size()==1);
+        REQUIRE(list_render_data[list_batch_b_ents[0]].GetGeometry().
+                GetVertexBuffer(0)->size() == GetVertexSizeBytes(2));
+
+        // Entities of a removed group join a group that's
+        // registered with the same id after an Update
+        batch_system->RemoveBatch(batch_b_id);
+        batch_data1->SetRebuild(true);
+        batch_system->Update(tp0,tp1);
+
+        REQUIRE(batch_system->RegisterBatch(batch_b) == batch_b_id);
+        batch_system->Update(tp0,tp1);
+
+        list_batch_b_ents = batch_system->GetBatchEntities(batch_b_id);
+        REQUIRE(list_batch_b_ents.size()==1);
+        REQUIRE(list_render_data[list_batch_b_ents[0]].GetGeometry().
+                GetVertexBuffer(0)->size() == GetVertexSizeBytes(2));
+    }
+
+    SECTION("[MultiFrame] rebuilds requested while a task is running")
+    {
+        auto const ent1 = scene->CreateEntity();
+        auto batch_data1 = CreateBatchData(scene.get(),ent1,batch1_id);
+        FillGeometry(batch_data1,2);
+        batch_data1->SetRebuild(true);
+
+        batch_system->Update(tp0,tp1);
+
+        // The rebuild is kept until the next snapshot
+        // whether or not the first task has finished
+        FillGeometry(batch_data1,4);
+        batch_data1->SetRebuild(true);
+        batch_system->Update(tp0,tp1);
+
+        for(uint i=0; i < 3; i++) {
+            batch_system->WaitOnMultiFrameBatch();
+            batch_system->Update(tp0,tp1);
+        }
+
+        auto const list_batch1_ents = batch_system->GetBatchEntities(batch1_id);
+        REQUIRE(list_batch1_ents.size()==1);
+        REQUIRE(list_render_data[list_batch1_ents[0]].GetGeometry().
+                GetVertexBuffer(0)->size() == GetVertexSizeBytes(4));
+    }
+
+    SECTION("[MultiFrame] cancelled and superseded tasks")
+    {
+        SECTION("Cancel")
+        {
+            ks::draw::detail::BatchGeometryList list_batch_geometry;
+            list_batch_geometry.Resize(2);
+            list_batch_geometry.Get(1).GetVertexBuffers().push_back(GenVertexData(3));
+            list_batch_geometry.Get(1).GetIndexBuffer() = GenIndexData(3);
+
+            auto list_batch_desc =
+                    ks::make_unique<std::vector<ks::draw::detail::BatchTask::BatchDesc>>();
+
+            list_batch_desc->push_back(
+                        ks::draw::detail::BatchTask::BatchDesc{
+                            1,
+                            batch1_id,
+                            &buffer_layout,
+                            ks::draw::PackingPolicy::Sequential,
+                            ks::gl::Primitive::Triangles,
+                            {1},
+                            false,{},{},{},{},0
+                        });
+
+            ks::draw::detail::BatchTask batch_task(
+                        std::move(list_batch_desc),
+                        list_batch_geometry,
+                        nullptr);
+
+            // A task cancelled before it starts doesn't merge anything
+            batch_task.Cancel();
+            batch_task.Process();
+
+            REQUIRE(batch_task.IsCancelled());
+            REQUIRE(batch_task.IsFinished());
+            REQUIRE(batch_task.GetListMergedGeometry(0).empty());
+        }
+
+        SECTION("Supersede")
+        {
+            batch_system->SetMFSupersedeTasks(true);
+
+            // Hold the first task in the pre merge callback
+            // so it's still running when the group changes
+            std::atomic<bool> release_task(false);
+            uint post_merge_count = 0;
+
+            batch_system->SetMFPreMergeCallback(
+                        [&](ks::Id,std::vector<ks::Id> const &list_ent_ids) {
+                            while(!release_task) {
+                                std::this_thread::yield();
+                            }
+                            return list_ent_ids;
+                        });
+
+            batch_system->SetMFPostMergeCallback(
+                        [&](ks::Id,
+                            std::vector<ks::Id> const &,
+                            std::vector<std::vector<ks::Id>> const &) {
+                            post_merge_count++;
+                        });
+
+            auto const ent1 = scene->CreateEntity();
+            auto batch_data1 = CreateBatchData(scene.get(),ent1,batch1_id);
+            FillGeometry(batch_data1,2);
+            batch_data1->SetRebuild(true);
+
+            batch_system->Update(tp0,tp1);
+
+            // The running task is stale once the group changes
+            FillGeometry(batch_data1,4);
+            batch_data1->SetRebuild(true);
+            batch_system->Update(tp0,tp1);
+
+            release_task = true;
+            batch_system->WaitOnMultiFrameBatch();
+
+            // The cancelled result is dropped and a new
+            // snapshot is taken in the same Update
+            batch_system->Update(tp0,tp1);
+            REQUIRE(post_merge_count == 0);
+
+            batch_system->WaitOnMultiFrameBatch();
+            batch_system->Update(tp0,tp1);
+            REQUIRE(post_merge_count == 1);
+
+            auto const list_batch1_ents = batch_system->GetBatchEntities(batch1_id);
+            REQUIRE(list_batch1_ents.size()==1);
+            REQUIRE(list_render_data[list_batch1_ents[0]].GetGeometry().
+                    GetVertexBuffer(0)->size() == GetVertexSizeBytes(4));
+        }
+    }
+
     SECTION("PreMerge, PostMerge, and PreTask Callbacks")
     {
         SECTION("SingleFrame")
@@ -676,4 +907,1382 @@ TEST_CASE("ks::draw::BatchSystem")
         list_batch1_ents = batch_system->GetBatchEntities(batch1_id);
         REQUIRE(list_batch1_ents.size()==0);
     }
+
+    SECTION("[MultiFrame] multiple batch groups")
+    {
+        // Each rebuilt MultiFrame group is merged by a separate
+        // task; verify results are assigned to the right groups
+
+        ks::shared_ptr<ks::draw::Batch<ks::draw::DefaultDrawKey>> batch2 =
+                ks::make_shared<ks::draw::Batch<ks::draw::DefaultDrawKey>>(
+                    ks::draw::DefaultDrawKey{},
+                    &buffer_layout,
+                    nullptr,
+                    std::vector<ks::u8>{},
+                    ks::draw::Transparency::Opaque,
+                    ks::draw::UpdatePriority::MultiFrame);
+
+        auto const batch2_id = batch_system->RegisterBatch(batch2);
+
+        auto const ent1 = scene->CreateEntity();
+        auto batch_data1 = CreateBatchData(scene.get(),ent1,batch1_id);
+        FillGeometry(batch_data1,3,1);
+        batch_data1->SetRebuild(true);
+
+        auto const ent2 = scene->CreateEntity();
+        auto batch_data2 = CreateBatchData(scene.get(),ent2,batch2_id);
+        FillGeometry(batch_data2,5,2);
+        batch_data2->SetRebuild(true);
+
+        auto const ent3 = scene->CreateEntity();
+        auto batch_data3 = CreateBatchData(scene.get(),ent3,batch2_id);
+        FillGeometry(batch_data3,4,3);
+        batch_data3->SetRebuild(true);
+
+        batch_system->Update(tp0,tp1);
+        batch_system->WaitOnMultiFrameBatch();
+
+        batch_system->Update(tp0,tp1);
+        batch_system->WaitOnMultiFrameBatch();
+
+        auto const list_batch1_ents = batch_system->GetBatchEntities(batch1_id);
+        auto const list_batch2_ents = batch_system->GetBatchEntities(batch2_id);
+        REQUIRE(list_batch1_ents.size()==1);
+        REQUIRE(list_batch2_ents.size()==1);
+
+        auto& geometry_batch1 =
+                list_render_data[list_batch1_ents[0]].GetGeometry();
+
+        auto& geometry_batch2 =
+                list_render_data[list_batch2_ents[0]].GetGeometry();
+
+        REQUIRE(*(geometry_batch1.GetVertexBuffer(0)) == *(GenVertexData(3,1)));
+        REQUIRE(geometry_batch2.GetVertexBuffer(0)->size() == GetVertexSizeBytes(9));
+        REQUIRE(geometry_batch2.GetIndexBuffer()->size() == GetIndexSizeBytes(9));
+    }
+
+    SECTION("[MultiFrame] Batch groups don't wait on later groups")
+    {
+        ks::shared_ptr<ks::draw::Batch<ks::draw::DefaultDrawKey>> batch2 =
+                ks::make_shared<ks::draw::Batch<ks::draw::DefaultDrawKey>>(
+                    ks::draw::DefaultDrawKey{},
+                    &buffer_layout,
+                    nullptr,
+                    std::vector<ks::u8>{},
+                    ks::draw::Transparency::Opaque,
+                    ks::draw::UpdatePriority::MultiFrame);
+
+        auto const batch2_id = batch_system->RegisterBatch(batch2);
+
+        // Hold batch2's task in the pre merge callback. Tasks
+        // run in order on the single worker thread so batch1's
+        // task has finished once batch2's has started
+        std::atomic<bool> batch2_started(false);
+        std::atomic<bool> release_task(false);
+
+        batch_system->SetMFPreMergeCallback(
+                    [&](ks::Id batch_id,std::vector<ks::Id> const &list_ent_ids) {
+                        if(batch_id == batch2_id) {
+                            batch2_started = true;
+                            while(!release_task) {
+                                std::this_thread::yield();
+                            }
+                        }
+                        return list_ent_ids;
+                    });
+
+        auto const ent1 = scene->CreateEntity();
+        auto batch_data1 = CreateBatchData(scene.get(),ent1,batch1_id);
+        FillGeometry(batch_data1,3,1);
+        batch_data1->SetRebuild(true);
+
+        auto const ent2 = scene->CreateEntity();
+        auto batch_data2 = CreateBatchData(scene.get(),ent2,batch2_id);
+        FillGeometry(batch_data2,3,2);
+        batch_data2->SetRebuild(true);
+
+        batch_system->Update(tp0,tp1);
+        while(!batch2_started) {
+            std::this_thread::yield();
+        }
+
+        // batch1's results are applied while batch2 is merging.
+        // Checked once the task is released so a failure can't
+        // leave it running
+        batch_system->Update(tp0,tp1);
+
+        auto list_batch1_ents = batch_system->GetBatchEntities(batch1_id);
+        std::vector<ks::u8> vx_batch1;
+        if(list_batch1_ents.size()==1) {
+            vx_batch1 = *(list_render_data[list_batch1_ents[0]].
+                          GetGeometry().GetVertexBuffer(0));
+        }
+        bool const batch2_applied =
+                !batch_system->GetBatchEntities(batch2_id).empty();
+
+        // batch1 takes a new snapshot before batch2 is done
+        FillGeometry(batch_data1,3,3);
+        batch_data1->SetRebuild(true);
+        batch_system->Update(tp0,tp1);
+
+        release_task = true;
+        batch_system->WaitOnMultiFrameBatch();
+
+        REQUIRE(vx_batch1 == *(GenVertexData(3,1)));
+        REQUIRE_FALSE(batch2_applied);
+
+        batch_system->Update(tp0,tp1);
+
+        list_batch1_ents = batch_system->GetBatchEntities(batch1_id);
+        auto const list_batch2_ents = batch_system->GetBatchEntities(batch2_id);
+        REQUIRE(list_batch1_ents.size()==1);
+        REQUIRE(list_batch2_ents.size()==1);
+        REQUIRE(*(list_render_data[list_batch1_ents[0]].GetGeometry().
+                  GetVertexBuffer(0)) == *(GenVertexData(3,3)));
+        REQUIRE(*(list_render_data[list_batch2_ents[0]].GetGeometry().
+                  GetVertexBuffer(0)) == *(GenVertexData(3,2)));
+    }
+
+    SECTION("[MultiFrame] RetainGeometry disabled")
+    {
+        // Single geometry that doesn't need to be retained
+        // should be moved into the BatchTask instead of copied
+        auto const ent1 = scene->CreateEntity();
+        auto batch_data1 = CreateBatchData(scene.get(),ent1,batch1_id);
+        auto geometry_data1 = FillGeometry(batch_data1,3,1);
+        geometry_data1->SetRetainGeometry(false);
+        batch_data1->SetRebuild(true);
+
+        batch_system->Update(tp0,tp1);
+        batch_system->WaitOnMultiFrameBatch();
+        REQUIRE(geometry_data1->GetVertexBuffers().empty());
+        REQUIRE_FALSE(geometry_data1->GetIndexBuffer());
+
+        batch_system->Update(tp0,tp1);
+        batch_system->WaitOnMultiFrameBatch();
+
+        auto const list_batch1_ents = batch_system->GetBatchEntities(batch1_id);
+        REQUIRE(list_batch1_ents.size()==1);
+
+        auto& geometry_batch1 =
+                list_render_data[list_batch1_ents[0]].GetGeometry();
+
+        REQUIRE(*(geometry_batch1.GetVertexBuffer(0)) == *(GenVertexData(3,1)));
+        REQUIRE(*(geometry_batch1.GetIndexBuffer()) == *(GenIndexData(3,1)));
+    }
+
+    SECTION("[MultiFrame] RetainGeometry disabled entities can be regrouped")
+    {
+        auto const ent1 = scene->CreateEntity();
+        auto batch_data1 = CreateBatchData(scene.get(),ent1,batch1_id);
+        auto geometry_data1 = FillGeometry(batch_data1,3,1);
+        geometry_data1->SetRetainGeometry(false);
+        batch_data1->SetRebuild(true);
+
+        auto const ent2 = scene->CreateEntity();
+        auto batch_data2 = CreateBatchData(scene.get(),ent2,batch1_id);
+        auto geometry_data2 = FillGeometry(batch_data2,3,2);
+        geometry_data2->SetRetainGeometry(false);
+        batch_data2->SetRebuild(true);
+
+        batch_system->Update(tp0,tp1);
+        batch_system->WaitOnMultiFrameBatch();
+        batch_system->Update(tp0,tp1);
+        REQUIRE(geometry_data1->GetVertexBuffers().empty());
+        REQUIRE(geometry_data2->GetVertexBuffers().empty());
+
+        // Moving straight to a SingleFrame group merges
+        // the geometry that was moved into the snapshot
+        batch_data1->SetGroupId(batch0_id);
+        batch_system->Update(tp0,tp1);
+
+        auto list_batch0_ents = batch_system->GetBatchEntities(batch0_id);
+        REQUIRE(list_batch0_ents.size()==1);
+        auto& geometry_batch0 =
+                list_render_data[list_batch0_ents[0]].GetGeometry();
+        REQUIRE(*(geometry_batch0.GetVertexBuffer(0)) == *(GenVertexData(3,1)));
+        REQUIRE(*(geometry_batch0.GetIndexBuffer()) == *(GenIndexData(3,1)));
+
+        // Leaving every group gives the geometry back once
+        // the old group no longer needs it
+        batch_system->WaitOnMultiFrameBatch();
+        batch_data2->SetGroupId(0);
+        batch_system->Update(tp0,tp1);
+        batch_system->WaitOnMultiFrameBatch();
+        batch_system->Update(tp0,tp1);
+        REQUIRE(*(geometry_data2->GetVertexBuffer(0)) == *(GenVertexData(3,2)));
+        REQUIRE(batch_system->GetBatchEntities(batch1_id).empty());
+
+        batch_data2->SetGroupId(batch0_id);
+        batch_data2->SetRebuild(true);
+        batch_system->Update(tp0,tp1);
+
+        list_batch0_ents = batch_system->GetBatchEntities(batch0_id);
+        REQUIRE(list_batch0_ents.size()==1);
+
+        std::vector<ks::u8> vx_data = *(GenVertexData(3,1));
+        auto single_vx_data = GenVertexData(3,2);
+        vx_data.insert(vx_data.end(),single_vx_data->begin(),single_vx_data->end());
+        REQUIRE(*(list_render_data[list_batch0_ents[0]].GetGeometry().
+                GetVertexBuffer(0)) == vx_data);
+    }
+
+    SECTION("[MultiFrame] Dedup identical geometry")
+    {
+        batch_system->SetMFDedupGeometry(true);
+
+        // Three identical geometries and one that differs
+        std::vector<BatchData*> list_batch_data_mf;
+        for(uint i=0; i < 4; i++)
+        {
+            auto const ent_id = scene->CreateEntity();
+            list_batch_data_mf.push_back(
+                        CreateBatchData(scene.get(),ent_id,batch1_id));
+            FillGeometry(list_batch_data_mf.back(),3,(i < 3) ? 1 : 2);
+            list_batch_data_mf.back()->SetRebuild(true);
+        }
+
+        auto const gm_size_bytes =
+                GetVertexSizeBytes(3)+GetIndexSizeBytes(3);
+
+        batch_system->Update(tp0,tp1);
+
+        auto const &stats = batch_system->GetStats();
+        REQUIRE(stats.snapshot_bytes == 2*gm_size_bytes);
+        REQUIRE(stats.snapshot_shared_bytes == 2*gm_size_bytes);
+
+        batch_system->WaitOnMultiFrameBatch();
+        batch_system->Update(tp0,tp1);
+
+        // Every entity is still merged
+        auto const list_batch1_ents = batch_system->GetBatchEntities(batch1_id);
+        REQUIRE(list_batch1_ents.size()==1);
+
+        auto const &merged_gm = list_render_data[list_batch1_ents[0]].GetGeometry();
+        REQUIRE(merged_gm.GetVertexBuffer(0)->size() == GetVertexSizeBytes(12));
+
+        std::vector<ks::u8> vx_data;
+        for(uint i=0; i < 4; i++) {
+            auto single_vx_data = GenVertexData(3,(i < 3) ? 1 : 2);
+            vx_data.insert(vx_data.end(),single_vx_data->begin(),single_vx_data->end());
+        }
+        REQUIRE(*(merged_gm.GetVertexBuffer(0)) == vx_data);
+
+        batch_system->SetMFDedupGeometry(false);
+    }
+
+    SECTION("BatchGeometryList")
+    {
+        ks::draw::detail::BatchGeometryList list_batch_geometry(true);
+        list_batch_geometry.Resize(4);
+
+        std::vector<Geometry> list_gm(3);
+        for(uint i=0; i < list_gm.size(); i++) {
+            list_gm[i].GetVertexBuffers().push_back(GenVertexData(3,(i < 2) ? 1 : 2));
+            list_gm[i].GetIndexBuffer() = GenIndexData(3,(i < 2) ? 1 : 2);
+        }
+
+        REQUIRE(ks::draw::detail::CalcGeometryHash(list_gm[0]) ==
+                ks::draw::detail::CalcGeometryHash(list_gm[1]));
+        REQUIRE(ks::draw::detail::GetGeometryEqual(list_gm[0],list_gm[1]));
+        REQUIRE_FALSE(ks::draw::detail::GetGeometryEqual(list_gm[0],list_gm[2]));
+
+        REQUIRE_FALSE(list_batch_geometry.Copy(1,list_gm[0]));
+        REQUIRE(list_batch_geometry.Copy(2,list_gm[1]));
+        REQUIRE_FALSE(list_batch_geometry.Copy(3,list_gm[2]));
+        REQUIRE(list_batch_geometry.GetSharedCount() == 1);
+        REQUIRE(&(list_batch_geometry.Get(1)) == &(list_batch_geometry.Get(2)));
+
+        // Shared geometry is kept until its last entity is removed
+        list_batch_geometry.Remove(1);
+        REQUIRE(list_batch_geometry.GetSharedCount() == 0);
+        REQUIRE(*(list_batch_geometry.Get(2).GetVertexBuffer(0)) ==
+                *(list_gm[1].GetVertexBuffer(0)));
+
+        list_batch_geometry.Remove(2);
+        REQUIRE(list_batch_geometry.GetSharedCount() == 0);
+        REQUIRE(list_batch_geometry.Get(2).GetVertexBuffers().empty());
+
+        // Copying changed geometry releases the old one
+        REQUIRE_FALSE(list_batch_geometry.Copy(3,list_gm[0]));
+        REQUIRE(list_batch_geometry.Copy(1,list_gm[1]));
+        REQUIRE(list_batch_geometry.GetSharedCount() == 1);
+        REQUIRE(*(list_batch_geometry.Get(3).GetVertexBuffer(0)) ==
+                *(list_gm[0].GetVertexBuffer(0)));
+    }
+
+    SECTION("CreateMergedGeometry sizes merged buffers up front")
+    {
+        std::vector<Geometry> list_gm(3);
+        std::vector<Geometry*> list_single_gm;
+        for(uint i=0; i < list_gm.size(); i++) {
+            list_gm[i].GetVertexBuffers().push_back(GenVertexData(i+3,i));
+            list_gm[i].GetIndexBuffer() = GenIndexData(i+3,i);
+            list_single_gm.push_back(&list_gm[i]);
+        }
+
+        Geometry merged_gm;
+        ks::draw::detail::InitMergedGeometry(&buffer_layout,&merged_gm);
+        ks::draw::detail::CreateMergedGeometry(
+                    &buffer_layout,list_single_gm,&merged_gm);
+
+        auto const & merged_vx_data = *(merged_gm.GetVertexBuffer(0));
+        auto const & merged_ix_data = *(merged_gm.GetIndexBuffer());
+
+        REQUIRE(merged_vx_data.size() == GetVertexSizeBytes(12));
+        REQUIRE(merged_ix_data.size() == GetIndexSizeBytes(12));
+        REQUIRE(merged_vx_data.capacity() == merged_vx_data.size());
+        REQUIRE(merged_ix_data.capacity() == merged_ix_data.size());
+
+        // Merging again reuses the existing capacity
+        auto const vx_data_ptr = merged_vx_data.data();
+        list_single_gm.pop_back();
+        ks::draw::detail::CreateMergedGeometry(
+                    &buffer_layout,list_single_gm,&merged_gm);
+
+        REQUIRE(merged_vx_data.size() == GetVertexSizeBytes(7));
+        REQUIRE(merged_vx_data.data() == vx_data_ptr);
+    }
+
+    SECTION("Strip, fan and line primitives")
+    {
+        // Vertices are numbered by their color
+        auto gen_vx_data = [](uint first,uint count) {
+            UPtrBuffer data = ks::make_unique<std::vector<ks::u8>>();
+            for(uint i=first; i < first+count; i++) {
+                ks::gl::Buffer::PushElement<Vertex>(
+                            *data,Vertex{glm::vec4{},glm::u8vec4{i,i,i,i}});
+            }
+            return data;
+        };
+
+        auto gen_ix_data = [](uint count) {
+            UPtrBuffer data = ks::make_unique<std::vector<ks::u8>>();
+            for(uint i=0; i < count; i++) {
+                ks::gl::Buffer::PushElement<ks::u16>(*data,i);
+            }
+            return data;
+        };
+
+        auto get_ix_list = [](Geometry const &gm) {
+            auto const &ix_data = *(gm.GetIndexBuffer());
+            ks::u16 const * ix_ptr = reinterpret_cast<ks::u16 const *>(ix_data.data());
+            return std::vector<ks::u16>(ix_ptr,ix_ptr+ix_data.size()/2);
+        };
+
+        auto get_vx_list = [](Geometry const &gm) {
+            auto const &vx_data = *(gm.GetVertexBuffer(0));
+            Vertex const * vx_ptr = reinterpret_cast<Vertex const *>(vx_data.data());
+            std::vector<uint> list_vx;
+            for(uint i=0; i < vx_data.size()/sizeof(Vertex); i++) {
+                list_vx.push_back(vx_ptr[i].a_v4_color.x);
+            }
+            return list_vx;
+        };
+
+        std::vector<Geometry> list_gm(3);
+        std::vector<Geometry*> list_single_gm;
+        uint const list_vx_counts[3] = {4,3,4};
+        uint vx_first = 0;
+        for(uint i=0; i < 3; i++) {
+            list_gm[i].GetVertexBuffers().push_back(
+                        gen_vx_data(vx_first,list_vx_counts[i]));
+            list_gm[i].GetIndexBuffer() = gen_ix_data(list_vx_counts[i]);
+            list_single_gm.push_back(&list_gm[i]);
+            vx_first += list_vx_counts[i];
+        }
+
+        REQUIRE(ks::draw::detail::GetMergedPrimitive(
+                    ks::gl::Primitive::TriangleFan)==ks::gl::Primitive::Triangles);
+        REQUIRE(ks::draw::detail::GetMergedPrimitive(
+                    ks::gl::Primitive::LineLoop)==ks::gl::Primitive::Lines);
+        REQUIRE(ks::draw::detail::GetMergedPrimitive(
+                    ks::gl::Primitive::TriangleStrip)==ks::gl::Primitive::TriangleStrip);
+
+        Geometry merged_gm;
+        ks::draw::detail::InitMergedGeometry(&buffer_layout,&merged_gm);
+
+        SECTION("Indexed TriangleStrip")
+        {
+            ks::draw::detail::CreateMergedGeometry(
+                        &buffer_layout,list_single_gm,&merged_gm,
+                        ks::gl::Primitive::TriangleStrip);
+
+            // The second strip starts on an even element after
+            // the degenerates; the third needs an extra one
+            std::vector<ks::u16> const list_ix{
+                0,1,2,3, 3,4, 4,5,6, 6,7,7, 7,8,9,10
+            };
+
+            REQUIRE(get_ix_list(merged_gm) == list_ix);
+            REQUIRE(merged_gm.GetVertexBuffer(0)->size() == GetVertexSizeBytes(11));
+
+            // Appending gives the same result
+            Geometry append_gm;
+            ks::draw::detail::InitMergedGeometry(&buffer_layout,&append_gm);
+            for(auto single_gm : list_single_gm) {
+                ks::draw::detail::AppendMergedGeometry(
+                            &buffer_layout,*single_gm,&append_gm,
+                            ks::gl::Primitive::TriangleStrip);
+            }
+            REQUIRE(get_ix_list(append_gm) == list_ix);
+        }
+
+        SECTION("Indexed TriangleFan")
+        {
+            ks::draw::detail::CreateMergedGeometry(
+                        &buffer_layout,list_single_gm,&merged_gm,
+                        ks::gl::Primitive::TriangleFan);
+
+            std::vector<ks::u16> const list_ix{
+                0,1,2, 0,2,3, 4,5,6, 7,8,9, 7,9,10
+            };
+
+            REQUIRE(get_ix_list(merged_gm) == list_ix);
+
+            auto const sizes =
+                    ks::draw::detail::GetMergedSizeBytes(
+                        &buffer_layout,ks::gl::Primitive::TriangleFan,list_gm[0]);
+
+            REQUIRE(sizes.first == GetVertexSizeBytes(4));
+            REQUIRE(sizes.second == GetIndexSizeBytes(6));
+        }
+
+        SECTION("Non indexed LineStrip and LineLoop")
+        {
+            ks::draw::BufferLayout buffer_layout_nix(
+                        ks::gl::Buffer::Usage::Static,
+                        { vx_layout },
+                        { vx_buff_alloc },
+                        nullptr);
+
+            Geometry merged_gm_nix;
+            ks::draw::detail::InitMergedGeometry(&buffer_layout_nix,&merged_gm_nix);
+
+            ks::draw::detail::CreateMergedGeometry(
+                        &buffer_layout_nix,list_single_gm,&merged_gm_nix,
+                        ks::gl::Primitive::LineStrip);
+
+            std::vector<uint> const list_vx_strip{
+                0,1, 1,2, 2,3, 4,5, 5,6, 7,8, 8,9, 9,10
+            };
+            REQUIRE(get_vx_list(merged_gm_nix) == list_vx_strip);
+
+            ks::draw::detail::CreateMergedGeometry(
+                        &buffer_layout_nix,list_single_gm,&merged_gm_nix,
+                        ks::gl::Primitive::LineLoop);
+
+            std::vector<uint> const list_vx_loop{
+                0,1, 1,2, 2,3, 3,0, 4,5, 5,6, 6,4, 7,8, 8,9, 9,10, 10,7
+            };
+            REQUIRE(get_vx_list(merged_gm_nix) == list_vx_loop);
+
+            // Points are appended as is
+            ks::draw::detail::CreateMergedGeometry(
+                        &buffer_layout_nix,list_single_gm,&merged_gm_nix,
+                        ks::gl::Primitive::Points);
+
+            REQUIRE(get_vx_list(merged_gm_nix).size() == 11);
+        }
+
+        SECTION("Non indexed TriangleStrip")
+        {
+            ks::draw::BufferLayout buffer_layout_nix(
+                        ks::gl::Buffer::Usage::Static,
+                        { vx_layout },
+                        { vx_buff_alloc },
+                        nullptr);
+
+            Geometry merged_gm_nix;
+            ks::draw::detail::InitMergedGeometry(&buffer_layout_nix,&merged_gm_nix);
+
+            list_single_gm.pop_back();
+            ks::draw::detail::CreateMergedGeometry(
+                        &buffer_layout_nix,list_single_gm,&merged_gm_nix,
+                        ks::gl::Primitive::TriangleStrip);
+
+            std::vector<uint> const list_vx{0,1,2,3, 3,4, 4,5,6};
+            REQUIRE(get_vx_list(merged_gm_nix) == list_vx);
+        }
+
+        SECTION("TriangleFan batch group [SingleFrame]")
+        {
+            ks::shared_ptr<ks::draw::Batch<ks::draw::DefaultDrawKey>> batch_fan =
+                    ks::make_shared<ks::draw::Batch<ks::draw::DefaultDrawKey>>(
+                        ks::draw::DefaultDrawKey{},
+                        &buffer_layout,
+                        nullptr,
+                        std::vector<ks::u8>{},
+                        ks::draw::Transparency::Opaque,
+                        ks::draw::UpdatePriority::SingleFrame,
+                        ks::draw::MergeMode::Rebuild,
+                        ks::draw::PackingPolicy::Sequential,
+                        ks::gl::Primitive::TriangleFan);
+
+            auto const batch_fan_id = batch_system->RegisterBatch(batch_fan);
+
+            std::vector<BatchData*> list_batch_data_fan;
+            for(uint i=0; i < 2; i++) {
+                auto const ent_id = scene->CreateEntity();
+                list_batch_data_fan.push_back(
+                            CreateBatchData(scene.get(),ent_id,batch_fan_id));
+
+                auto& gm = list_batch_data_fan.back()->GetGeometry();
+                gm.GetVertexBuffers().push_back(gen_vx_data(0,5));
+                gm.GetIndexBuffer() = gen_ix_data(5);
+                gm.SetAllUpdated();
+                list_batch_data_fan.back()->SetRebuild(true);
+            }
+
+            batch_system->Update(tp0,tp1);
+
+            auto const list_fan_ents = batch_system->GetBatchEntities(batch_fan_id);
+            REQUIRE(list_fan_ents.size()==1);
+
+            auto& fan_gm = list_render_data[list_fan_ents[0]].GetGeometry();
+            REQUIRE(fan_gm.GetIndexBuffer()->size() == GetIndexSizeBytes(18));
+            REQUIRE(batch_system->GetPackingStats(batch_fan_id).ix_size_bytes ==
+                    GetIndexSizeBytes(18));
+
+            // Same sized updates are merged again instead of patched
+            list_batch_data_fan[1]->GetGeometry().SetAllUpdated();
+            list_batch_data_fan[1]->SetRebuild(true);
+            batch_system->Update(tp0,tp1);
+            REQUIRE(fan_gm.GetIndexBuffer()->size() == GetIndexSizeBytes(18));
+            REQUIRE(fan_gm.GetUpdatedIndexBufferRanges().empty());
+
+            batch_system->RemoveBatch(batch_fan_id);
+        }
+    }
+
+    SECTION("Index rebase and UInt32 indices")
+    {
+        // Odd counts so the vectorized and scalar paths are both used
+        std::vector<ks::u16> list_ix16(37);
+        std::vector<ks::u32> list_ix32(37);
+        for(uint i=0; i < 37; i++) {
+            list_ix16[i] = i;
+            list_ix32[i] = i;
+        }
+
+        ks::draw::detail::IncrementListIx(list_ix16.data(),37,1000);
+        ks::draw::detail::IncrementListIx(list_ix32.data(),37,70000);
+
+        bool ok=true;
+        for(uint i=0; i < 37; i++) {
+            ok = ok && (list_ix16[i] == i+1000);
+            ok = ok && (list_ix32[i] == i+70000);
+        }
+        REQUIRE(ok);
+
+        // UInt16 indexed layouts are limited to 65536 vertices
+        // per merged geometry
+        ks::draw::BufferLayout buffer_layout_u16(
+                    ks::gl::Buffer::Usage::Static,
+                    { vx_layout },
+                    { ks::make_shared<ks::draw::VertexBufferAllocator>(
+                          GetVertexSizeBytes(65536*2)) },
+                    ks::make_shared<ks::draw::IndexBufferAllocator>(1024));
+
+        ks::draw::BufferLayout buffer_layout_u32(
+                    ks::gl::Buffer::Usage::Static,
+                    { vx_layout },
+                    { ks::make_shared<ks::draw::VertexBufferAllocator>(
+                          GetVertexSizeBytes(65536*2)) },
+                    ks::make_shared<ks::draw::IndexBufferAllocator>(1024),
+                    ks::draw::IndexType::UInt32);
+
+        REQUIRE(ks::draw::detail::GetMergedVertexBufferLimit(
+                    &buffer_layout_u16) == GetVertexSizeBytes(65536));
+
+        REQUIRE(ks::draw::detail::GetMergedVertexBufferLimit(
+                    &buffer_layout_u32) == GetVertexSizeBytes(65536*2));
+
+        // Merge UInt32 indices past the UInt16 range
+        Geometry single_gm0;
+        single_gm0.GetVertexBuffers().push_back(GenVertexData(70000));
+        single_gm0.GetIndexBuffer() = ks::make_unique<std::vector<ks::u8>>();
+        ks::gl::Buffer::PushElement<ks::u32>(*single_gm0.GetIndexBuffer(),0);
+
+        Geometry single_gm1;
+        single_gm1.GetVertexBuffers().push_back(GenVertexData(3));
+        single_gm1.GetIndexBuffer() = ks::make_unique<std::vector<ks::u8>>();
+        for(ks::u32 i=0; i < 3; i++) {
+            ks::gl::Buffer::PushElement<ks::u32>(*single_gm1.GetIndexBuffer(),i);
+        }
+
+        std::vector<Geometry*> list_single_gm{&single_gm0,&single_gm1};
+
+        auto const list_list_single_gm =
+                ks::draw::detail::CreateSplitSingleGeometryLists(
+                    &buffer_layout_u32,list_single_gm);
+
+        REQUIRE(list_list_single_gm.size()==1);
+
+        Geometry merged_gm;
+        ks::draw::detail::InitMergedGeometry(&buffer_layout_u32,&merged_gm);
+        ks::draw::detail::CreateMergedGeometry(
+                    &buffer_layout_u32,list_single_gm,&merged_gm);
+
+        auto const & merged_ix_data = *(merged_gm.GetIndexBuffer());
+        REQUIRE(merged_ix_data.size() == 4*sizeof(ks::u32));
+
+        ks::u32 const * merged_ix =
+                reinterpret_cast<ks::u32 const *>(merged_ix_data.data());
+
+        REQUIRE(merged_ix[0] == 0);
+        REQUIRE(merged_ix[1] == 70000);
+        REQUIRE(merged_ix[3] == 70002);
+
+        // The same geometry must be split for UInt16 indices
+        REQUIRE_THROWS(ks::draw::detail::CreateSplitSingleGeometryLists(
+                           &buffer_layout_u16,list_single_gm));
+    }
+
+    SECTION("Packing policies")
+    {
+        // A VertexBuffer block fits 51 vertices. Adding single
+        // geometries of 30, 30, 20 and 20 vertices in order needs
+        // three merged geometries while the decreasing policies
+        // only need two
+        auto check_packing = [&](ks::Id batch_id,
+                                 ks::draw::UpdatePriority priority,
+                                 uint merged_count) {
+            std::vector<uint> const list_vx_counts{30,30,20,20};
+            for(uint i=0; i < list_vx_counts.size(); i++) {
+                auto const ent = scene->CreateEntity();
+                auto batch_data = CreateBatchData(scene.get(),ent,batch_id);
+                FillGeometry(batch_data,list_vx_counts[i],i);
+                batch_data->SetRebuild(true);
+            }
+
+            batch_system->Update(tp0,tp1);
+            if(priority == ks::draw::UpdatePriority::MultiFrame) {
+                batch_system->WaitOnMultiFrameBatch();
+                batch_system->Update(tp0,tp1);
+            }
+
+            REQUIRE(batch_system->GetBatchEntities(batch_id).size()==merged_count);
+
+            auto const stats = batch_system->GetPackingStats(batch_id);
+            REQUIRE(stats.merged_count == merged_count);
+            REQUIRE(stats.min_merged_count == 2);
+            REQUIRE(stats.vx_size_bytes == GetVertexSizeBytes(100));
+            REQUIRE(stats.vx_capacity_bytes == merged_count*1024);
+            REQUIRE(stats.ix_size_bytes == GetIndexSizeBytes(100));
+        };
+
+        auto create_batch = [&](ks::draw::UpdatePriority priority,
+                                ks::draw::MergeMode merge_mode,
+                                ks::draw::PackingPolicy packing_policy) {
+            return batch_system->RegisterBatch(
+                        ks::make_shared<ks::draw::Batch<ks::draw::DefaultDrawKey>>(
+                            ks::draw::DefaultDrawKey{},
+                            &buffer_layout,
+                            nullptr,
+                            std::vector<ks::u8>{},
+                            ks::draw::Transparency::Opaque,
+                            priority,
+                            merge_mode,
+                            packing_policy));
+        };
+
+        SECTION("Sequential")
+        {
+            check_packing(batch0_id,ks::draw::UpdatePriority::SingleFrame,3);
+        }
+
+        SECTION("FirstFitDecreasing")
+        {
+            auto const batch_id =
+                    create_batch(ks::draw::UpdatePriority::SingleFrame,
+                                 ks::draw::MergeMode::Rebuild,
+                                 ks::draw::PackingPolicy::FirstFitDecreasing);
+
+            check_packing(batch_id,ks::draw::UpdatePriority::SingleFrame,2);
+
+            // Single geometries keep their order within
+            // a merged geometry
+            auto const list_batch_ents = batch_system->GetBatchEntities(batch_id);
+            auto& merged_gm = list_render_data[list_batch_ents[0]].GetGeometry();
+
+            auto vx_data = GenVertexData(30,0);
+            auto vx_data_2 = GenVertexData(20,2);
+            vx_data->insert(vx_data->end(),vx_data_2->begin(),vx_data_2->end());
+
+            REQUIRE(*(merged_gm.GetVertexBuffer(0)) == *vx_data);
+        }
+
+        SECTION("BestFitDecreasing [MultiFrame]")
+        {
+            auto const batch_id =
+                    create_batch(ks::draw::UpdatePriority::MultiFrame,
+                                 ks::draw::MergeMode::Rebuild,
+                                 ks::draw::PackingPolicy::BestFitDecreasing);
+
+            check_packing(batch_id,ks::draw::UpdatePriority::MultiFrame,2);
+        }
+
+        SECTION("BestFitDecreasing [Incremental]")
+        {
+            // Incremental merging places geometry as it's
+            // added, so the 20 vertex geometries fill the
+            // space left by the 30 vertex ones
+            auto const batch_id =
+                    create_batch(ks::draw::UpdatePriority::SingleFrame,
+                                 ks::draw::MergeMode::Incremental,
+                                 ks::draw::PackingPolicy::BestFitDecreasing);
+
+            check_packing(batch_id,ks::draw::UpdatePriority::SingleFrame,2);
+        }
+    }
+
+    SECTION("Geometry larger than a block is merged on its own")
+    {
+        // A VertexBuffer block fits 51 vertices
+        std::vector<uint> const list_vx_counts{10,80,10};
+        for(uint i=0; i < list_vx_counts.size(); i++) {
+            auto const ent = scene->CreateEntity();
+            auto batch_data = CreateBatchData(scene.get(),ent,batch0_id);
+            FillGeometry(batch_data,list_vx_counts[i],i);
+            batch_data->SetRebuild(true);
+        }
+
+        batch_system->Update(tp0,tp1);
+
+        auto const list_batch_ents = batch_system->GetBatchEntities(batch0_id);
+        REQUIRE(list_batch_ents.size() == 3);
+
+        auto& merged_gm = list_render_data[list_batch_ents[1]].GetGeometry();
+        REQUIRE(merged_gm.GetVertexBuffer(0)->size() == GetVertexSizeBytes(80));
+    }
+
+    SECTION("Patch same sized geometry in place [SingleFrame]")
+    {
+        auto test_patch = [&](ks::Id batch_id) {
+            auto const ent1 = scene->CreateEntity();
+            auto batch_data1 = CreateBatchData(scene.get(),ent1,batch_id);
+            FillGeometry(batch_data1,4,1);
+            batch_data1->SetRebuild(true);
+
+            auto const ent2 = scene->CreateEntity();
+            auto batch_data2 = CreateBatchData(scene.get(),ent2,batch_id);
+            FillGeometry(batch_data2,3,2);
+            batch_data2->SetRebuild(true);
+
+            batch_system->Update(tp0,tp1);
+
+            auto list_ents = batch_system->GetBatchEntities(batch_id);
+            REQUIRE(list_ents.size()==1);
+
+            auto& merged_gm = list_render_data[list_ents[0]].GetGeometry();
+            merged_gm.ClearGeometryUpdates();
+
+            // Same size: only entity 2's range is updated
+            FillGeometry(batch_data2,3,5);
+            batch_data2->SetRebuild(true);
+
+            batch_system->Update(tp0,tp1);
+
+            Geometry::ListUpdateRanges const vx_upd_ranges {
+                { GetVertexSizeBytes(4), GetVertexSizeBytes(3) }
+            };
+
+            Geometry::ListUpdateRanges const ix_upd_ranges {
+                { GetIndexSizeBytes(4), GetIndexSizeBytes(3) }
+            };
+
+            REQUIRE(merged_gm.GetUpdatedVertexBuffers().size()==1);
+            REQUIRE(merged_gm.GetUpdatedVertexBufferRanges()[0] == vx_upd_ranges);
+            REQUIRE(merged_gm.GetUpdatedIndexBuffer());
+            REQUIRE(merged_gm.GetUpdatedIndexBufferRanges() == ix_upd_ranges);
+            REQUIRE_FALSE(batch_data2->GetGeometry().GetUpdatedGeometry());
+
+            std::vector<ks::u8> vx_data = *(GenVertexData(4,1));
+            auto vx_data2 = GenVertexData(3,5);
+            vx_data.insert(vx_data.end(),vx_data2->begin(),vx_data2->end());
+            REQUIRE(*(merged_gm.GetVertexBuffer(0)) == vx_data);
+
+            std::vector<ks::u8> ix_data = *(GenIndexData(4,1));
+            auto ix_data2 = GenIndexData(3,5+4); // rebased
+            ix_data.insert(ix_data.end(),ix_data2->begin(),ix_data2->end());
+            REQUIRE(*(merged_gm.GetIndexBuffer()) == ix_data);
+
+            // A different size is merged again
+            merged_gm.ClearGeometryUpdates();
+            FillGeometry(batch_data2,2,6);
+            batch_data2->SetRebuild(true);
+
+            batch_system->Update(tp0,tp1);
+
+            REQUIRE(merged_gm.GetUpdatedVertexBufferRanges().size()==1);
+            REQUIRE(merged_gm.GetUpdatedVertexBufferRanges()[0].empty());
+            REQUIRE(merged_gm.GetVertexBuffer(0)->size()==GetVertexSizeBytes(6));
+        };
+
+        SECTION("Rebuild")
+        {
+            test_patch(batch0_id);
+        }
+
+        SECTION("Incremental")
+        {
+            ks::shared_ptr<ks::draw::Batch<ks::draw::DefaultDrawKey>> batch_i =
+                    ks::make_shared<ks::draw::Batch<ks::draw::DefaultDrawKey>>(
+                        ks::draw::DefaultDrawKey{},
+                        &buffer_layout,
+                        nullptr,
+                        std::vector<ks::u8>{},
+                        ks::draw::Transparency::Opaque,
+                        ks::draw::UpdatePriority::SingleFrame,
+                        ks::draw::MergeMode::Incremental);
+
+            test_patch(batch_system->RegisterBatch(batch_i));
+        }
+    }
+
+    SECTION("TimeSliced merge")
+    {
+        auto test_time_sliced = [&](ks::draw::MergeMode merge_mode) {
+            ks::shared_ptr<ks::draw::Batch<ks::draw::DefaultDrawKey>> batch_ts =
+                    ks::make_shared<ks::draw::Batch<ks::draw::DefaultDrawKey>>(
+                        ks::draw::DefaultDrawKey{},
+                        &buffer_layout,
+                        nullptr,
+                        std::vector<ks::u8>{},
+                        ks::draw::Transparency::Opaque,
+                        ks::draw::UpdatePriority::TimeSliced,
+                        merge_mode);
+
+            auto const batch_ts_id = batch_system->RegisterBatch(batch_ts);
+
+            // Merge a single geometry per Update
+            batch_system->SetTSBudget(0,1);
+
+            std::vector<BatchData*> list_batch_data_ts;
+            for(uint i=0; i < 3; i++)
+            {
+                auto const ent_id = scene->CreateEntity();
+                list_batch_data_ts.push_back(
+                            CreateBatchData(scene.get(),ent_id,batch_ts_id));
+                FillGeometry(list_batch_data_ts.back(),4,i+1);
+                list_batch_data_ts.back()->SetRebuild(true);
+            }
+
+            batch_system->Update(tp0,tp1);
+            REQUIRE(batch_system->GetBatchEntities(batch_ts_id).size()==0);
+
+            batch_system->Update(tp0,tp1);
+            REQUIRE(batch_system->GetBatchEntities(batch_ts_id).size()==0);
+
+            batch_system->Update(tp0,tp1);
+            auto list_ts_ents = batch_system->GetBatchEntities(batch_ts_id);
+            REQUIRE(list_ts_ents.size()==1);
+
+            auto& merged_gm = list_render_data[list_ts_ents[0]].GetGeometry();
+            REQUIRE(merged_gm.GetVertexBuffer(0)->size()==GetVertexSizeBytes(12));
+
+            std::vector<ks::u8> vx_data_prev = *(merged_gm.GetVertexBuffer(0));
+
+            // The last merge is kept until the new one finishes
+            FillGeometry(list_batch_data_ts[1],4,7);
+            list_batch_data_ts[1]->SetRebuild(true);
+
+            batch_system->Update(tp0,tp1);
+            batch_system->Update(tp0,tp1);
+            REQUIRE(*(merged_gm.GetVertexBuffer(0)) == vx_data_prev);
+
+            batch_system->Update(tp0,tp1);
+            std::vector<ks::u8> vx_data = *(GenVertexData(4,1));
+            auto vx_data1 = GenVertexData(4,7);
+            auto vx_data2 = GenVertexData(4,3);
+            vx_data.insert(vx_data.end(),vx_data1->begin(),vx_data1->end());
+            vx_data.insert(vx_data.end(),vx_data2->begin(),vx_data2->end());
+            REQUIRE(*(list_render_data[list_ts_ents[0]].
+                      GetGeometry().GetVertexBuffer(0)) == vx_data);
+
+            // Without a budget the merge finishes in one Update
+            batch_system->SetTSBudget(0,0);
+            FillGeometry(list_batch_data_ts[2],4,8);
+            list_batch_data_ts[2]->SetRebuild(true);
+
+            batch_system->Update(tp0,tp1);
+            auto vx_data3 = GenVertexData(4,8);
+            REQUIRE(std::equal(vx_data3->begin(),vx_data3->end(),
+                               list_render_data[list_ts_ents[0]].
+                               GetGeometry().GetVertexBuffer(0)->begin()+
+                               GetVertexSizeBytes(8)));
+
+            batch_system->RemoveBatch(batch_ts_id);
+        };
+
+        SECTION("Rebuild")
+        {
+            test_time_sliced(ks::draw::MergeMode::Rebuild);
+        }
+
+        SECTION("Incremental")
+        {
+            test_time_sliced(ks::draw::MergeMode::Incremental);
+        }
+    }
+
+    SECTION("Batch stats")
+    {
+        auto const ent1 = scene->CreateEntity();
+        auto batch_data1 = CreateBatchData(scene.get(),ent1,batch0_id);
+        auto geometry_data1 = FillGeometry(batch_data1,4,1);
+        batch_data1->SetRebuild(true);
+
+        auto const ent2 = scene->CreateEntity();
+        auto batch_data2 = CreateBatchData(scene.get(),ent2,batch1_id);
+        auto geometry_data2 = FillGeometry(batch_data2,4,2);
+        batch_data2->SetRebuild(true);
+
+        auto const gm_size_bytes =
+                geometry_data1->GetVertexBuffer(0)->size()+
+                geometry_data1->GetIndexBuffer()->size();
+
+        // SingleFrame groups are merged right away and the
+        // MultiFrame snapshot copies its geometry
+        batch_system->Update(tp0,tp1);
+
+        auto const &stats = batch_system->GetStats();
+        REQUIRE(stats.merge_count == 1);
+        REQUIRE(stats.merged_bytes == gm_size_bytes);
+        REQUIRE(stats.snapshot_bytes == gm_size_bytes);
+        REQUIRE(stats.list_task_stats.empty());
+
+        auto const &group0_stats = stats.list_group_stats[batch0_id];
+        REQUIRE(group0_stats.valid);
+        REQUIRE(group0_stats.merge_count == 1);
+        REQUIRE(group0_stats.merged_bytes == gm_size_bytes);
+        REQUIRE(group0_stats.render_data_bytes == 0);
+        REQUIRE(group0_stats.chunk_count == 1);
+        REQUIRE(group0_stats.chunk_fill_ratio > 0);
+        REQUIRE(group0_stats.chunk_fill_ratio <= 1.0);
+
+        // MultiFrame results are recorded when they're applied
+        batch_system->WaitOnMultiFrameBatch();
+        batch_system->Update(tp0,tp1);
+
+        REQUIRE(stats.merge_count == 1);
+        REQUIRE(stats.snapshot_bytes == 0);
+        REQUIRE(stats.list_task_stats.size() == 1);
+        REQUIRE(stats.list_task_stats[0].batch_desc_count == 1);
+        REQUIRE(stats.list_task_stats[0].merged_bytes == gm_size_bytes);
+        REQUIRE_FALSE(stats.list_task_stats[0].cancelled);
+
+        auto const &group1_stats = stats.list_group_stats[batch1_id];
+        REQUIRE(group1_stats.merge_count == 1);
+        REQUIRE(group1_stats.snapshot_bytes == gm_size_bytes);
+        REQUIRE(group1_stats.merged_bytes == gm_size_bytes);
+        REQUIRE(group1_stats.render_data_bytes == gm_size_bytes);
+        REQUIRE(group1_stats.chunk_count == 1);
+        REQUIRE(group1_stats.task_queue_ms >= 0);
+
+        // Nothing changed
+        batch_system->Update(tp0,tp1);
+        REQUIRE(stats.merge_count == 0);
+        REQUIRE(stats.list_task_stats.empty());
+        REQUIRE(stats.list_group_stats[batch0_id].merge_count == 1);
+        REQUIRE_FALSE(stats.text.empty());
+    }
+
+    SECTION("Instanced batch")
+    {
+        // Base geometry uses vx_layout; each instance
+        // record is a single vec4 offset
+        ks::gl::VertexLayout const inst_layout {
+            {
+                "a_v4_offset",
+                ks::gl::VertexBuffer::Attribute::Type::Float,
+                4,
+                false
+            }
+        };
+
+        // 4 instance records per block
+        auto inst_buff_alloc =
+                ks::make_shared<ks::draw::VertexBufferAllocator>(64);
+
+        ks::draw::BufferLayout inst_buffer_layout(
+                ks::gl::Buffer::Usage::Static,
+                { vx_layout, inst_layout },
+                { vx_buff_alloc, inst_buff_alloc },
+                ix_buff_alloc,
+                ks::draw::IndexType::UInt16,
+                { 0, 1 });
+
+        REQUIRE(inst_buffer_layout.GetIsInstanced());
+        REQUIRE_FALSE(buffer_layout.GetIsInstanced());
+
+        auto inst_batch =
+                ks::make_shared<ks::draw::InstancedBatch<ks::draw::DefaultDrawKey>>(
+                    ks::draw::DefaultDrawKey{},
+                    &inst_buffer_layout,
+                    nullptr,
+                    std::vector<ks::u8>{},
+                    ks::draw::Transparency::Opaque);
+
+        auto& base_gm = inst_batch->GetBaseGeometry();
+        base_gm.GetVertexBuffers().push_back(GenVertexData(3,1));
+        base_gm.GetIndexBuffer() = GenIndexData(3,1);
+        base_gm.SetAllUpdated();
+
+        auto const inst_batch_id = batch_system->RegisterInstancedBatch(inst_batch);
+
+        auto gen_inst_data = [](uint count,float val) -> UPtrBuffer {
+            auto data = ks::make_unique<std::vector<ks::u8>>();
+            for(uint i=0; i < count; i++) {
+                ks::gl::Buffer::PushElement<glm::vec4>(*data,glm::vec4{val,val,val,val});
+            }
+            return data;
+        };
+
+        auto const ent1 = scene->CreateEntity();
+        auto batch_data1 = CreateBatchData(scene.get(),ent1,inst_batch_id);
+        batch_data1->GetGeometry().GetVertexBuffers().push_back(gen_inst_data(2,1));
+        batch_data1->SetRebuild(true);
+
+        auto const ent2 = scene->CreateEntity();
+        auto batch_data2 = CreateBatchData(scene.get(),ent2,inst_batch_id);
+        batch_data2->GetGeometry().GetVertexBuffers().push_back(gen_inst_data(1,2));
+        batch_data2->SetRebuild(true);
+
+        batch_system->Update(tp0,tp1);
+
+        // Instanced groups are merged in the same Update
+        auto list_inst_ents = batch_system->GetBatchEntities(inst_batch_id);
+        REQUIRE(list_inst_ents.size()==1);
+
+        auto& merged_gm = list_render_data[list_inst_ents[0]].GetGeometry();
+        REQUIRE(*(merged_gm.GetVertexBuffer(0)) == *(GenVertexData(3,1)));
+        REQUIRE(*(merged_gm.GetIndexBuffer()) == *(GenIndexData(3,1)));
+
+        std::vector<ks::u8> inst_data = *(gen_inst_data(2,1));
+        auto inst_data2 = gen_inst_data(1,2);
+        inst_data.insert(inst_data.end(),inst_data2->begin(),inst_data2->end());
+        REQUIRE(*(merged_gm.GetVertexBuffer(1)) == inst_data);
+
+        // Instance records are split across merged geometries
+        // once they don't fit in a block
+        batch_data2->GetGeometry().GetVertexBuffer(0) = gen_inst_data(4,2);
+        batch_data2->SetRebuild(true);
+
+        batch_system->Update(tp0,tp1);
+
+        list_inst_ents = batch_system->GetBatchEntities(inst_batch_id);
+        REQUIRE(list_inst_ents.size()==2);
+
+        auto& merged_gm0 = list_render_data[list_inst_ents[0]].GetGeometry();
+        auto& merged_gm1 = list_render_data[list_inst_ents[1]].GetGeometry();
+        REQUIRE(merged_gm0.GetVertexBuffer(1)->size()==64);
+        REQUIRE(merged_gm1.GetVertexBuffer(1)->size()==32);
+        REQUIRE(*(merged_gm1.GetVertexBuffer(0)) == *(GenVertexData(3,1)));
+
+        // Updating the base geometry doesn't touch instance records
+        merged_gm0.ClearGeometryUpdates();
+        merged_gm1.ClearGeometryUpdates();
+
+        base_gm.GetVertexBuffer(0) = GenVertexData(3,5);
+        base_gm.SetVertexBufferUpdated(0);
+
+        batch_system->Update(tp0,tp1);
+
+        REQUIRE(merged_gm0.GetUpdatedVertexBuffers() == std::vector<ks::u8>{0});
+        REQUIRE(merged_gm1.GetUpdatedVertexBuffers() == std::vector<ks::u8>{0});
+        REQUIRE(*(merged_gm1.GetVertexBuffer(0)) == *(GenVertexData(3,5)));
+
+        // Removing every instance removes the merged entities
+        scene->RemoveEntity(ent1);
+        scene->RemoveEntity(ent2);
+
+        batch_system->Update(tp0,tp1);
+
+        REQUIRE(batch_system->GetBatchEntities(inst_batch_id).empty());
+
+        batch_system->RemoveBatch(inst_batch_id);
+    }
+
+    SECTION("Incremental merge")
+    {
+        // vx block capacity: 1024/20 --> 51 vertices
+        // so two 40 vertex geometries need two chunks
+
+        SECTION("SingleFrame")
+        {
+            ks::shared_ptr<ks::draw::Batch<ks::draw::DefaultDrawKey>> batch_i =
+                    ks::make_shared<ks::draw::Batch<ks::draw::DefaultDrawKey>>(
+                        ks::draw::DefaultDrawKey{},
+                        &buffer_layout,
+                        nullptr,
+                        std::vector<ks::u8>{},
+                        ks::draw::Transparency::Opaque,
+                        ks::draw::UpdatePriority::SingleFrame,
+                        ks::draw::MergeMode::Incremental);
+
+            auto const batch_i_id = batch_system->RegisterBatch(batch_i);
+
+            auto const ent1 = scene->CreateEntity();
+            auto batch_data1 = CreateBatchData(scene.get(),ent1,batch_i_id);
+            FillGeometry(batch_data1,40,1);
+            batch_data1->SetRebuild(true);
+
+            auto const ent2 = scene->CreateEntity();
+            auto batch_data2 = CreateBatchData(scene.get(),ent2,batch_i_id);
+            auto geometry_data2 = FillGeometry(batch_data2,40,2);
+            batch_data2->SetRebuild(true);
+
+            batch_system->Update(tp0,tp1);
+
+            auto list_batch_i_ents = batch_system->GetBatchEntities(batch_i_id);
+            REQUIRE(list_batch_i_ents.size()==2);
+
+            auto& geometry_chunk0 =
+                    list_render_data[list_batch_i_ents[0]].GetGeometry();
+
+            auto& geometry_chunk1 =
+                    list_render_data[list_batch_i_ents[1]].GetGeometry();
+
+            REQUIRE(*(geometry_chunk0.GetVertexBuffer(0)) == *(GenVertexData(40,1)));
+            REQUIRE(*(geometry_chunk1.GetVertexBuffer(0)) == *(GenVertexData(40,2)));
+
+            geometry_chunk0.ClearGeometryUpdates();
+            geometry_chunk1.ClearGeometryUpdates();
+
+            // Updating Entity 2 should only rebuild its chunk
+            geometry_data2->GetVertexBuffer(0) = GenVertexData(40,3);
+            geometry_data2->SetVertexBufferUpdated(0);
+            batch_data2->SetRebuild(true);
+
+            batch_system->Update(tp0,tp1);
+            REQUIRE_FALSE(geometry_chunk0.GetUpdatedGeometry());
+            REQUIRE(geometry_chunk1.GetUpdatedGeometry());
+            REQUIRE(*(geometry_chunk1.GetVertexBuffer(0)) == *(GenVertexData(40,3)));
+
+            geometry_chunk1.ClearGeometryUpdates();
+
+            // Adding a small geometry should fill an existing chunk
+            auto const ent3 = scene->CreateEntity();
+            auto batch_data3 = CreateBatchData(scene.get(),ent3,batch_i_id);
+            FillGeometry(batch_data3,5,4);
+            batch_data3->SetRebuild(true);
+
+            batch_system->Update(tp0,tp1);
+            list_batch_i_ents = batch_system->GetBatchEntities(batch_i_id);
+            REQUIRE(list_batch_i_ents.size()==2);
+            REQUIRE(geometry_chunk0.GetUpdatedGeometry());
+            REQUIRE_FALSE(geometry_chunk1.GetUpdatedGeometry());
+            REQUIRE(geometry_chunk0.GetVertexBuffer(0)->size() == GetVertexSizeBytes(45));
+
+            geometry_chunk0.ClearGeometryUpdates();
+
+            // Removing Entity 2 empties its chunk
+            scene->RemoveEntity(ent2);
+            batch_system->Update(tp0,tp1);
+            list_batch_i_ents = batch_system->GetBatchEntities(batch_i_id);
+            REQUIRE(list_batch_i_ents.size()==1);
+            REQUIRE_FALSE(geometry_chunk0.GetUpdatedGeometry());
+        }
+
+        SECTION("MultiFrame")
+        {
+            ks::shared_ptr<ks::draw::Batch<ks::draw::DefaultDrawKey>> batch_i =
+                    ks::make_shared<ks::draw::Batch<ks::draw::DefaultDrawKey>>(
+                        ks::draw::DefaultDrawKey{},
+                        &buffer_layout,
+                        nullptr,
+                        std::vector<ks::u8>{},
+                        ks::draw::Transparency::Opaque,
+                        ks::draw::UpdatePriority::MultiFrame,
+                        ks::draw::MergeMode::Incremental);
+
+            auto const batch_i_id = batch_system->RegisterBatch(batch_i);
+
+            auto const ent1 = scene->CreateEntity();
+            auto batch_data1 = CreateBatchData(scene.get(),ent1,batch_i_id);
+            FillGeometry(batch_data1,40,1);
+            batch_data1->SetRebuild(true);
+
+            auto const ent2 = scene->CreateEntity();
+            auto batch_data2 = CreateBatchData(scene.get(),ent2,batch_i_id);
+            auto geometry_data2 = FillGeometry(batch_data2,40,2);
+            batch_data2->SetRebuild(true);
+
+            batch_system->Update(tp0,tp1);
+            batch_system->WaitOnMultiFrameBatch();
+
+            batch_system->Update(tp0,tp1);
+            batch_system->WaitOnMultiFrameBatch();
+
+            auto list_batch_i_ents = batch_system->GetBatchEntities(batch_i_id);
+            REQUIRE(list_batch_i_ents.size()==2);
+
+            auto& geometry_chunk0 =
+                    list_render_data[list_batch_i_ents[0]].GetGeometry();
+
+            auto& geometry_chunk1 =
+                    list_render_data[list_batch_i_ents[1]].GetGeometry();
+
+            REQUIRE(*(geometry_chunk0.GetVertexBuffer(0)) == *(GenVertexData(40,1)));
+            REQUIRE(*(geometry_chunk1.GetVertexBuffer(0)) == *(GenVertexData(40,2)));
+
+            geometry_chunk0.ClearGeometryUpdates();
+            geometry_chunk1.ClearGeometryUpdates();
+
+            // Updating Entity 2 should only rebuild its chunk
+            geometry_data2->GetVertexBuffer(0) = GenVertexData(40,3);
+            geometry_data2->SetVertexBufferUpdated(0);
+            batch_data2->SetRebuild(true);
+
+            batch_system->Update(tp0,tp1);
+            batch_system->WaitOnMultiFrameBatch();
+
+            batch_system->Update(tp0,tp1);
+            batch_system->WaitOnMultiFrameBatch();
+
+            REQUIRE_FALSE(geometry_chunk0.GetUpdatedGeometry());
+            REQUIRE(geometry_chunk1.GetUpdatedGeometry());
+            REQUIRE(*(geometry_chunk1.GetVertexBuffer(0)) == *(GenVertexData(40,3)));
+
+            // Removing Entity 1 empties its chunk
+            scene->RemoveEntity(ent1);
+
+            batch_system->Update(tp0,tp1);
+            batch_system->WaitOnMultiFrameBatch();
+
+            batch_system->Update(tp0,tp1);
+            batch_system->WaitOnMultiFrameBatch();
+
+            list_batch_i_ents = batch_system->GetBatchEntities(batch_i_id);
+            REQUIRE(list_batch_i_ents.size()==1);
+            REQUIRE(*(list_render_data[list_batch_i_ents[0]].
+                      GetGeometry().GetVertexBuffer(0)) == *(GenVertexData(40,3)));
+        }
+
+        SECTION("MultiFrame batch removed while merging")
+        {
+            ks::shared_ptr<ks::draw::Batch<ks::draw::DefaultDrawKey>> batch_i =
+                    ks::make_shared<ks::draw::Batch<ks::draw::DefaultDrawKey>>(
+                        ks::draw::DefaultDrawKey{},
+                        &buffer_layout,
+                        nullptr,
+                        std::vector<ks::u8>{},
+                        ks::draw::Transparency::Opaque,
+                        ks::draw::UpdatePriority::MultiFrame,
+                        ks::draw::MergeMode::Incremental);
+
+            auto const batch_i_id = batch_system->RegisterBatch(batch_i);
+
+            auto const ent1 = scene->CreateEntity();
+            auto batch_data1 = CreateBatchData(scene.get(),ent1,batch_i_id);
+            FillGeometry(batch_data1,40,1);
+            batch_data1->SetRebuild(true);
+
+            auto const ent2 = scene->CreateEntity();
+            auto batch_data2 = CreateBatchData(scene.get(),ent2,batch_i_id);
+            FillGeometry(batch_data2,40,2);
+            batch_data2->SetRebuild(true);
+
+            batch_system->Update(tp0,tp1);
+            batch_system->WaitOnMultiFrameBatch();
+            batch_system->Update(tp0,tp1);
+            batch_system->WaitOnMultiFrameBatch();
+
+            auto const list_batch_i_ents = batch_system->GetBatchEntities(batch_i_id);
+            REQUIRE(list_batch_i_ents.size()==2);
+
+            // Hold the next task so the batch is removed
+            // while it's still running
+            std::atomic<bool> release_task(false);
+            batch_system->SetMFPreMergeCallback(
+                        [&](ks::Id,std::vector<ks::Id> const &list_ent_ids) {
+                            while(!release_task) {
+                                std::this_thread::yield();
+                            }
+                            return list_ent_ids;
+                        });
+
+            // Removing Entity 1 empties its chunk; the chunk's
+            // merged entity is handed to the new task
+            scene->RemoveEntity(ent1);
+            batch_system->Update(tp0,tp1);
+
+            scene->RemoveEntity(ent2);
+            batch_system->RemoveBatch(batch_i_id);
+
+            release_task = true;
+            batch_system->WaitOnMultiFrameBatch();
+            batch_system->Update(tp0,tp1);
+
+            for(auto const merged_ent_id : list_batch_i_ents) {
+                REQUIRE(list_render_data[merged_ent_id].GetUniqueId() == 0);
+            }
+        }
+
+        SECTION("MultiFrame batch removed after its task was cancelled")
+        {
+            batch_system->SetMFSupersedeTasks(true);
+
+            ks::shared_ptr<ks::draw::Batch<ks::draw::DefaultDrawKey>> batch_i =
+                    ks::make_shared<ks::draw::Batch<ks::draw::DefaultDrawKey>>(
+                        ks::draw::DefaultDrawKey{},
+                        &buffer_layout,
+                        nullptr,
+                        std::vector<ks::u8>{},
+                        ks::draw::Transparency::Opaque,
+                        ks::draw::UpdatePriority::MultiFrame,
+                        ks::draw::MergeMode::Incremental);
+
+            auto const batch_i_id = batch_system->RegisterBatch(batch_i);
+
+            auto const ent1 = scene->CreateEntity();
+            auto batch_data1 = CreateBatchData(scene.get(),ent1,batch_i_id);
+            FillGeometry(batch_data1,40,1);
+            batch_data1->SetRebuild(true);
+
+            auto const ent2 = scene->CreateEntity();
+            auto batch_data2 = CreateBatchData(scene.get(),ent2,batch_i_id);
+            auto geometry_data2 = FillGeometry(batch_data2,40,2);
+            batch_data2->SetRebuild(true);
+
+            batch_system->Update(tp0,tp1);
+            batch_system->WaitOnMultiFrameBatch();
+            batch_system->Update(tp0,tp1);
+            batch_system->WaitOnMultiFrameBatch();
+
+            auto const list_batch_i_ents = batch_system->GetBatchEntities(batch_i_id);
+            REQUIRE(list_batch_i_ents.size()==2);
+
+            std::atomic<bool> release_task(false);
+            batch_system->SetMFPreMergeCallback(
+                        [&](ks::Id,std::vector<ks::Id> const &list_ent_ids) {
+                            while(!release_task) {
+                                std::this_thread::yield();
+                            }
+                            return list_ent_ids;
+                        });
+
+            scene->RemoveEntity(ent1);
+            batch_system->Update(tp0,tp1);
+
+            // The running task is cancelled once the group changes
+            geometry_data2->GetVertexBuffer(0) = GenVertexData(40,3);
+            geometry_data2->SetVertexBufferUpdated(0);
+            batch_data2->SetRebuild(true);
+            batch_system->Update(tp0,tp1);
+
+            scene->RemoveEntity(ent2);
+            batch_system->RemoveBatch(batch_i_id);
+
+            for(auto const merged_ent_id : list_batch_i_ents) {
+                REQUIRE(list_render_data[merged_ent_id].GetUniqueId() == 0);
+            }
+
+            release_task = true;
+            batch_system->WaitOnMultiFrameBatch();
+            batch_system->Update(tp0,tp1);
+        }
+    }
 }
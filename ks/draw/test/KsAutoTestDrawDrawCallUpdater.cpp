@@ -85,11 +85,12 @@ namespace {
         return data;
     }
 
-    RenderData GenRenderData(uint element_count=0)
+    RenderData GenRenderData(uint element_count=0,
+                             draw::BufferLayout const * layout=&buffer_layout)
     {
         RenderData render_data{
                     draw::DefaultDrawKey{},
-                    &buffer_layout,
+                    layout,
                     nullptr,
                     std::vector<u8>{},
                     draw::Transparency::Opaque
@@ -208,6 +209,659 @@ TEST_CASE("ks::draw::DrawCallUpdater","[draw_draw_call_updater]")
         REQUIRE(task.m_list_ents_rem == list_ents_rem);
     }
 
+    SECTION("Verify Remove/Add Diffs from changed Entities")
+    {
+        std::vector<Id> list_ents_changed;
+        std::vector<Id> list_ents_rem;
+        std::vector<Id> list_ents_add;
+
+        // Add 1,2,3
+        for(uint i=1; i <= 3; i++) {
+            list_render_data[i] = GenRenderData(3);
+        }
+        list_ents_changed = {1,2,3};
+        task.UpdateChanged(list_ents_changed,list_render_data);
+
+        list_ents_add = {1,2,3};
+        list_ents_rem = {};
+        REQUIRE(task.m_list_ents_add == list_ents_add);
+        REQUIRE(task.m_list_ents_rem == list_ents_rem);
+        REQUIRE(task.m_list_ent_rd_curr.size() == 3);
+
+        // Nothing changed
+        list_ents_changed.clear();
+        task.UpdateChanged(list_ents_changed,list_render_data);
+        REQUIRE(task.m_list_ents_add.empty());
+        REQUIRE(task.m_list_ents_rem.empty());
+
+        // Remove 1 and replace 3; listing an Entity more
+        // than once or without changes is allowed
+        list_render_data[1] = RenderData();
+        list_render_data[3] = GenRenderData(3);
+        list_ents_changed = {1,3,2,1};
+        task.UpdateChanged(list_ents_changed,list_render_data);
+
+        list_ents_add = {3};
+        list_ents_rem = {1,3};
+        REQUIRE(task.m_list_ents_add == list_ents_add);
+        REQUIRE(task.m_list_ents_rem == list_ents_rem);
+        REQUIRE(task.m_list_ent_rd_curr.size() == 2);
+
+        // A full Update picks up from the changes
+        list_ent_rd_curr.emplace_back(2,list_render_data[2].GetUniqueId());
+        task.Update(list_ent_rd_curr,list_render_data);
+
+        list_ents_add = {};
+        list_ents_rem = {3};
+        REQUIRE(task.m_list_ents_add == list_ents_add);
+        REQUIRE(task.m_list_ents_rem == list_ents_rem);
+        REQUIRE(task.m_list_geometry_ranges[3].valid == false);
+        REQUIRE(task.m_list_geometry_ranges[2].valid == true);
+    }
+
+    SECTION("Dirty buffers are listed once per Update")
+    {
+        for(uint i=1; i <= 3; i++) {
+            list_render_data[i] = GenRenderData(3);
+            list_ent_rd_curr.emplace_back(i,list_render_data[i].GetUniqueId());
+        }
+
+        // All three entities fit in one VertexBuffer and
+        // one IndexBuffer block
+        task.Update(list_ent_rd_curr,list_render_data);
+        REQUIRE(task.GetUpdatedEntities().size() == 3);
+        REQUIRE(task.GetBuffersToSync().size() == 2);
+
+        auto const list_buffers_to_sync = task.GetBuffersToSync();
+
+        // Nothing changed
+        task.Update(list_ent_rd_curr,list_render_data);
+        REQUIRE(task.GetBuffersToSync().empty());
+
+        // Buffers are listed in the order they were first updated
+        // (entities are visited in order)
+        list_render_data[1].GetGeometry().SetIndexBufferRangeUpdated(0,2);
+        list_render_data[2].GetGeometry().SetVertexBufferRangeUpdated(0,0,4);
+        list_render_data[3].GetGeometry().SetVertexBufferRangeUpdated(0,0,4);
+
+        task.Update(list_ent_rd_curr,list_render_data);
+        REQUIRE(task.GetBuffersToSync().size() == 2);
+        REQUIRE(task.GetBuffersToSync()[0] == list_buffers_to_sync[1]);
+        REQUIRE(task.GetBuffersToSync()[1] == list_buffers_to_sync[0]);
+    }
+
+    SECTION("Adjacent uploads to a buffer are merged")
+    {
+        for(uint i=1; i <= 3; i++) {
+            list_render_data[i] = GenRenderData(3);
+            list_render_data[i].GetGeometry().SetRetainGeometry(i != 2);
+            list_ent_rd_curr.emplace_back(i,list_render_data[i].GetUniqueId());
+        }
+
+        // The ranges for all three entities are packed next to
+        // each other so there's one upload for each buffer
+        task.Update(list_ent_rd_curr,list_render_data);
+        REQUIRE(task.GetUploadStats().upload_count == 6);
+        REQUIRE(task.GetUploadStats().merged_upload_count == 2);
+        REQUIRE(task.GetUploadStats().gap_bytes == 0);
+
+        // Overlapping ranges
+        auto& geometry1 = list_render_data[1].GetGeometry();
+        geometry1.SetVertexBufferRangeUpdated(0,0,8);
+        geometry1.SetVertexBufferRangeUpdated(0,4,8);
+
+        task.Update(list_ent_rd_curr,list_render_data);
+        REQUIRE(task.GetUploadStats().upload_count == 2);
+        REQUIRE(task.GetUploadStats().merged_upload_count == 1);
+        REQUIRE(task.GetUploadStats().upload_bytes == 12);
+
+        // Ranges separated by a gap aren't merged by default
+        auto& geometry3 = list_render_data[3].GetGeometry();
+        geometry1.SetVertexBufferRangeUpdated(0,56,4);
+        geometry3.SetVertexBufferRangeUpdated(0,0,4);
+
+        task.Update(list_ent_rd_curr,list_render_data);
+        REQUIRE(task.GetUploadStats().upload_count == 2);
+        REQUIRE(task.GetUploadStats().merged_upload_count == 2);
+
+        // Entity 2 is between them but its geometry wasn't
+        // retained, so the gap can't be uploaded again
+        task.SetUploadGapThreshold(64);
+        geometry1.SetVertexBufferRangeUpdated(0,56,4);
+        geometry3.SetVertexBufferRangeUpdated(0,0,4);
+
+        task.Update(list_ent_rd_curr,list_render_data);
+        REQUIRE(task.GetUploadStats().merged_upload_count == 2);
+
+        // Once entity 2 is retained the gap is bridged
+        auto& geometry2 = list_render_data[2].GetGeometry();
+        geometry2.GetVertexBuffer(0) = GenVertexData(3);
+        geometry2.SetRetainGeometry(true);
+        geometry2.SetVertexBufferUpdated(0);
+        task.Update(list_ent_rd_curr,list_render_data);
+
+        geometry1.SetVertexBufferRangeUpdated(0,56,4);
+        geometry3.SetVertexBufferRangeUpdated(0,0,4);
+
+        task.Update(list_ent_rd_curr,list_render_data);
+        REQUIRE(task.GetUploadStats().upload_count == 2);
+        REQUIRE(task.GetUploadStats().merged_upload_count == 1);
+        REQUIRE(task.GetUploadStats().gap_bytes == 60);
+        REQUIRE(task.GetUploadStats().upload_bytes == 68);
+    }
+
+    SECTION("Merged uploads are staged in an arena that Sync recycles")
+    {
+        std::vector<DrawCall> list_draw_calls;
+        auto size_bytes_3_vx = GenVertexData(3)->size();
+
+        // Single uploads of geometry that isn't retained take
+        // over its data without staging
+        list_render_data[1] = GenRenderData(3);
+        list_render_data[1].GetGeometry().SetRetainGeometry(false);
+        list_ent_rd_curr.emplace_back(1,list_render_data[1].GetUniqueId());
+
+        task.Update(list_ent_rd_curr,list_render_data);
+        REQUIRE(task.GetUploadStats().merged_upload_count == 2);
+        REQUIRE(task.GetUploadStats().staging_bytes == 0);
+        REQUIRE(list_render_data[1].GetGeometry().GetVertexBuffer(0) == nullptr);
+        REQUIRE(list_render_data[1].GetGeometry().GetIndexBuffer() == nullptr);
+
+        // Adjacent ranges are merged into a run that's
+        // copied to the arena
+        task.Sync(list_draw_calls);
+        for(uint i=2; i <= 3; i++) {
+            list_render_data[i] = GenRenderData(3);
+            list_render_data[i].GetGeometry().SetRetainGeometry(false);
+            list_ent_rd_curr.emplace_back(i,list_render_data[i].GetUniqueId());
+        }
+
+        task.Update(list_ent_rd_curr,list_render_data);
+        REQUIRE(task.GetUploadStats().staging_bytes >= size_bytes_3_vx*2);
+        REQUIRE(list_render_data[2].GetGeometry().GetVertexBuffer(0) == nullptr);
+
+        auto const staging_data = task.m_staging_arena->data();
+
+        task.Sync(list_draw_calls);
+        REQUIRE(task.m_staging_arena->empty());
+
+        // The arena keeps its capacity
+        for(uint i=2; i <= 3; i++) {
+            auto& geometry = list_render_data[i].GetGeometry();
+            geometry.GetVertexBuffer(0) = GenVertexData(3);
+            geometry.SetVertexBufferUpdated(0);
+            geometry.GetIndexBuffer() = GenIndexData(3);
+            geometry.SetIndexBufferUpdated();
+        }
+
+        task.Update(list_ent_rd_curr,list_render_data);
+        REQUIRE(task.m_staging_arena->data() == staging_data);
+
+        // Retained geometry is uploaded without staging
+        list_render_data[4] = GenRenderData(3);
+        list_ent_rd_curr.emplace_back(4,list_render_data[4].GetUniqueId());
+
+        task.Sync(list_draw_calls);
+        task.Update(list_ent_rd_curr,list_render_data);
+        REQUIRE(task.GetUploadStats().staging_bytes == 0);
+    }
+
+    SECTION("Compaction moves ranges out of sparse buffers")
+    {
+        // Each VertexBuffer block fits two entities
+        uint const size_bytes_3_vx = GenVertexData(3)->size();
+
+        draw::BufferLayout compact_buffer_layout(
+                    gl::Buffer::Usage::Static,
+                    { vx_layout },
+                    { make_shared<draw::VertexBufferAllocator>(size_bytes_3_vx*2) },
+                    make_shared<draw::IndexBufferAllocator>(1024));
+
+        for(uint i=1; i <= 4; i++) {
+            list_render_data[i] = GenRenderData(3,&compact_buffer_layout);
+            list_render_data[i].GetGeometry().SetRetainGeometry(true);
+
+            list_ent_rd_curr.emplace_back(i,list_render_data[i].GetUniqueId());
+        }
+
+        task.Update(list_ent_rd_curr,list_render_data);
+        REQUIRE(task.GetBuffersToInit().size() == 3);
+
+        // Leave two half empty VertexBuffers
+        list_ent_rd_curr.erase(list_ent_rd_curr.begin()+1,
+                               list_ent_rd_curr.begin()+3);
+
+        task.Update(list_ent_rd_curr,list_render_data);
+        REQUIRE(task.GetCompactStats().moved_range_count == 0);
+
+        // Entity 1's range only fits in its own buffer so
+        // Entity 4's range is moved next to it instead
+        auto& gm_ranges_1 = task.m_list_geometry_ranges[1];
+        auto& gm_ranges_4 = task.m_list_geometry_ranges[4];
+        auto const buffer_4 = gm_ranges_4.list_vx_ranges[0].block->data;
+
+        task.SetCompaction(0.75f,1024);
+        task.Update(list_ent_rd_curr,list_render_data);
+        REQUIRE(task.GetCompactStats().moved_range_count == 1);
+        REQUIRE(task.GetCompactStats().moved_bytes == size_bytes_3_vx);
+        REQUIRE(task.GetCompactStats().freed_buffer_count == 1);
+        REQUIRE(task.GetRemovedBuffers().size() == 1);
+        REQUIRE(task.GetRemovedBuffers()[0] == buffer_4);
+        REQUIRE(gm_ranges_4.list_vx_ranges[0].block ==
+                gm_ranges_1.list_vx_ranges[0].block);
+
+        // The DrawCall is updated with the new range
+        std::vector<DrawCall> list_draw_calls;
+        REQUIRE(task.GetUpdatedEntities().size() == 1);
+        task.Sync(list_draw_calls);
+        REQUIRE(list_draw_calls[4].list_draw_vx[0].buffer ==
+                gm_ranges_1.list_vx_ranges[0].block->data);
+
+        // Nothing left to compact
+        task.Update(list_ent_rd_curr,list_render_data);
+        REQUIRE(task.GetCompactStats().moved_range_count == 0);
+        REQUIRE(task.GetRemovedBuffers().empty());
+    }
+
+    SECTION("Empty buffers are freed after a grace period")
+    {
+        // Each VertexBuffer block fits one entity
+        draw::BufferLayout reclaim_buffer_layout(
+                    gl::Buffer::Usage::Static,
+                    { vx_layout },
+                    { make_shared<draw::VertexBufferAllocator>(GenVertexData(3)->size()) },
+                    make_shared<draw::IndexBufferAllocator>(1024));
+
+        task.SetBufferReclaim(2,1);
+
+        for(uint i=1; i <= 3; i++) {
+            list_render_data[i] = GenRenderData(3,&reclaim_buffer_layout);
+            list_ent_rd_curr.emplace_back(i,list_render_data[i].GetUniqueId());
+        }
+        task.Update(list_ent_rd_curr,list_render_data);
+        REQUIRE(task.GetBuffersToInit().size() == 4);
+
+        // Three empty VertexBuffers and one empty IndexBuffer
+        list_ent_rd_curr.clear();
+        task.Update(list_ent_rd_curr,list_render_data);
+        REQUIRE(task.GetReclaimStats().empty_buffer_count == 4);
+        REQUIRE(task.GetReclaimStats().freed_buffer_count == 0);
+
+        task.Update(list_ent_rd_curr,list_render_data);
+        task.Update(list_ent_rd_curr,list_render_data);
+        REQUIRE(task.GetRemovedBuffers().empty());
+
+        // One empty buffer is kept for each allocator
+        task.Update(list_ent_rd_curr,list_render_data);
+        REQUIRE(task.GetReclaimStats().freed_buffer_count == 2);
+        REQUIRE(task.GetReclaimStats().empty_buffer_count == 2);
+        REQUIRE(task.GetRemovedBuffers().size() == 2);
+
+        // Which are used instead of creating new buffers
+        list_render_data[4] = GenRenderData(3,&reclaim_buffer_layout);
+        list_ent_rd_curr.emplace_back(4,list_render_data[4].GetUniqueId());
+        task.Update(list_ent_rd_curr,list_render_data);
+        REQUIRE(task.GetBuffersToInit().empty());
+        REQUIRE(task.GetReclaimStats().empty_buffer_count == 0);
+    }
+
+    SECTION("Geometry larger than a block gets a dedicated buffer")
+    {
+        // Each VertexBuffer block fits 3 vertices
+        draw::BufferLayout small_buffer_layout(
+                    gl::Buffer::Usage::Static,
+                    { vx_layout },
+                    { make_shared<draw::VertexBufferAllocator>(GenVertexData(3)->size()) },
+                    make_shared<draw::IndexBufferAllocator>(1024));
+
+        list_render_data[1] = GenRenderData(10,&small_buffer_layout);
+        auto& geometry = list_render_data[1].GetGeometry();
+        list_ent_rd_curr.emplace_back(1,list_render_data[1].GetUniqueId());
+
+        task.Update(list_ent_rd_curr,list_render_data);
+        REQUIRE(task.GetBuffersToInit().size() == 2);
+
+        auto& gm_ranges = task.m_list_geometry_ranges[1];
+        auto const buffer_idx = gm_ranges.list_vx_buffer_idx[0];
+        auto const dedicated_buffer = gm_ranges.list_vx_ranges[0].block->data;
+        REQUIRE(task.m_list_buffer_blocks[buffer_idx].GetIsDedicated());
+        REQUIRE(task.m_list_buffer_blocks[buffer_idx].size_bytes ==
+                GenVertexData(10)->size());
+
+        // Smaller data that still doesn't fit in a block
+        // stays in the dedicated buffer
+        geometry.GetVertexBuffer(0) = GenVertexData(8);
+        geometry.SetVertexBufferUpdated(0);
+
+        task.Update(list_ent_rd_curr,list_render_data);
+        REQUIRE(task.GetBuffersToInit().empty());
+        REQUIRE(gm_ranges.list_vx_ranges[0].block->data == dedicated_buffer);
+
+        // Data that fits in a block is moved to a shared buffer
+        // and the dedicated buffer is freed right away
+        geometry.GetVertexBuffer(0) = GenVertexData(3);
+        geometry.SetVertexBufferUpdated(0);
+
+        task.Update(list_ent_rd_curr,list_render_data);
+        REQUIRE(task.GetBuffersToInit().size() == 1);
+        REQUIRE(!task.m_list_buffer_blocks[gm_ranges.list_vx_buffer_idx[0]].GetIsDedicated());
+        REQUIRE(task.GetRemovedBuffers().size() == 1);
+        REQUIRE(task.GetRemovedBuffers()[0] == dedicated_buffer);
+    }
+
+    SECTION("Ranges are rounded up to their size class")
+    {
+        auto class_vx_alloc = make_shared<draw::VertexBufferAllocator>(1024);
+
+        draw::BufferLayout class_buffer_layout(
+                    gl::Buffer::Usage::Static,
+                    { vx_layout },
+                    { class_vx_alloc },
+                    make_shared<draw::IndexBufferAllocator>(1024),
+                    draw::IndexType::UInt16,
+                    {},
+                    { 256, 64 });
+
+        REQUIRE(class_buffer_layout.GetSizeClasses().GetCount() == 2);
+
+        // 60 bytes, 100 bytes and 400 bytes of vertex data
+        list_render_data[1] = GenRenderData(3,&class_buffer_layout);
+        list_render_data[2] = GenRenderData(5,&class_buffer_layout);
+        list_render_data[3] = GenRenderData(20,&class_buffer_layout);
+        for(uint i=1; i <= 3; i++) {
+            list_ent_rd_curr.emplace_back(i,list_render_data[i].GetUniqueId());
+        }
+        task.Update(list_ent_rd_curr,list_render_data);
+
+        auto& gm_ranges_1 = task.m_list_geometry_ranges[1];
+        auto& gm_ranges_2 = task.m_list_geometry_ranges[2];
+        auto& gm_ranges_3 = task.m_list_geometry_ranges[3];
+
+        REQUIRE(gm_ranges_1.list_vx_ranges[0].size == 64);
+        REQUIRE(gm_ranges_1.list_vx_sizes[0] == 60);
+        REQUIRE(gm_ranges_1.ix_range.size == 64);
+        REQUIRE(gm_ranges_1.ix_size == 6);
+        REQUIRE(gm_ranges_2.list_vx_ranges[0].size == 256);
+
+        // Data larger than every class uses the given allocator
+        REQUIRE(gm_ranges_3.list_vx_ranges[0].size == 400);
+        REQUIRE(class_buffer_layout.GetVertexBufferAllocator(0,400) ==
+                class_vx_alloc);
+        REQUIRE(class_buffer_layout.GetVertexBufferAllocator(0,60) !=
+                class_vx_alloc);
+
+        // Each class has its own buffers, sized to hold a slab
+        // of ranges but no larger than the given block size
+        REQUIRE(gm_ranges_1.list_vx_ranges[0].block !=
+                gm_ranges_2.list_vx_ranges[0].block);
+
+        auto const &size_classes = class_buffer_layout.GetSizeClasses();
+        REQUIRE(size_classes.GetSlabSizeBytes(0,1024*1024) ==
+                64*draw::SizeClasses::k_slab_range_count);
+        REQUIRE(size_classes.GetSlabSizeBytes(1,1024) == 1024);
+        REQUIRE(class_buffer_layout.GetVertexBufferAllocator(0,60)->GetBlockSize() ==
+                std::min(64*draw::SizeClasses::k_slab_range_count,1024u));
+
+        // Only the data is drawn and uploaded
+        std::vector<DrawCall> list_draw_calls;
+        task.Sync(list_draw_calls);
+        REQUIRE(list_draw_calls[1].list_draw_vx[0].size_bytes == 60);
+        REQUIRE(list_draw_calls[1].draw_ix.size_bytes == 6);
+
+        // A freed range is reused by any range of its class
+        uint const start_1 = gm_ranges_1.list_vx_ranges[0].start;
+        auto const block_1 = gm_ranges_1.list_vx_ranges[0].block;
+
+        list_render_data[4] = GenRenderData(2,&class_buffer_layout);
+        list_ent_rd_curr.erase(list_ent_rd_curr.begin());
+        list_ent_rd_curr.emplace_back(4,list_render_data[4].GetUniqueId());
+        task.Update(list_ent_rd_curr,list_render_data);
+
+        auto& gm_ranges_4 = task.m_list_geometry_ranges[4];
+        REQUIRE(task.GetBuffersToInit().empty());
+        REQUIRE(gm_ranges_4.list_vx_ranges[0].block == block_1);
+        REQUIRE(gm_ranges_4.list_vx_ranges[0].start == start_1);
+        REQUIRE(gm_ranges_4.list_vx_sizes[0] == 40);
+    }
+
+    SECTION("Updated geometry that fits is kept in place")
+    {
+        auto size_bytes_3_vx = GenVertexData(3)->size();
+        auto size_bytes_2_vx = GenVertexData(2)->size();
+        auto size_bytes_2_ix = GenIndexData(2)->size();
+
+        draw::BufferLayout in_place_buffer_layout(
+                    gl::Buffer::Usage::Static,
+                    { vx_layout },
+                    { make_shared<draw::VertexBufferAllocator>(1024) },
+                    make_shared<draw::IndexBufferAllocator>(1024));
+
+        for(uint i=1; i <= 2; i++) {
+            list_render_data[i] = GenRenderData(3,&in_place_buffer_layout);
+            list_ent_rd_curr.emplace_back(i,list_render_data[i].GetUniqueId());
+        }
+        task.Update(list_ent_rd_curr,list_render_data);
+
+        auto& gm_ranges_1 = task.m_list_geometry_ranges[1];
+        auto& gm_ranges_2 = task.m_list_geometry_ranges[2];
+        auto const vx_range_1 = gm_ranges_1.list_vx_ranges[0];
+        auto const ix_range_1 = gm_ranges_1.ix_range;
+
+        // Same size
+        auto& geometry_1 = list_render_data[1].GetGeometry();
+        geometry_1.GetVertexBuffer(0) = GenVertexData(3);
+        geometry_1.SetVertexBufferUpdated(0);
+
+        task.Update(list_ent_rd_curr,list_render_data);
+        REQUIRE(task.GetUploadStats().in_place_count == 1);
+        REQUIRE(gm_ranges_1.list_vx_ranges[0].start == vx_range_1.start);
+        REQUIRE(gm_ranges_1.list_vx_ranges[0].size == size_bytes_3_vx);
+
+        // Smaller; the unused tail is released
+        geometry_1.GetVertexBuffer(0) = GenVertexData(2);
+        geometry_1.SetVertexBufferUpdated(0);
+        geometry_1.GetIndexBuffer() = GenIndexData(2);
+        geometry_1.SetIndexBufferUpdated();
+
+        task.Update(list_ent_rd_curr,list_render_data);
+        REQUIRE(task.GetUploadStats().in_place_count == 2);
+        REQUIRE(gm_ranges_1.list_vx_ranges[0].start == vx_range_1.start);
+        REQUIRE(gm_ranges_1.list_vx_ranges[0].size == size_bytes_2_vx);
+        REQUIRE(gm_ranges_1.ix_range.start == ix_range_1.start);
+        REQUIRE(gm_ranges_1.ix_range.size == size_bytes_2_ix);
+
+        std::vector<DrawCall> list_draw_calls;
+        task.Sync(list_draw_calls);
+        REQUIRE(list_draw_calls[1].list_draw_vx[0].size_bytes == size_bytes_2_vx);
+        REQUIRE(list_draw_calls[1].draw_ix.size_bytes == size_bytes_2_ix);
+
+        // The released tail is the first free space
+        list_render_data[3] = GenRenderData(1,&in_place_buffer_layout);
+        list_ent_rd_curr.emplace_back(3,list_render_data[3].GetUniqueId());
+        task.Update(list_ent_rd_curr,list_render_data);
+        REQUIRE(task.m_list_geometry_ranges[3].list_vx_ranges[0].start ==
+                vx_range_1.start+size_bytes_2_vx);
+
+        // Larger than the range; a new range is acquired
+        auto& geometry_2 = list_render_data[2].GetGeometry();
+        geometry_2.GetVertexBuffer(0) = GenVertexData(4);
+        geometry_2.SetVertexBufferUpdated(0);
+
+        task.Update(list_ent_rd_curr,list_render_data);
+        REQUIRE(task.GetUploadStats().in_place_count == 0);
+        REQUIRE(gm_ranges_2.list_vx_ranges[0].size == GenVertexData(4)->size());
+    }
+
+    SECTION("Geometry that isn't drawn is evicted to stay under the budget")
+    {
+        // Each VertexBuffer block fits one entity
+        uint const vx_block_size = GenVertexData(3)->size();
+        draw::BufferLayout budget_buffer_layout(
+                    gl::Buffer::Usage::Static,
+                    { vx_layout },
+                    { make_shared<draw::VertexBufferAllocator>(vx_block_size) },
+                    make_shared<draw::IndexBufferAllocator>(1024));
+
+        for(uint i=1; i <= 3; i++) {
+            list_render_data[i] = GenRenderData(3,&budget_buffer_layout);
+            list_ent_rd_curr.emplace_back(i,list_render_data[i].GetUniqueId());
+        }
+
+        // Room for the IndexBuffer and two VertexBuffers
+        task.SetMemoryBudget(1024+2*vx_block_size,2);
+
+        std::vector<DrawCall> list_draw_calls;
+        auto update_and_draw = [&](std::vector<Id> const &list_drawn) {
+            task.Update(list_ent_rd_curr,list_render_data);
+            task.Sync(list_draw_calls);
+            for(auto ent_id : list_drawn) {
+                task.MarkDrawn(ent_id);
+            }
+        };
+
+        // Entity 3 isn't drawn but isn't evicted until it
+        // has been left out for more than two Updates
+        update_and_draw({1,2});
+        update_and_draw({1,2});
+        update_and_draw({1,2});
+        REQUIRE(task.GetBudgetStats().evicted_count == 0);
+        REQUIRE(task.GetBudgetStats().buffer_bytes == 1024+3*vx_block_size);
+        REQUIRE(list_draw_calls[3].valid);
+
+        update_and_draw({1,2});
+        REQUIRE(task.GetBudgetStats().evicted_count == 1);
+        REQUIRE(task.GetBudgetStats().evicted_bytes ==
+                vx_block_size+GenIndexData(3)->size());
+        REQUIRE(task.GetBudgetStats().freed_buffer_count == 1);
+        REQUIRE(task.GetBudgetStats().buffer_bytes == 1024+2*vx_block_size);
+        REQUIRE(task.GetRemovedBuffers().size() == 1);
+        REQUIRE(task.GetEvicted(3));
+        REQUIRE(!list_draw_calls[3].valid);
+        REQUIRE(list_draw_calls[1].valid);
+
+        // Evicted geometry stays evicted while it isn't drawn
+        update_and_draw({1,2,3});
+        REQUIRE(task.GetBudgetStats().evicted_count == 0);
+        REQUIRE(task.GetBudgetStats().restored_count == 0);
+
+        // and is uploaded again once it is
+        update_and_draw({1,2,3});
+        REQUIRE(task.GetBudgetStats().restored_count == 1);
+        REQUIRE(task.GetBudgetStats().restored_bytes ==
+                vx_block_size+GenIndexData(3)->size());
+        REQUIRE(task.GetBuffersToInit().size() == 1);
+        REQUIRE(!task.GetEvicted(3));
+        REQUIRE(list_draw_calls[3].valid);
+
+        // Entities that are drawn aren't evicted even if the
+        // buffers are over the budget
+        update_and_draw({1,2,3});
+        REQUIRE(task.GetBudgetStats().evicted_count == 0);
+        REQUIRE(task.GetBudgetStats().buffer_bytes == 1024+3*vx_block_size);
+    }
+
+    SECTION("Uploads over the upload budget are deferred by priority")
+    {
+        draw::BufferLayout upload_buffer_layout(
+                    gl::Buffer::Usage::Static,
+                    { vx_layout },
+                    { make_shared<draw::VertexBufferAllocator>(1024) },
+                    make_shared<draw::IndexBufferAllocator>(1024));
+
+        for(uint i=1; i <= 3; i++) {
+            list_render_data[i] = GenRenderData(3,&upload_buffer_layout);
+            list_ent_rd_curr.emplace_back(i,list_render_data[i].GetUniqueId());
+        }
+
+        list_render_data[1].SetUploadPriority(1);
+        list_render_data[3].SetUploadPriority(2);
+
+        uint const size_bytes = GenVertexData(3)->size()+GenIndexData(3)->size();
+
+        // Only one entity fits each Update
+        task.SetUploadBudget(size_bytes+size_bytes/2);
+
+        std::vector<DrawCall> list_draw_calls;
+        task.Update(list_ent_rd_curr,list_render_data);
+        task.Sync(list_draw_calls);
+        REQUIRE(task.GetUpdatedEntities() == std::vector<Id>{3});
+        REQUIRE(task.GetUploadStats().deferred_count == 2);
+        REQUIRE(task.GetUploadStats().deferred_bytes == 2*size_bytes);
+        REQUIRE(list_draw_calls[3].valid);
+        REQUIRE(!list_draw_calls[1].valid);
+        REQUIRE(!list_draw_calls[2].valid);
+
+        task.Update(list_ent_rd_curr,list_render_data);
+        task.Sync(list_draw_calls);
+        REQUIRE(task.GetUpdatedEntities() == std::vector<Id>{1});
+        REQUIRE(list_draw_calls[1].valid);
+        REQUIRE(!list_draw_calls[2].valid);
+
+        task.Update(list_ent_rd_curr,list_render_data);
+        task.Sync(list_draw_calls);
+        REQUIRE(task.GetUpdatedEntities() == std::vector<Id>{2});
+        REQUIRE(task.GetUploadStats().deferred_count == 0);
+        REQUIRE(list_draw_calls[2].valid);
+
+        // Geometry larger than the budget is still uploaded
+        // when nothing else was
+        task.SetUploadBudget(1);
+        list_render_data[2].GetGeometry().GetVertexBuffer(0) = GenVertexData(4);
+        list_render_data[2].GetGeometry().SetVertexBufferUpdated(0);
+
+        task.Update(list_ent_rd_curr,list_render_data);
+        REQUIRE(task.GetUpdatedEntities() == std::vector<Id>{2});
+        REQUIRE(task.GetUploadStats().deferred_count == 0);
+    }
+
+    SECTION("Deferred geometry isn't bridged by merged uploads")
+    {
+        draw::BufferLayout upload_buffer_layout(
+                    gl::Buffer::Usage::Static,
+                    { vx_layout },
+                    { make_shared<draw::VertexBufferAllocator>(1024) },
+                    make_shared<draw::IndexBufferAllocator>(1024));
+
+        for(uint i=1; i <= 3; i++) {
+            list_render_data[i] = GenRenderData(3,&upload_buffer_layout);
+            list_ent_rd_curr.emplace_back(i,list_render_data[i].GetUniqueId());
+        }
+
+        std::vector<DrawCall> list_draw_calls;
+        task.Update(list_ent_rd_curr,list_render_data);
+        task.Sync(list_draw_calls);
+
+        // Entity 2's ranges sit between those of 1 and 3
+        // and its update is deferred
+        uint const size_bytes = GenVertexData(3)->size()+GenIndexData(3)->size();
+        task.SetUploadGapThreshold(1024);
+        task.SetUploadBudget(2*size_bytes+size_bytes/2);
+
+        list_render_data[1].SetUploadPriority(1);
+        list_render_data[3].SetUploadPriority(1);
+
+        for(uint i=1; i <= 3; i++) {
+            auto& geometry = list_render_data[i].GetGeometry();
+            geometry.GetVertexBuffer(0) = GenVertexData(3);
+            geometry.SetVertexBufferUpdated(0);
+            geometry.GetIndexBuffer() = GenIndexData(3);
+            geometry.SetIndexBufferUpdated();
+        }
+
+        task.Update(list_ent_rd_curr,list_render_data);
+        task.Sync(list_draw_calls);
+        REQUIRE(task.GetUploadStats().deferred_count == 1);
+        REQUIRE(task.GetUploadStats().upload_count == 4);
+        REQUIRE(task.GetUploadStats().merged_upload_count == 4);
+        REQUIRE(task.GetUploadStats().gap_bytes == 0);
+        REQUIRE(list_draw_calls[2].valid);
+
+        // The deferred update is uploaded by itself later
+        task.Update(list_ent_rd_curr,list_render_data);
+        REQUIRE(task.GetUpdatedEntities() == std::vector<Id>{2});
+        REQUIRE(task.GetUploadStats().merged_upload_count == 2);
+    }
+
     SECTION("Verify Remove/Add/Update RenderData --> GeometryRanges")
     {
         std::vector<DrawCall> list_draw_calls;
@@ -265,6 +919,19 @@ TEST_CASE("ks::draw::DrawCallUpdater","[draw_draw_call_updater]")
         REQUIRE(draw_call->draw_ix.size_bytes == size_bytes_10_ix);
 
 
+        // Update part of Entity 1 Vertex Data; the data is
+        // uploaded to the range it already has
+        auto const vx_range_start = gm_ranges->list_vx_ranges[0].start;
+        list_render_data[1].GetGeometry().SetVertexBufferRangeUpdated(
+                    0,0,size_bytes_5_vx/5);
+
+        task.Update(list_ent_rd_curr,list_render_data);
+        REQUIRE(gm_ranges->list_vx_ranges[0].start == vx_range_start);
+        REQUIRE(gm_ranges->list_vx_ranges[0].size == size_bytes_5_vx);
+        REQUIRE(task.GetBuffersToSync().size() == 1);
+        REQUIRE(task.GetUpdatedEntities().size() == 1);
+
+
         // Remove Entity 1
         list_ent_rd_curr.clear();
         task.Update(list_ent_rd_curr,list_render_data);
@@ -0,0 +1,300 @@
+/*
+   Copyright (C) 2016 Preet Desai (preet.desai@gmail.com)
+
+   Licensed under the Apache License, Version 2.0 (the "License");
+   you may not use this file except in compliance with the License.
+   You may obtain a copy of the License at
+
+       http://www.apache.org/licenses/LICENSE-2.0
+
+   Unless required by applicable law or agreed to in writing, software
+   distributed under the License is distributed on an "AS IS" BASIS,
+   WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+   See the License for the specific language governing permissions and
+   limitations under the License.
+*/
+
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <random>
+#include <unordered_map>
+
+#include <ks/draw/KsDrawComponents.hpp>
+
+// * Replays a sequence of range allocations and releases against
+//   the BufferLayout allocators with and without size classes and
+//   compares fragmentation and allocation time
+// * The sequence is read from a file given as the first argument
+//   where each line is either '+ <id> <size_bytes>' or '- <id>'.
+//   Without a file a sequence that mixes small sprites with large
+//   meshes is generated
+
+namespace test
+{
+    using namespace ks;
+
+    struct Op
+    {
+        bool acquire;
+        uint id;
+        uint size_bytes;
+    };
+
+    struct Result
+    {
+        uint block_count{0};
+        u64 block_bytes{0};
+        u64 peak_block_bytes{0};
+        uint failed_count{0};
+        u64 data_bytes{0};
+        u64 range_bytes{0};
+        u64 peak_data_bytes{0};
+        double acquire_ms{0};
+        double release_ms{0};
+
+        // * The number of blocks created for each size class with
+        //   one more entry at the end for the given allocator
+        std::vector<uint> list_class_size_bytes;
+        std::vector<uint> list_class_block_count;
+    };
+
+    uint const block_size_bytes = 256*1024;
+
+    gl::VertexLayout const vx_layout {
+        {
+            "a_v4_position",
+            gl::VertexBuffer::Attribute::Type::Float,
+            4,
+            false
+        }
+    };
+
+    // ============================================================= //
+
+    bool ReadTrace(std::string const &file_path, std::vector<Op>& list_ops)
+    {
+        std::ifstream file(file_path);
+        if(!file.is_open()) {
+            return false;
+        }
+
+        char op_type;
+        while(file >> op_type) {
+            Op op{op_type=='+',0,0};
+            file >> op.id;
+            if(op.acquire) {
+                file >> op.size_bytes;
+            }
+            list_ops.push_back(op);
+        }
+
+        return true;
+    }
+
+    void GenTrace(std::vector<Op>& list_ops)
+    {
+        std::mt19937 mt(1234);
+        std::uniform_int_distribution<uint> dis_pct(0,99);
+        std::uniform_int_distribution<uint> dis_sprite(1,16);
+        std::uniform_int_distribution<uint> dis_mesh(64,2048);
+
+        std::vector<uint> list_live_ids;
+        uint next_id = 0;
+
+        for(uint i=0; i < 200000; i++)
+        {
+            bool const acquire =
+                    list_live_ids.size() < 1000 ||
+                    dis_pct(mt) < 50;
+
+            if(acquire) {
+                // Sizes are vertex counts of 16 byte vertices
+                uint const size_bytes = (dis_pct(mt) < 90) ?
+                            dis_sprite(mt)*4*16 :
+                            dis_mesh(mt)*16;
+
+                list_ops.push_back(Op{true,next_id,size_bytes});
+                list_live_ids.push_back(next_id);
+                next_id++;
+            }
+            else {
+                std::uniform_int_distribution<uint> dis_live(
+                            0,list_live_ids.size()-1);
+
+                uint const live_idx = dis_live(mt);
+                list_ops.push_back(Op{false,list_live_ids[live_idx],0});
+                list_live_ids[live_idx] = list_live_ids.back();
+                list_live_ids.pop_back();
+            }
+        }
+    }
+
+    Result Replay(std::vector<Op> const &list_ops,
+                  std::vector<uint> const &list_size_classes)
+    {
+        using Clock = std::chrono::high_resolution_clock;
+        using Range = draw::VertexBufferAllocator::Range;
+
+        draw::BufferLayout buffer_layout(
+                    gl::Buffer::Usage::Static,
+                    { vx_layout },
+                    { make_shared<draw::VertexBufferAllocator>(block_size_bytes) },
+                    nullptr,
+                    draw::IndexType::UInt16,
+                    {},
+                    list_size_classes);
+
+        auto const &size_classes = buffer_layout.GetSizeClasses();
+
+        Result result;
+        result.list_class_block_count.resize(size_classes.GetCount()+1,0);
+        for(uint i=0; i < size_classes.GetCount(); i++) {
+            result.list_class_size_bytes.push_back(
+                        size_classes.GetClassSizeBytes(i));
+        }
+        std::unordered_map<uint,std::pair<Range,uint>> lkup_ranges;
+
+        for(auto const &op : list_ops)
+        {
+            if(op.acquire)
+            {
+                if(op.size_bytes > block_size_bytes) {
+                    result.failed_count++;
+                    continue;
+                }
+
+                auto const start = Clock::now();
+
+                auto& allocator =
+                        buffer_layout.GetVertexBufferAllocator(0,op.size_bytes);
+
+                uint const alloc_size_bytes =
+                        size_classes.GetAllocSizeBytes(op.size_bytes);
+
+                auto range = allocator->AcquireRange(alloc_size_bytes);
+                if(range.size == 0) {
+                    allocator->CreateBlock(
+                                make_shared<gl::VertexBuffer>(
+                                    vx_layout,
+                                    gl::Buffer::Usage::Static));
+
+                    range = allocator->AcquireRange(alloc_size_bytes);
+                    result.block_count++;
+                    result.block_bytes += allocator->GetBlockSize();
+                    result.list_class_block_count[
+                            size_classes.GetClass(op.size_bytes)]++;
+                }
+
+                result.acquire_ms +=
+                        std::chrono::duration<double,std::milli>(
+                            Clock::now()-start).count();
+
+                lkup_ranges.emplace(op.id,std::make_pair(range,op.size_bytes));
+
+                result.data_bytes += op.size_bytes;
+                result.range_bytes += range.size;
+                result.peak_block_bytes =
+                        std::max(result.peak_block_bytes,result.block_bytes);
+                result.peak_data_bytes =
+                        std::max(result.peak_data_bytes,result.data_bytes);
+            }
+            else
+            {
+                auto it = lkup_ranges.find(op.id);
+                if(it == lkup_ranges.end()) {
+                    continue;
+                }
+
+                auto const &range = it->second.first;
+
+                auto const start = Clock::now();
+
+                bool empty;
+                buffer_layout.GetVertexBufferAllocator(0,range.size)->
+                        ReleaseRange(range,empty);
+
+                result.release_ms +=
+                        std::chrono::duration<double,std::milli>(
+                            Clock::now()-start).count();
+
+                result.data_bytes -= it->second.second;
+                result.range_bytes -= range.size;
+                lkup_ranges.erase(it);
+            }
+        }
+
+        return result;
+    }
+
+    void PrintResult(std::string const &name, Result const &result)
+    {
+        double const peak_block_bytes = result.peak_block_bytes;
+
+        std::cout << name << ":\n"
+                  << "  blocks: " << result.block_count
+                  << " (peak used " << result.peak_data_bytes/1024 << " kb"
+                  << " in " << peak_block_bytes/1024 << " kb)\n"
+                  << "  blocks per class:";
+
+        for(uint i=0; i < result.list_class_block_count.size(); i++) {
+            if(i < result.list_class_size_bytes.size()) {
+                std::cout << " " << result.list_class_size_bytes[i] << "b: ";
+            }
+            else {
+                std::cout << " unclassed: ";
+            }
+            std::cout << result.list_class_block_count[i];
+        }
+
+        std::cout << "\n"
+                  << "  peak fill: "
+                  << (peak_block_bytes > 0 ? result.peak_data_bytes/peak_block_bytes : 0)
+                  << "\n"
+                  << "  final data/range bytes: "
+                  << result.data_bytes << "/" << result.range_bytes << "\n"
+                  << "  failed: " << result.failed_count << "\n"
+                  << "  acquire ms: " << result.acquire_ms
+                  << ", release ms: " << result.release_ms << "\n";
+    }
+}
+
+// ============================================================= //
+// ============================================================= //
+
+int main(int argc, char* argv[])
+{
+    std::vector<test::Op> list_ops;
+
+    if(argc > 1) {
+        if(!test::ReadTrace(argv[1],list_ops)) {
+            std::cout << "Failed to read trace: " << argv[1] << std::endl;
+            return -1;
+        }
+    }
+    else {
+        test::GenTrace(list_ops);
+    }
+
+    std::cout << "Replaying " << list_ops.size() << " ops, "
+              << "block size: " << test::block_size_bytes << "\n";
+
+    test::PrintResult(
+                "first fit",
+                test::Replay(list_ops,{}));
+
+    test::PrintResult(
+                "size classes (pow2 64b-4kb)",
+                test::Replay(list_ops,
+                             ks::draw::SizeClasses::GenPow2Classes(64,4096)));
+
+    test::PrintResult(
+                "size classes (pow2 64b-64kb)",
+                test::Replay(list_ops,
+                             ks::draw::SizeClasses::GenPow2Classes(64,64*1024)));
+
+    return 0;
+}
+
+// ============================================================= //
+// ============================================================= //
@@ -39,7 +39,8 @@ namespace test
 
     using RenderData = draw::RenderData<draw::DefaultDrawKey>;
 
-    using RenderDataComponentList = ecs::ComponentList<SceneKey,RenderData>;
+    using RenderDataComponentList =
+        draw::RenderDataComponentList<SceneKey,draw::DefaultDrawKey>;
 
     using BatchData = draw::BatchData;
 
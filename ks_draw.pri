@@ -8,7 +8,9 @@ HEADERS += \
     $${PATH_KS_DRAW}/KsDrawScene.hpp \
     $${PATH_KS_DRAW}/KsDrawDrawStage.hpp \
     $${PATH_KS_DRAW}/KsDrawComponents.hpp \
+    $${PATH_KS_DRAW}/KsDrawRenderDataComponentList.hpp \
     $${PATH_KS_DRAW}/KsDrawRenderStats.hpp \
+    $${PATH_KS_DRAW}/KsDrawBatchStats.hpp \
     $${PATH_KS_DRAW}/KsDrawDefaultDrawStage.hpp \
     $${PATH_KS_DRAW}/KsDrawDebugTextDrawStage.hpp \
     $${PATH_KS_DRAW}/KsDrawDefaultDrawKey.hpp \
@@ -18,7 +20,9 @@ HEADERS += \
 
 SOURCES += \
     $${PATH_KS_DRAW}/KsDrawComponents.cpp \
+    $${PATH_KS_DRAW}/KsDrawDrawStage.cpp \
     $${PATH_KS_DRAW}/KsDrawRenderStats.cpp \
+    $${PATH_KS_DRAW}/KsDrawBatchStats.cpp \
     $${PATH_KS_DRAW}/KsDrawDebugTextDrawStage.cpp \
     $${PATH_KS_DRAW}/KsDrawDefaultDrawKey.cpp \
     $${PATH_KS_DRAW}/KsDrawBatchSystem.cpp